@@ -34,7 +34,6 @@ const char *GRASS_BACKGROUND_PATH = "assets/background.png";
 const SDL_Rect WINDOW = (SDL_Rect){.x = 0, .y = 0, .w = 1000, .h = 500};
 
 const size_t TOTAL_HOLES = 9;
-const size_t NUM_POINTS_IN_CIRCLE = 20;
 const double BALL_RADIUS = 15;
 const double BALL_MASS = 5;
 const rgb_color_t BALL_WHITE = {1, 1, 1};
@@ -212,6 +211,37 @@ body_type_t get_type(body_t *body) {
   return *(body_type_t *)body_get_info(body);
 }
 
+/**
+ * Returns the collision category bit of a body type
+ * 
+ * @param type of body
+ * @return category bit
+ */
+uint32_t type_category(body_type_t type) {
+  return (uint32_t)1 << type;
+}
+
+/**
+ * Puts body in the collision category of its type, so the scene's collision
+ * rules apply to it
+ * 
+ * @param body
+ */
+void set_type_category(body_t *body) {
+  body_set_collision_filter(body, type_category(get_type(body)), UINT32_MAX);
+}
+
+/**
+ * Body filter for force fields that only act on the ball
+ * 
+ * @param body
+ * @param aux unused
+ * @return whether body is the ball
+ */
+bool is_ball(body_t *body, void *aux) {
+  return body_get_category(body) == type_category(BALL);
+}
+
 /**
  * Makes and returns body type
  * 
@@ -236,60 +266,6 @@ double rand_double(double low, double high) {
   return (high - low) * rand() / RAND_MAX + low;
 }
 
-/**
- * Makes list of circle vertices
- * 
- * @param center of circle
- * @param radius of circle
- * @return list of vertices
- */
-list_t *make_circle(vector_t center, double radius) {
-    list_t *c = list_init(NUM_POINTS_IN_CIRCLE, free);
-    for (size_t i = 0; i < NUM_POINTS_IN_CIRCLE; i++) {
-      double angle = 2 * M_PI * i / NUM_POINTS_IN_CIRCLE;
-      vector_t *v = malloc(sizeof(*v));
-      assert(v);
-      *v = (vector_t){center.x + radius * cos(angle), center.y + radius * sin(angle)};
-      list_add(c, v);
-    }
-    return c;
-}
-
-/**
- * Makes list of rectangle vertices
- * 
- * @param center of rectangle
- * @param width of rectangle
- * @param height of rectangle
- * @return list of vertices
- */
-
-list_t *make_rectangle(vector_t center, double width, double height) {
-    list_t *points = list_init(4, free);
-    vector_t *p1 = malloc(sizeof(vector_t));
-    assert(p1);
-    *p1 = (vector_t){center.x - width / 2, center.y - height / 2};
-
-    vector_t *p2 = malloc(sizeof(vector_t));
-    assert(p2);
-    *p2 = (vector_t){center.x + width / 2, center.y - height / 2};
-
-    vector_t *p3 = malloc(sizeof(vector_t));
-    assert(p3);
-    *p3 = (vector_t){center.x + width / 2, center.y + height / 2};
-
-    vector_t *p4 = malloc(sizeof(vector_t));
-    assert(p4);
-    *p4 = (vector_t){center.x - width / 2, center.y + height / 2};
-
-    list_add(points, p1);
-    list_add(points, p2);
-    list_add(points, p3);
-    list_add(points, p4);
-
-    return points;
-}
-
 /**
  * Makes list of arrow vertices
  * 
@@ -349,10 +325,13 @@ list_t *make_arrow(vector_t center, double width, double height) {
  */
 
 void add_ball(state_t *state, vector_t ball_position) {
-  list_t *ball_shape = make_circle(ball_position, BALL_RADIUS);
-  body_t *ball = body_init_with_info(ball_shape, BALL_MASS, BALL_WHITE,
-                          make_type_info(BALL), free);
+  body_t *ball = body_init_circle_with_info(ball_position, BALL_RADIUS,
+                          BALL_MASS, BALL_WHITE, make_type_info(BALL), free);
   body_set_velocity(ball, VEC_ZERO);
+  // at MAX_SPEED the ball moves further than the outer walls are thick in a
+  // single frame
+  body_set_ccd(ball, true);
+  set_type_category(ball);
   scene_add_body(state->scene, ball);
 
   asset_t *ball_asset = asset_make_image_with_body(BALL_PATH, ball);
@@ -367,9 +346,10 @@ void add_ball(state_t *state, vector_t ball_position) {
  * @param hole_position of hole
  */
 void add_hole(state_t *state, vector_t hole_position) {
-  list_t *hole_shape = make_circle(hole_position, HOLE_RADIUS);
-  body_t *hole = body_init_with_info(hole_shape, INFINITY, HOLE_DARK,
-                make_type_info(HOLE), free);
+  body_t *hole = body_init_circle_with_info(hole_position, HOLE_RADIUS,
+                INFINITY, HOLE_DARK, make_type_info(HOLE), free);
+  set_type_category(hole);
+  body_set_sensor(hole, true);
   scene_add_body(state->scene, hole);
 
   asset_t *hole_asset = asset_make_image_with_body(HOLE_PATH, hole);
@@ -384,9 +364,9 @@ void add_hole(state_t *state, vector_t hole_position) {
  * @param hole_position of hole where it will render on.
  */
 void add_pole(state_t *state, vector_t hole_position) {
-    list_t *pole_shape = make_rectangle((vector_t){hole_position.x, hole_position.y
-                                        + (POLE_HEIGHT /2)}, POLE_WIDTH, POLE_HEIGHT);
-    body_t *pole = body_init_with_info(pole_shape, INFINITY, BALL_WHITE, 
+    vector_t pole_center = {hole_position.x, hole_position.y + (POLE_HEIGHT /2)};
+    body_t *pole = body_init_box_with_info(pole_center, POLE_WIDTH, POLE_HEIGHT,
+                                        INFINITY, BALL_WHITE,
                                         make_type_info(POLE), free);
     scene_add_body(state->scene, pole);
 
@@ -453,10 +433,10 @@ vector_t get_random_translating_obstacle_position(state_t *state) {
 
 body_t *add_rotating_obstacle(state_t *state) {
   vector_t position = state->rotating_obstacle_position;
-  list_t *rotating_obstacle_shape = make_rectangle(position, ROTATING_OBSTACLE_WIDTH,
-            ROTATING_OBSTACLE_HEIGHT);
-  body_t *rotating_obstacle = body_init_with_info(rotating_obstacle_shape, INFINITY,
+  body_t *rotating_obstacle = body_init_box_with_info(position,
+            ROTATING_OBSTACLE_WIDTH, ROTATING_OBSTACLE_HEIGHT, INFINITY,
             BALL_WHITE, make_type_info(OBSTACLE), free);
+  set_type_category(rotating_obstacle);
   scene_add_body(state->scene, rotating_obstacle);
   return rotating_obstacle;
 }
@@ -482,7 +462,10 @@ body_t *add_arrow(state_t *state, bool arrow_points_left) {
     body_t *arrow = body_init_with_info(arrow_shape, INFINITY, BLACK, 
               make_type_info(ARROW), free);
     if (arrow_points_left) {
-      polygon_rotate(body_get_polygon(arrow), M_PI, position);
+      // turn the arrow around position
+      vector_t offset = vec_subtract(body_get_centroid(arrow), position);
+      body_set_rotation(arrow, M_PI);
+      body_set_centroid(arrow, vec_add(position, vec_rotate(offset, M_PI)));
     }
     scene_add_body(state->scene, arrow);
     return arrow;
@@ -495,11 +478,11 @@ body_t *add_arrow(state_t *state, bool arrow_points_left) {
  */
 void add_translating_obstacle(state_t *state) {
   vector_t position = get_random_translating_obstacle_position(state);
-  list_t *translating_obstacle_shape = make_rectangle(position, 
-          TRANSLATING_OBSTACLE_WIDTH, TRANSLATING_OBSTACLE_HEIGHT);
-  body_t *translating_obstacle = body_init_with_info(translating_obstacle_shape, INFINITY,
+  body_t *translating_obstacle = body_init_box_with_info(position,
+          TRANSLATING_OBSTACLE_WIDTH, TRANSLATING_OBSTACLE_HEIGHT, INFINITY,
           BALL_WHITE, make_type_info(OBSTACLE), free);
   body_set_velocity(translating_obstacle, TRANSLATING_OBSTACLE_VELOCITY);
+  set_type_category(translating_obstacle);
   scene_add_body(state->scene, translating_obstacle);
   
   asset_t *translating_obstacle_asset = 
@@ -796,14 +779,13 @@ void round_vel(body_t *body) {
  * @param height of wall
  */
 void make_wall(state_t *state, vector_t center, double width, double height) {
-  list_t *wall_pts = make_rectangle(center, width, height);
-  body_t *wall = body_init_with_info(wall_pts, INFINITY, WALL_GRAY,
-      make_type_info(WALL), free);
+  body_t *wall = body_init_box_with_info(center, width, height, INFINITY,
+      WALL_GRAY, make_type_info(WALL), free);
+  set_type_category(wall);
   scene_add_body(state->scene, wall);
 
   asset_t *wall_asset = asset_make_image_with_body(WALL_PATH, wall);
   list_add(state->body_assets, wall_asset);
-  create_physics_collision(state->scene, asset_get_body(state->ball), wall, ELASTICITY);
 }
 
 /**
@@ -870,9 +852,9 @@ empty_corners_t add_random_walls(state_t *state) {
 void add_bouncy_circle(state_t *state) {
   vector_t loc = get_random_bouncy_circle();
 
-  list_t *circle_shape = make_circle(loc, BOUNCY_CIRCLE_RADIUS);
-  body_t *circle = body_init_with_info(circle_shape, INFINITY, 
-      BOUNCY_CIRCLE_ORANGE, make_type_info(BOUNCY), free);
+  body_t *circle = body_init_circle_with_info(loc, BOUNCY_CIRCLE_RADIUS,
+      INFINITY, BOUNCY_CIRCLE_ORANGE, make_type_info(BOUNCY), free);
+  set_type_category(circle);
   scene_add_body(state->scene, circle);
 
   asset_t *circle_asset = asset_make_image_with_body(BOUNCY_CIRCLE_PATH,
@@ -1025,6 +1007,22 @@ void end_hole(body_t *body1, body_t *body2, vector_t axis, void *aux,
    add_game_texts(state);
 }
 
+/**
+ * Sensor handler, which ends the hole once the ball reaches it
+ * 
+ * @param sensor
+ * @param body which entered or left the sensor
+ * @param event 
+ * @param state
+ */
+void on_sensor(body_t *sensor, body_t *body, sensor_event_t event,
+               state_t *state) {
+  if (event == SENSOR_ENTER && get_type(sensor) == HOLE &&
+      get_type(body) == BALL) {
+    end_hole(body, sensor, VEC_ZERO, state, ELASTICITY);
+  }
+}
+
 /**
  * Add forces between bodies
  * 
@@ -1035,60 +1033,16 @@ void add_force_creators(state_t *state) {
               asset_get_body(state->up_ramp), RAMP_SLOPE);
   create_ramp_collision(state->scene, asset_get_body(state->ball), 
               asset_get_body(state->down_ramp), -RAMP_SLOPE);
-  create_drag(state->scene, 5.0, asset_get_body(state->ball));
-  body_t *ball = asset_get_body(state->ball);
-   for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-     body_t *body = scene_get_body(state->scene, i);
-     switch (get_type(body)) {
-     case BALL: 
-       break; 
-     case POLE: 
-       break;
-     case OBSTACLE: 
-       create_physics_collision(state->scene, ball, body, ELASTICITY);
-       break;
-     case HOLE:
-       create_collision(state->scene, ball, body, (collision_handler_t) end_hole, state,
-       ELASTICITY);
-       break;
-     case BOUNCY:
-        create_physics_collision(state->scene, body, asset_get_body(state->ball),
-            BOUNCY_CIRCLE_ELASTICITY);
-        break;
-     case WALL:
-        break;
-     default:
-       break;
-     }
-   }
+  create_drag_field(state->scene, 5.0, 0, is_ball, NULL);
+  // walls and obstacles come and go between holes, so the ball collides with
+  // them by category rather than one registered pair at a time
+  create_physics_rule(state->scene, type_category(BALL),
+      type_category(WALL) | type_category(OBSTACLE), ELASTICITY);
+  create_physics_rule(state->scene, type_category(BOUNCY), type_category(BALL),
+      BOUNCY_CIRCLE_ELASTICITY);
+  scene_set_sensor_handler(state->scene, (sensor_handler_t) on_sensor, state);
 }
 
-/**
- * Check for collision between ball and hole
- * 
- * @param state
- */
-void check_collisions(state_t *state) {
-  body_t *ball = asset_get_body(state->ball);
-  vector_t ball_center = body_get_centroid(ball);
-  size_t bodies = scene_bodies(state->scene);
-
-  for (size_t i = 0; i < bodies; i++) {
-    body_t *body_i = scene_get_body(state->scene, i);
-    if (get_type(body_i) != BALL) {
-      if (get_type(body_i) == HOLE) {
-        vector_t body_center = body_get_centroid(body_i);
-        vector_t displacement = vec_subtract(ball_center, body_center);
-        double distance = sqrt((displacement.x * displacement.x) +
-                             (displacement.y * displacement.y));
-        if (distance < BALL_RADIUS) {
-          end_hole(ball, asset_get_body(state->hole), VEC_ZERO, state, ELASTICITY); 
-        }
-      }
-    }
-  }
-}  
-
 /**
  * 
  * Create the up or down ramps
@@ -1100,9 +1054,8 @@ void check_collisions(state_t *state) {
 void add_ramp(state_t *state, bool is_up_ramp) { 
   scene_t *scene = state->scene;
   list_t *body_assets = state->body_assets;
-  list_t *shape = make_rectangle(get_random_ramp_loc(state, is_up_ramp), WIND_MAX.x, 
-        RAMP_HEIGHT);
-  body_t *ramp = body_init_with_info(shape, INFINITY, BOUNCY_CIRCLE_ORANGE, 
+  body_t *ramp = body_init_box_with_info(get_random_ramp_loc(state, is_up_ramp),
+        WIND_MAX.x, RAMP_HEIGHT, INFINITY, BOUNCY_CIRCLE_ORANGE,
         make_type_info(RAMP), free);
 
   scene_add_body(scene, ramp);
@@ -1230,8 +1183,8 @@ bool emscripten_main(state_t *state) {
       update_translating_object(translating_obstacle);
     }
     sdl_draw_polygon(body_get_polygon(state->rotating_obstacle), BALL_WHITE);
-    polygon_rotate(body_get_polygon(state->rotating_obstacle), ROTATION_SPEED, 
-            body_get_centroid(state->rotating_obstacle));
+    body_set_rotation(state->rotating_obstacle,
+            body_get_rotation(state->rotating_obstacle) + ROTATION_SPEED);
 
     if (vec_get_length(body_get_velocity(asset_get_body(state->ball))) <= 
           GOLF_SWING_SPEED_THRESHOLD) {
@@ -1241,20 +1194,14 @@ bool emscripten_main(state_t *state) {
       sdl_draw_polygon(body_get_polygon(state->arrow), BLACK);
     } else {
       if (state->arrow != NULL) {
-        for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-          if (scene_get_body(state->scene, i) == state->arrow) {
-            scene_remove_body(state->scene, i);
-            break;
-          }
-        }
+        body_remove(state->arrow);
         state->arrow = NULL;
       }
     }
   }
   round_vel(asset_get_body(state->ball));
-  check_collisions(state);
   sdl_show();
-  scene_tick(state->scene, dt);
+  scene_advance(state->scene, dt);
   return false;
 }
 
@@ -0,0 +1,113 @@
+#ifndef __AABB_H__
+#define __AABB_H__
+
+#include <stdbool.h>
+
+#include "vector.h"
+
+/**
+ * An axis-aligned bounding box, stored as its lower-left and upper-right
+ * corners. Used by the broad phase to cheaply reject pairs of bodies that
+ * cannot possibly be colliding.
+ */
+typedef struct {
+  vector_t min;
+  vector_t max;
+} aabb_t;
+
+/**
+ * A function called for each candidate pair reported by a broad phase.
+ *
+ * @param data1 the data stored with the first proxy
+ * @param data2 the data stored with the second proxy
+ * @param aux the auxiliary value passed to the query
+ */
+typedef void (*pair_handler_t)(void *data1, void *data2, void *aux);
+
+/**
+ * A function called for each proxy found by a broad phase region query.
+ *
+ * @param data the data stored with the proxy
+ * @param aux the auxiliary value passed to the query
+ */
+typedef void (*proxy_handler_t)(void *data, void *aux);
+
+/**
+ * A function called for each proxy a broad phase ray query passes through.
+ * Rays run from an origin along a displacement, and positions along them are
+ * given as fractions of the displacement.
+ *
+ * @param data the data stored with the proxy
+ * @param aux the auxiliary value passed to the query
+ * @return the fraction to shorten the ray to, so that proxies beyond it are
+ *   skipped, or any larger value (e.g. INFINITY) to leave it as it is
+ */
+typedef double (*ray_handler_t)(void *data, void *aux);
+
+/**
+ * Returns whether two boxes overlap. Boxes that only touch count as
+ * overlapping.
+ *
+ * @param a the first box
+ * @param b the second box
+ * @return whether a and b share at least one point
+ */
+bool aabb_overlap(aabb_t a, aabb_t b);
+
+/**
+ * Returns whether a box entirely contains another box.
+ *
+ * @param outer the containing box
+ * @param inner the contained box
+ * @return whether every point of inner lies in outer
+ */
+bool aabb_contains(aabb_t outer, aabb_t inner);
+
+/**
+ * Returns whether a point lies inside (or on the boundary of) a box.
+ *
+ * @param box the box
+ * @param point the point to test
+ * @return whether the point is inside the box
+ */
+bool aabb_contains_point(aabb_t box, vector_t point);
+
+/**
+ * Finds where a ray first enters a box.
+ *
+ * @param box the box
+ * @param origin the start of the ray
+ * @param delta the displacement from the start of the ray to its end
+ * @return the fraction of delta at which the ray enters the box, 0 if the
+ *   origin is inside it, or INFINITY if the ray misses it
+ */
+double aabb_ray_fraction(aabb_t box, vector_t origin, vector_t delta);
+
+/**
+ * Returns the smallest box containing both of the given boxes.
+ *
+ * @param a the first box
+ * @param b the second box
+ * @return the union of a and b
+ */
+aabb_t aabb_union(aabb_t a, aabb_t b);
+
+/**
+ * Returns a box grown by a margin on every side.
+ *
+ * @param box the box to grow
+ * @param margin the distance to extend each side by
+ * @return the enlarged box
+ */
+aabb_t aabb_fatten(aabb_t box, double margin);
+
+/**
+ * Returns the perimeter of a box, which is the cost metric used when
+ * deciding how to build a bounding volume hierarchy.
+ *
+ * @param box the box
+ * @return the perimeter of the box
+ */
+double aabb_perimeter(aabb_t box);
+
+#endif // #ifndef __AABB_H__
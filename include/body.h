@@ -2,14 +2,20 @@
 #define __BODY_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
+#include "aabb.h"
+#include "body_store.h"
 #include "color.h"
 #include "list.h"
 #include "polygon.h"
 
 /**
  * A rigid body constrained to the plane.
- * Implemented as a polygon with uniform density.
+ * Implemented as a polygon with uniform density. The state that changes
+ * every tick (pose, velocity, forces, mass and flags) lives in a slot of a
+ * body_store_t: the body's own until it is added to a scene, then the
+ * scene's, so the body is a handle to that slot.
  */
 typedef struct body body_t;
 
@@ -36,6 +42,61 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
                             void *info, free_func_t info_freer);
 
+/**
+ * Initializes a circular body without any info.
+ * Acts like body_init_circle_with_info() where info and info_freer are NULL.
+ */
+body_t *body_init_circle(vector_t center, double radius, double mass,
+                         rgb_color_t color);
+
+/**
+ * Allocates memory for a circular body with the given parameters.
+ * Unlike a polygon approximating a circle, the body stores only its center
+ * and radius, and uses the dedicated circle collision tests.
+ * The body is initially at rest.
+ * Asserts that the mass and radius are positive and that the required memory
+ * is allocated.
+ *
+ * @param center the initial center of the body
+ * @param radius the radius of the body
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_circle_with_info(vector_t center, double radius, double mass,
+                                   rgb_color_t color, void *info,
+                                   free_func_t info_freer);
+
+/**
+ * Initializes a rectangular body without any info.
+ * Acts like body_init_box_with_info() where info and info_freer are NULL.
+ */
+body_t *body_init_box(vector_t center, double width, double height,
+                      double mass, rgb_color_t color);
+
+/**
+ * Allocates memory for a rectangular body with the given parameters.
+ * The body stores only its center, half-extents and rotation rather than
+ * its four vertices, and uses the dedicated box collision tests.
+ * The body is initially at rest, with its sides parallel to the axes.
+ * Asserts that the mass, width and height are positive and that the
+ * required memory is allocated.
+ *
+ * @param center the initial center of the body
+ * @param width the length of the body along x
+ * @param height the length of the body along y
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_box_with_info(vector_t center, double width, double height,
+                                double mass, rgb_color_t color, void *info,
+                                free_func_t info_freer);
+
 /**
  * Releases the memory allocated for a body.
  *
@@ -46,6 +107,7 @@ void body_free(body_t *body);
 /**
  * Gets the current shape of a body.
  * Returns a newly allocated vector list, which must be list_free()d.
+ * Circular bodies return a regular polygon approximating them.
  *
  * @param body a pointer to a body returned from body_init()
  * @return the polygon describing the body's current position
@@ -63,6 +125,41 @@ list_t *body_get_shape(body_t *body);
  */
 vector_t body_get_centroid(body_t *body);
 
+/**
+ * Gets the axis-aligned bounding box of a body's current shape.
+ * Unlike body_get_shape(), this does not allocate.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the smallest axis-aligned box containing the body
+ */
+aabb_t body_get_aabb(body_t *body);
+
+/**
+ * Returns whether a point lies inside (or on the boundary of) a body's
+ * current shape.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param point the point to test
+ * @return whether the body contains the point
+ */
+bool body_contains_point(body_t *body, vector_t point);
+
+/**
+ * Gets the net force applied to a body since its last tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the sum of the forces passed to body_add_force()
+ */
+vector_t body_get_force(body_t *body);
+
+/**
+ * Gets the net impulse applied to a body since its last tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the sum of the impulses passed to body_add_impulse()
+ */
+vector_t body_get_impulse(body_t *body);
+
 /**
  * Gets the current velocity of a body.
  *
@@ -87,6 +184,34 @@ rgb_color_t *body_get_color(body_t *body);
  */
 double body_get_rotation(body_t *body);
 
+/**
+ * Gets where a body was when body_save_transform() was last called on it,
+ * which scene_advance() does before each fixed step, so the body can be
+ * drawn between its last two steps.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's center of mass at the start of its last fixed step
+ */
+vector_t body_get_previous_centroid(body_t *body);
+
+/**
+ * Gets a body's rotation angle when body_save_transform() was last called
+ * on it.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's rotation angle in radians at the start of its last
+ *   fixed step
+ */
+double body_get_previous_rotation(body_t *body);
+
+/**
+ * Records a body's current centroid and rotation as its previous ones.
+ * A new body's previous transform is where it was created.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_save_transform(body_t *body);
+
 /**
  * Gets the mass of a body.
  *
@@ -96,7 +221,12 @@ double body_get_rotation(body_t *body);
 double body_get_mass(body_t *body);
 
 /**
- * Gets the polygon object associated with the body
+ * Gets the polygon object associated with the body, moved to the body's
+ * current centroid and rotation.
+ * The polygon only follows the body when it is asked for: moving or
+ * rotating it directly does not move the body, which body_set_centroid()
+ * and body_set_rotation() do.
+ *
  * @param body a pointer to a body returned from body_init()
  * @return a pointer to a polygon_t struct
  */
@@ -110,6 +240,129 @@ polygon_t *body_get_polygon(body_t *body);
  */
 void *body_get_info(body_t *body);
 
+/**
+ * Gets the id of the body's proxy in its scene's broad phase.
+ * The id is assigned by the scene when the body is added,
+ * and is meaningless for a body that is not in a scene.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's broad-phase proxy id
+ */
+size_t body_get_proxy(body_t *body);
+
+/**
+ * Records the id of the body's proxy in its scene's broad phase.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param proxy the proxy id assigned by the broad phase
+ */
+void body_set_proxy(body_t *body, size_t proxy);
+
+/**
+ * Gets the force entries registered with the body's scene that depend on the
+ * body, which the scene keeps so it can free them along with the body.
+ * The list does not own the entries.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the list of force entries that depend on the body
+ */
+list_t *body_get_force_entries(body_t *body);
+
+/**
+ * Moves a body's pose, velocity, forces, mass and flags into a new slot at
+ * the end of a store, which the body's accessors use from then on.
+ * The scene does this when the body is added.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param store the store to move the body's state into
+ */
+void body_attach(body_t *body, body_store_t *store);
+
+/**
+ * Gets the index of a body's slot in its store.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the index of the body's slot
+ */
+size_t body_get_slot(body_t *body);
+
+/**
+ * Moves a body's state to another slot of its store, overwriting that slot,
+ * such as when the store is compacted after bodies are removed.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param slot the index of the slot to move to
+ */
+void body_move_slot(body_t *body, size_t slot);
+
+/**
+ * Sets whether a body uses continuous collision detection.
+ * When it does, the scene stops it at the first body it would hit during a
+ * tick, rather than letting it pass through bodies thinner than the distance
+ * it moves per tick. Only worth enabling on small, fast bodies.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param ccd whether the body uses continuous collision detection
+ */
+void body_set_ccd(body_t *body, bool ccd);
+
+/**
+ * Gets whether a body uses continuous collision detection.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body uses continuous collision detection,
+ *   false unless body_set_ccd() was called
+ */
+bool body_get_ccd(body_t *body);
+
+/**
+ * Sets which collision categories a body belongs to and which it collides
+ * with. The scene's collision rules (see scene_add_collision_rule()) only
+ * pair two bodies if each one's category overlaps the other's mask.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param category the bits of the categories the body belongs to
+ * @param mask the bits of the categories the body may collide with
+ */
+void body_set_collision_filter(body_t *body, uint32_t category,
+                               uint32_t mask);
+
+/**
+ * Gets the collision categories a body belongs to.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the category bits, 0 unless body_set_collision_filter() was called
+ */
+uint32_t body_get_category(body_t *body);
+
+/**
+ * Gets the collision categories a body may collide with.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the mask bits, all set unless body_set_collision_filter() was called
+ */
+uint32_t body_get_mask(body_t *body);
+
+/**
+ * Sets whether a body is a sensor. A sensor detects the bodies that overlap
+ * it without pushing them: the scene never solves contacts involving it, and
+ * instead reports when bodies start and stop overlapping it (see
+ * scene_set_sensor_handler()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param sensor whether the body is a sensor
+ */
+void body_set_sensor(body_t *body, bool sensor);
+
+/**
+ * Gets whether a body is a sensor.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is a sensor, false unless body_set_sensor() was
+ *   called
+ */
+bool body_is_sensor(body_t *body);
+
 /**
  * Sets the display color of a body.
  *
@@ -158,6 +411,45 @@ void body_set_rotation(body_t *body, double angle);
  */
 void body_tick(body_t *body, double dt);
 
+/**
+ * Updates the body like body_tick(), but with symplectic (semi-implicit)
+ * Euler: the velocity is updated first and the body is translated at its
+ * new velocity. This is the cheapest scheme, and it keeps the energy of
+ * orbits and oscillators bounded instead of letting it drift.
+ *
+ * @param body the body to tick
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_tick_symplectic_euler(body_t *body, double dt);
+
+/**
+ * Updates the body like body_tick(), but with velocity Verlet, which is
+ * symplectic and second-order accurate.
+ * The body is translated by v dt + a dt^2 / 2 for its acceleration a.
+ * Its new velocity assumes the acceleration stays the same over the tick,
+ * and is corrected at the start of the next tick with the acceleration the
+ * body actually has then.
+ *
+ * @param body the body to tick
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_tick_velocity_verlet(body_t *body, double dt);
+
+/**
+ * Updates the body over a tick with given constant accelerations, for
+ * integrators that compute their own: the body is translated by
+ * v dt + position_acceleration dt^2 / 2, and its velocity changes by
+ * velocity_acceleration dt. Impulses are applied before the tick.
+ * The forces on the body are ignored and reset.
+ *
+ * @param body the body to tick
+ * @param dt the number of seconds elapsed since the last tick
+ * @param position_acceleration the acceleration to translate the body with
+ * @param velocity_acceleration the acceleration to change the velocity with
+ */
+void body_advance(body_t *body, double dt, vector_t position_acceleration,
+                  vector_t velocity_acceleration);
+
 /**
  * Applies a force to a body over the current tick.
  * If multiple forces are applied in the same tick, they should be added.
@@ -180,6 +472,16 @@ void body_add_force(body_t *body, vector_t force);
  */
 void body_add_impulse(body_t *body, vector_t impulse);
 
+/**
+ * Gets the velocity a body will have after its next tick, given the forces
+ * and impulses applied to it so far this tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param dt the number of seconds the next tick will last
+ * @return the velocity body_tick() will leave the body with
+ */
+vector_t body_get_next_velocity(body_t *body, double dt);
+
 /**
  * Clear the forces and impulses on the body.
  *
@@ -0,0 +1,177 @@
+#ifndef __BODY_STORE_H__
+#define __BODY_STORE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+/**
+ * Bits of a body's flags in a body store.
+ */
+typedef enum {
+  /** The body has been marked for removal by body_remove() */
+  BODY_REMOVED = 1 << 0,
+  /** The body is swept by continuous collision detection */
+  BODY_CCD = 1 << 1,
+  /** The body only reports collisions, see body_set_sensor() */
+  BODY_SENSOR = 1 << 2,
+} body_flag_t;
+
+/**
+ * The state of many bodies that changes every tick, stored as a structure of
+ * arrays: slot i of each array belongs to the same body. Integration and
+ * force fields stream through these arrays instead of visiting each body.
+ *
+ * A scene keeps its bodies in one store, in the same order as the bodies,
+ * and a body_t is a handle to its slot. The arrays are public so the scene
+ * can loop over them directly; use the body.h accessors on a single body.
+ */
+typedef struct body_store {
+  // the pose of each body; its polygon is moved to match when it is needed
+  vector_t *centroids;
+  double *rotations;
+  vector_t *velocities;
+  // the net force and impulse applied since the last tick
+  vector_t *forces;
+  vector_t *impulses;
+  double *masses;
+  // 0 for a body with infinite mass
+  double *inverse_masses;
+  // bitwise ors of body_flag_t
+  uint8_t *flags;
+  // the pose saved by body_store_save_transforms()
+  vector_t *prev_centroids;
+  double *prev_rotations;
+  // the length of the last tick, and the velocity and acceleration at its
+  // start, which the Simpson and velocity Verlet kernels build on
+  double *prev_dts;
+  vector_t *prev_velocities;
+  vector_t *prev_accelerations;
+  size_t size;
+  size_t capacity;
+} body_store_t;
+
+/**
+ * Allocates memory for an empty body store.
+ * Asserts that the required memory was allocated.
+ *
+ * @param initial_capacity the number of bodies to allocate space for
+ * @return a pointer to the newly allocated store
+ */
+body_store_t *body_store_init(size_t initial_capacity);
+
+/**
+ * Releases the memory allocated for a body store.
+ * Does not free the bodies whose state it holds.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_free(body_store_t *store);
+
+/**
+ * Adds a slot, at rest at the origin with no forces, mass or flags, to the
+ * end of a body store, growing the store if needed.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @return the index of the new slot
+ */
+size_t body_store_add(body_store_t *store);
+
+/**
+ * Copies one slot of a body store over another.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param from the index of the slot to copy
+ * @param to the index of the slot to overwrite
+ */
+void body_store_move(body_store_t *store, size_t from, size_t to);
+
+/**
+ * Copies a slot of one body store over a slot of another.
+ *
+ * @param store a pointer to the store to copy into
+ * @param slot the index of the slot to overwrite
+ * @param from a pointer to the store to copy from
+ * @param from_slot the index of the slot to copy
+ */
+void body_store_copy(body_store_t *store, size_t slot, body_store_t *from,
+                     size_t from_slot);
+
+/**
+ * Drops the slots at the end of a body store.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param size the number of slots to keep; at most the store's size
+ */
+void body_store_truncate(body_store_t *store, size_t size);
+
+/**
+ * Clears the forces and impulses of every slot in a body store.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_reset(body_store_t *store);
+
+/**
+ * Records the current pose of every slot in a body store as its previous
+ * one, see body_save_transform().
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_save_transforms(body_store_t *store);
+
+/**
+ * Ticks the slots begin to end - 1 of a body store with Simpson's rule, see
+ * body_tick(). Like each kernel below, the slots' forces and impulses are
+ * used up and reset, and their polygons are not touched.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param begin the index of the first slot to tick
+ * @param end one past the index of the last slot to tick
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_store_tick(body_store_t *store, size_t begin, size_t end, double dt);
+
+/**
+ * Ticks slots of a body store with symplectic Euler, see
+ * body_tick_symplectic_euler().
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param begin the index of the first slot to tick
+ * @param end one past the index of the last slot to tick
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_store_tick_symplectic_euler(body_store_t *store, size_t begin,
+                                      size_t end, double dt);
+
+/**
+ * Ticks slots of a body store with velocity Verlet, see
+ * body_tick_velocity_verlet().
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param begin the index of the first slot to tick
+ * @param end one past the index of the last slot to tick
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_store_tick_velocity_verlet(body_store_t *store, size_t begin,
+                                     size_t end, double dt);
+
+/**
+ * Ticks slots of a body store with given constant accelerations, see
+ * body_advance().
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param begin the index of the first slot to tick
+ * @param end one past the index of the last slot to tick
+ * @param dt the number of seconds elapsed since the last tick
+ * @param position_accelerations the acceleration to translate each slot
+ *   with; slot begin + i's is at index i
+ * @param velocity_accelerations the acceleration to change each slot's
+ *   velocity with, indexed like position_accelerations
+ */
+void body_store_advance(body_store_t *store, size_t begin, size_t end,
+                        double dt, const vector_t *position_accelerations,
+                        const vector_t *velocity_accelerations);
+
+#endif // #ifndef __BODY_STORE_H__
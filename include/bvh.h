@@ -0,0 +1,125 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "aabb.h"
+
+/**
+ * A dynamic bounding volume hierarchy: a binary tree of bounding boxes
+ * whose leaves are proxies (usually bodies).
+ * Each leaf stores a "fat" box, its proxy's box grown by a margin, so a proxy
+ * that moves a little stays inside its leaf and the tree is left alone.
+ * Leaves are inserted next to the sibling that grows the tree's total
+ * perimeter the least, and the tree is rebalanced by rotations on the way
+ * back up, so its height stays logarithmic in the number of proxies.
+ *
+ * Suited to level geometry: proxies that rarely or never move, queried by
+ * the few proxies that do.
+ */
+typedef struct bvh bvh_t;
+
+/**
+ * Allocates memory for an empty tree.
+ * Asserts that the required memory was allocated.
+ *
+ * @param margin how far to grow each proxy's box on every side
+ * @return a pointer to the newly allocated tree
+ */
+bvh_t *bvh_init(double margin);
+
+/**
+ * Releases the memory allocated for a tree.
+ * Does not free the data stored with the proxies.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ */
+void bvh_free(bvh_t *tree);
+
+/**
+ * Gets the number of proxies in a tree.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @return the number of proxies inserted and not yet removed
+ */
+size_t bvh_size(bvh_t *tree);
+
+/**
+ * Gets the height of a tree, i.e. the number of boxes tested on the longest
+ * path from the root to a leaf.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @return the height of the tree, or 0 if it is empty
+ */
+size_t bvh_height(bvh_t *tree);
+
+/**
+ * Adds a proxy to the tree.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @param data the value reported for this proxy by queries
+ * @param box the bounding box of the proxy
+ * @return an id identifying the proxy in later calls
+ */
+size_t bvh_insert(bvh_t *tree, void *data, aabb_t box);
+
+/**
+ * Removes a proxy from the tree.
+ * The id may be reused by a later bvh_insert().
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @param proxy an id returned from bvh_insert()
+ */
+void bvh_remove(bvh_t *tree, size_t proxy);
+
+/**
+ * Changes the bounding box of a proxy.
+ * The tree is only restructured if the new box leaves the proxy's fat box,
+ * or is much smaller than it.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @param proxy an id returned from bvh_insert()
+ * @param box the new bounding box of the proxy
+ * @return whether the proxy was reinserted
+ */
+bool bvh_move(bvh_t *tree, size_t proxy, aabb_t box);
+
+/**
+ * Gets the fat box stored for a proxy.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @param proxy an id returned from bvh_insert()
+ * @return a box containing the proxy's box, grown by up to a few margins
+ */
+aabb_t bvh_get_fat_aabb(bvh_t *tree, size_t proxy);
+
+/**
+ * Calls a handler on every proxy whose fat box overlaps a box.
+ * The handler must not insert, remove, or move proxies.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @param box the region to search
+ * @param handler the function to call on the data of each proxy found
+ * @param aux an auxiliary value to pass to handler
+ */
+void bvh_query(bvh_t *tree, aabb_t box, proxy_handler_t handler, void *aux);
+
+/**
+ * Calls a handler on every proxy whose fat box a ray passes through, or
+ * comes within a radius of. Subtrees the ray only reaches beyond the
+ * fraction returned by the handler are skipped.
+ * The handler must not insert, remove, or move proxies.
+ *
+ * @param tree a pointer to a tree returned from bvh_init()
+ * @param origin the start of the ray
+ * @param delta the displacement from the start of the ray to its end
+ * @param radius how far from the ray a box may be and still be reported,
+ *   0 for a thin ray
+ * @param handler the function to call on the data of each proxy found
+ * @param aux an auxiliary value to pass to handler
+ */
+void bvh_raycast(bvh_t *tree, vector_t origin, vector_t delta, double radius,
+                 ray_handler_t handler, void *aux);
+
+#endif // #ifndef __BVH_H__
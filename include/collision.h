@@ -20,10 +20,130 @@ typedef struct {
    * If collided is false, this value is undefined.
    */
   vector_t axis;
+  /**
+   * If the shapes are colliding, how far they overlap along the axis,
+   * i.e. how far one would have to move along it to separate them.
+   * If collided is false, this value is undefined.
+   */
+  double depth;
 } collision_info_t;
 
+/**
+ * Where two colliding bodies touch: up to two contact points sharing a
+ * normal. Two points are found when an edge of one body rests against an
+ * edge of the other, so the pair can be pushed apart without spinning.
+ */
+typedef struct {
+  /** The number of contact points, 1 or 2 */
+  size_t num_points;
+  /** The contact points, on the surface of the body penetrating the other */
+  vector_t points[2];
+  /** How far each contact point has penetrated the other body */
+  double depths[2];
+  /** A unit vector pointing from the first body towards the second */
+  vector_t normal;
+  /** How far the bodies overlap along the normal */
+  double depth;
+} contact_manifold_t;
+
+/**
+ * Where a ray, or a circle moving in a straight line, first touches a body.
+ */
+typedef struct {
+  /** Whether the cast touches the body */
+  bool hit;
+  /**
+   * The fraction of the cast's displacement, between 0 and 1, travelled
+   * before it touches the body. If hit is false, this value is undefined.
+   */
+  double fraction;
+  /**
+   * The point on the body's surface that is touched.
+   * If hit is false, this value is undefined.
+   */
+  vector_t point;
+  /**
+   * The body's unit outward normal at the point.
+   * If hit is false, this value is undefined.
+   */
+  vector_t normal;
+} cast_info_t;
+
+/**
+ * The algorithms that can be used to test a pair of bodies for collision.
+ */
+typedef enum {
+  /** The separating axis test, see find_collision() (the default). */
+  NARROW_PHASE_SAT,
+  /** GJK with EPA for the penetration, see find_collision_gjk(). */
+  NARROW_PHASE_GJK,
+} narrow_phase_t;
+
+/**
+ * A function called when a collision occurs.
+ * @param body1 the first body passed to create_collision(), or the body in
+ *   the first category of a collision rule
+ * @param body2 the second body
+ * @param axis a unit vector pointing from body1 towards body2
+ *   that defines the direction the two bodies are colliding in
+ * @param aux the auxiliary value the collision was registered with
+ * @param force_const the force constant the collision was registered with
+ */
+typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
+                                    void *aux, double force_const);
+
+/**
+ * The simplex GJK finished with on a previous call, kept between ticks to
+ * warm-start the next test of the same pair of bodies.
+ * Each simplex point is stored as the indices of the two vertices whose
+ * difference it is, so the simplex follows the bodies as they move.
+ * A zero-initialized cache is empty.
+ */
+typedef struct {
+  size_t num_points;
+  size_t index1[3];
+  size_t index2[3];
+} gjk_cache_t;
+
+/**
+ * The separating axis SAT found on a previous call, kept between ticks so it
+ * can be tested first on the next test of the same pair of bodies.
+ * The axis is stored as an edge index, so it follows the bodies as they
+ * rotate. A zero-initialized cache is empty.
+ */
+typedef struct {
+  /** Whether the bodies were separated on the previous call */
+  bool separated;
+  /** 0 if the separating edge belongs to body1, 1 if to body2 */
+  size_t axis_body;
+  /** The index of the separating edge */
+  size_t axis_edge;
+} sat_cache_t;
+
+/**
+ * What the narrow phase and contact solver remember about a pair of bodies
+ * between ticks.
+ * A zero-initialized cache is empty.
+ */
+typedef struct {
+  gjk_cache_t simplex;
+  sat_cache_t axis;
+  /**
+   * The normal impulse applied at each contact point on the previous tick,
+   * which the scene's contact solver starts from on the next. Zero while the
+   * bodies are apart.
+   */
+  double impulses[2];
+} collision_cache_t;
+
 /**
  * Computes the status of the collision between two bodies.
+ * Convex polygons are tested with the separating axis theorem. Boxes only
+ * contribute their two face axes, and are projected onto an axis from their
+ * center and half-extents, so a pair of boxes takes four axes in constant
+ * time. Circles are tested analytically, against circles and boxes in
+ * constant time and against polygons in time linear in the polygon's number
+ * of edges.
  *
  * @param body1 the first body
  * @param body2 the second body
@@ -32,4 +152,114 @@ typedef struct {
  */
 collision_info_t find_collision(body_t *body1, body_t *body2);
 
+/**
+ * Computes the status of the collision between two bodies like
+ * find_collision(), but first tests the axis that separated them on the
+ * previous call, returning as soon as it still does.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param cache if non-NULL, the result of the previous call on the same pair
+ *   of bodies, which is updated for the next call
+ * @return the same result as find_collision()
+ */
+collision_info_t find_collision_sat(body_t *body1, body_t *body2,
+                                    sat_cache_t *cache);
+
+/**
+ * Computes the status of the collision between two convex bodies using
+ * GJK on their Minkowski difference, followed by EPA to find the axis and
+ * depth of the overlap if they are colliding.
+ * Runs in time linear in the total number of vertices per iteration,
+ * rather than the product of the vertex counts.
+ * Pairs involving a circle, and pairs of boxes, use the same dedicated tests
+ * as find_collision().
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param cache if non-NULL, the simplex from the previous call on the same
+ *   pair of bodies, which is used as the starting point and then replaced
+ * @return the same result as find_collision(). The axis is a unit vector
+ *   pointing from body1 towards body2.
+ */
+collision_info_t find_collision_gjk(body_t *body1, body_t *body2,
+                                    gjk_cache_t *cache);
+
+/**
+ * Computes the status of the collision between two bodies with a given
+ * narrow phase.
+ *
+ * @param narrow_phase the algorithm to use
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param cache if non-NULL, what the narrow phase remembers about the pair
+ *   of bodies from previous calls
+ * @return the result of find_collision_sat() or find_collision_gjk()
+ */
+collision_info_t find_collision_with(narrow_phase_t narrow_phase,
+                                     body_t *body1, body_t *body2,
+                                     collision_cache_t *cache);
+
+/**
+ * Finds the contact points of two colliding bodies. Of the two edges facing
+ * each other across the collision axis, the one most perpendicular to the
+ * axis is the reference edge, and the other is clipped to its extent.
+ * Pairs involving a circle have a single contact point.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param info the result of find_collision() or another narrow phase on the
+ *   same bodies, which must have collided
+ * @return the contact manifold, whose normal is info's axis
+ */
+contact_manifold_t find_contact_manifold(body_t *body1, body_t *body2,
+                                         collision_info_t info);
+
+/**
+ * Computes when two bodies moving in straight lines first touch, so that a
+ * fast body can be stopped at the surface of another rather than passing
+ * through it between ticks. Rotation over the interval is ignored.
+ * Polygons and boxes are swept exactly, separating axis by separating axis,
+ * and a circle is cast exactly at a polygon's faces and corners.
+ * Bodies already colliding at the start of the interval touch at once if
+ * their motion drives them further into each other.
+ *
+ * @param body1 the first body
+ * @param motion1 how far body1 moves over the interval
+ * @param body2 the second body
+ * @param motion2 how far body2 moves over the interval
+ * @return the fraction of the interval, between 0 and 1, after which the
+ *   bodies first touch, or INFINITY if they do not touch during it or are
+ *   already colliding and moving apart
+ */
+double find_time_of_impact(body_t *body1, vector_t motion1, body_t *body2,
+                           vector_t motion2);
+
+/**
+ * Computes where a ray first enters a body. Polygons and boxes are tested
+ * edge by edge, in time linear in their number of edges, and circles
+ * analytically. A ray starting inside the body does not hit it.
+ *
+ * @param body the body to cast at
+ * @param origin the start of the ray
+ * @param delta the displacement from the start of the ray to its end
+ * @return where the ray first touches the body, if it does
+ */
+cast_info_t find_raycast(body_t *body, vector_t origin, vector_t delta);
+
+/**
+ * Computes where a circle moving in a straight line first touches a body,
+ * like find_raycast() for a ray with thickness. Against a polygon or box,
+ * the circle is tested against each edge and each corner.
+ * A circle already touching the body at its start does not hit it.
+ *
+ * @param body the body to cast at
+ * @param origin the center of the circle at the start of the cast
+ * @param radius the radius of the circle
+ * @param delta the displacement of the circle's center over the cast
+ * @return where the circle first touches the body, if it does
+ */
+cast_info_t find_shapecast(body_t *body, vector_t origin, double radius,
+                           vector_t delta);
+
 #endif // #ifndef __COLLISION_H__
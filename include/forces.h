@@ -3,6 +3,7 @@
 
 #include "collision.h"
 #include "scene.h"
+#include "springs.h"
 
 /**
  * Defines a type for a force entry structure.
@@ -11,6 +12,29 @@ typedef struct force_entry {
   force_creator_t force_creator;
   void *aux;
   list_t *bodies;
+  // whether this entry resolves a collision between its two bodies, in which
+  // case the scene only runs it when the broad phase reports the pair
+  bool is_collision;
+  // the scene tick on which the entry was last run as a collision
+  size_t last_tick;
+  // frees aux, or NULL if the entry does not own aux
+  free_func_t aux_freer;
+  // if not NULL, the entry is a force solver, run with solver instead of
+  // force_creator after the force creators
+  force_solver_t solver;
+  // whether scene_remove_force() has been called on the entry, which the
+  // scene then frees at the start of its next tick
+  bool removed;
+  // the entry's handle in its scene, which finds its index in O(1)
+  force_handle_t handle;
+  // whether a collision rule or sensor generated the entry, in which case
+  // its scene keeps it at rule_index in its rule entries instead of among
+  // its force creators, and it has no handle
+  bool generated;
+  size_t rule_index;
+  // the entry's index in its scene's collisions run last tick, while it is
+  // one of them
+  size_t active_index;
 } force_entry_t;
 
 /**
@@ -21,18 +45,6 @@ typedef struct body_aux {
   list_t *bodies;
 } body_aux_t;
 
-/**
- * A function called when a collision occurs.
- * @param body1 the first body passed to create_collision()
- * @param body2 the second body passed to create_collision()
- * @param axis a unit vector pointing from body1 towards body2
- *   that defines the direction the two bodies are colliding in
- * @param aux the auxiliary value passed to create_collision()
- * @param force_const the force constant passed to create_collision()
- */
-typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
-                                    void *aux, double force_const);
-
 /**
  * Adds a force creator to a scene that applies impulses
  * between the ramp and ball. One of the bodies should be the ramp.
@@ -135,6 +147,22 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       double force_const);
 
+/**
+ * Makes every pair of bodies in two collision categories call a given
+ * collision handler each time they collide, like create_collision() does for
+ * a single pair. See scene_add_collision_rule().
+ *
+ * @param scene the scene containing the bodies
+ * @param category1 the categories of the first body passed to the handler
+ * @param category2 the categories of the second body passed to the handler
+ * @param handler a function to call whenever the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param force_const a constant to pass to the handler
+ */
+void create_collision_rule(scene_t *scene, uint32_t category1,
+                           uint32_t category2, collision_handler_t handler,
+                           void *aux, double force_const);
+
 /**
  * Adds a force creator to a scene that destroys two bodies when they collide.
  * The bodies should be destroyed by calling body_remove().
@@ -148,8 +176,13 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
 void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
 
 /**
- * The collision handler for for physics collisions. Applies impulses to
- * bodies according to the elasticity in `aux`.
+ * The collision handler for physics collisions. Applies impulses to
+ * bodies according to the elasticity in `force_const`.
+ * This applies a single impulse when the bodies first collide, so it can be
+ * passed to create_collision().
+ *
+ * @deprecated Use create_physics_collision() instead
+ * so the scene's contact solver resolves the collision
  */
 void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
                                void *aux, double force_const);
@@ -157,13 +190,11 @@ void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
 /**
  * Adds a force creator to a scene that applies impulses
  * to resolve collisions between two bodies in the scene.
- * This should be represented as an on-collision callback
- * registered with create_collision().
- *
- * You may remember from project01 that you should avoid applying impulses
- * multiple times while the bodies are still colliding.
- * You should also have a special case that allows either body1 or body2
- * to have mass INFINITY, as this is useful for simulating walls.
+ * Every tick the bodies overlap, their contact is reported to the scene with
+ * scene_add_contact(), and the scene's contact solver applies the impulses
+ * together with those of every other contact, then pushes the bodies apart.
+ * Either body1 or body2 may have mass INFINITY, which is useful for
+ * simulating walls.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
@@ -174,6 +205,19 @@ void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
 void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
                               double elasticity);
 
+/**
+ * Makes every pair of bodies in two collision categories resolve their
+ * collisions like create_physics_collision() does for a single pair.
+ * See scene_add_collision_rule().
+ *
+ * @param scene the scene containing the bodies
+ * @param category1 the categories of one of the bodies
+ * @param category2 the categories of the other body
+ * @param elasticity the "coefficient of restitution" of the collisions
+ */
+void create_physics_rule(scene_t *scene, uint32_t category1,
+                         uint32_t category2, double elasticity);
+
 /**
  * Initializes a force entry with a specified force creator function and
  * auxiliary data.
@@ -188,7 +232,47 @@ force_entry_t *force_entry_init(force_creator_t force_creator, void *aux,
                                 list_t *bodies);
 
 /**
- * Releases the memory allocated for a force entry.
+ * Initializes the force entry of a collision between two bodies, as
+ * create_collision() or create_physics_collision() would register it,
+ * without adding it to the scene. Used by the scene for the pairs its
+ * collision rules generate.
+ *
+ * @param scene the scene containing the bodies
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler a function to call when the bodies first collide, or NULL
+ * @param aux an auxiliary value to pass to the handler
+ * @param force_const a constant to pass to the handler, which is also the
+ *   elasticity if the entry resolves contacts
+ * @param resolves_contact whether the scene's contact solver should keep the
+ *   bodies apart
+ * @return the new entry, to be freed with force_free()
+ */
+force_entry_t *collision_entry_init(scene_t *scene, body_t *body1,
+                                    body_t *body2, collision_handler_t handler,
+                                    void *aux, double force_const,
+                                    bool resolves_contact);
+
+/**
+ * Initializes the force entry that watches a body overlapping a sensor,
+ * without adding it to the scene. Each time it runs, it tests whether the
+ * bodies overlap and calls the handler when that changes.
+ * Used by the scene for the pairs its broad phase finds.
+ *
+ * @param scene the scene containing the bodies
+ * @param sensor a body for which body_is_sensor() is true
+ * @param body the other body
+ * @param handler the function to call when the bodies start or stop
+ *   overlapping, or NULL
+ * @param aux an auxiliary value to pass to the handler
+ * @return the new entry, to be freed with force_free()
+ */
+force_entry_t *sensor_entry_init(scene_t *scene, body_t *sensor, body_t *body,
+                                 sensor_handler_t handler, void *aux);
+
+/**
+ * Releases the memory allocated for a force entry, and its auxiliary value
+ * if the entry has a freer for it.
  *
  * @param entry The force entry to be freed.
  */
@@ -230,6 +314,27 @@ force_creator_t forces_get_force_creator(force_entry_t *entry);
 void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
                               body_t *body2);
 
+/**
+ * Adds a force creator to a scene that applies Newtonian gravity between
+ * every pair of bodies, like create_newtonian_gravity() on each pair but
+ * with a single force creator. Each tick it builds a Barnes-Hut quadtree
+ * (see quadtree.h) over the bodies, so a tick takes O(n log n) time instead
+ * of O(n^2), approximating the pull of distant clusters of bodies.
+ * Bodies with infinite mass neither pull nor are pulled,
+ * and bodies closer than create_newtonian_gravity()'s cutoff do not attract.
+ * Bodies added to the scene later take part as well.
+ *
+ * @param scene the scene containing the bodies
+ * @param G the gravitational proportionality constant
+ * @param theta the opening angle passed to quadtree_init();
+ *   0 computes the exact forces
+ * @param filter a function deciding which bodies take part,
+ *   or NULL to include every body
+ * @param aux an auxiliary value to pass to filter
+ */
+void create_barnes_hut_gravity(scene_t *scene, double G, double theta,
+                               body_filter_t filter, void *aux);
+
 /**
  * Adds a force creator to a scene that acts like a spring between two bodies.
  * The force creator will be called each tick
@@ -243,6 +348,30 @@ void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
  */
 void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2);
 
+/**
+ * Adds a spring network's springs to a scene (see springs.h), evaluated in a
+ * single force creator. The scene takes ownership of the network and frees
+ * it along with the force creator, which is removed if any of the network's
+ * bodies are removed, like create_spring()'s force creators.
+ * Add all of the network's bodies before calling this.
+ *
+ * @param scene the scene containing the bodies
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void create_spring_network(scene_t *scene, spring_network_t *network);
+
+/**
+ * Like create_spring_network(), but integrates the network's springs and
+ * drag implicitly with spring_network_solve_implicit() each tick, after the
+ * scene's other forces have been added. Use this for springs too stiff to
+ * integrate explicitly at the scene's tick length.
+ *
+ * @param scene the scene containing the bodies
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void create_implicit_spring_network(scene_t *scene,
+                                    spring_network_t *network);
+
 /**
  * Adds a force creator to a scene that applies a drag force on a body.
  * The force creator will be called each tick
@@ -256,21 +385,70 @@ void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2);
  */
 void create_drag(scene_t *scene, double gamma, body_t *body);
 
+/**
+ * Adds uniform gravity to a scene as a force field (see
+ * scene_add_force_field()), pulling each body with a force of its mass
+ * times the acceleration.
+ *
+ * @param scene the scene containing the bodies
+ * @param acceleration the acceleration due to gravity
+ * @param filter a function deciding which bodies are pulled,
+ *   or NULL to pull every body
+ * @param aux an auxiliary value to pass to filter
+ */
+void create_uniform_gravity(scene_t *scene, vector_t acceleration,
+                            body_filter_t filter, void *aux);
+
+/**
+ * Adds drag to a scene as a force field (see scene_add_force_field()),
+ * like create_drag() on every body.
+ *
+ * @param scene the scene containing the bodies
+ * @param linear the drag force per unit of speed
+ * @param quadratic the drag force per unit of speed squared
+ * @param filter a function deciding which bodies are slowed down,
+ *   or NULL to slow down every body
+ * @param aux an auxiliary value to pass to filter
+ */
+void create_drag_field(scene_t *scene, double linear, double quadratic,
+                       body_filter_t filter, void *aux);
+
+/**
+ * Adds wind to a scene as a force field (see scene_add_force_field()):
+ * drag towards the wind's velocity rather than towards rest.
+ *
+ * @param scene the scene containing the bodies
+ * @param velocity the wind's velocity
+ * @param linear the drag force per unit of speed relative to the wind
+ * @param quadratic the drag force per unit of relative speed squared
+ * @param filter a function deciding which bodies the wind blows,
+ *   or NULL to blow every body
+ * @param aux an auxiliary value to pass to filter
+ */
+void create_wind(scene_t *scene, vector_t velocity, double linear,
+                 double quadratic, body_filter_t filter, void *aux);
+
 /**
  * The collision handler for collisions between the ball and the brick.
+ * Bounces the ball with physics_collision_handler() and removes the brick.
+ *
+ * @deprecated Use create_breakout_collision() instead
+ * so the scene's contact solver bounces the ball
  *
  * @param body1 the body for the ball
  * @param body2 the body for the brick
  * @param axis the axis of collision
- * @param aux the aux passed in from `create_breakout_collision`
- * @param elasticity the elasticity of the collision between the ball and the
- * brick
+ * @param aux the aux passed in from create_collision()
+ * @param force_const the elasticity of the collision between the ball and
+ * the brick
  */
 void breakout_collision_handler(body_t *body1, body_t *body2, vector_t axis,
                                 void *aux, double force_const);
 
 /**
- * The breakout collision creator for `breakout_collision_handler`.
+ * Adds a collision between the ball and a brick in breakout.
+ * Like create_physics_collision(), the bounce is left to the scene's contact
+ * solver, and the brick is removed when the ball first hits it.
  *
  * @param scene the scene of the game
  * @param body1 the body for the ball
@@ -0,0 +1,105 @@
+#ifndef __PAIR_TABLE_H__
+#define __PAIR_TABLE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A hash table keyed by unordered pairs of pointers, e.g. (body1, body2).
+ * The pair (a, b) is the same key as (b, a).
+ * A key may be stored several times with different values, so the table can
+ * map one pair of bodies to every force entry registered between them.
+ * The table never frees the keys or values it stores.
+ */
+typedef struct pair_table pair_table_t;
+
+/**
+ * A function called on entries of a pair table.
+ *
+ * @param a the first pointer of the key
+ * @param b the second pointer of the key
+ * @param value the value stored under the key
+ * @param aux the auxiliary value passed to the lookup
+ */
+typedef void (*pair_visitor_t)(void *a, void *b, void *value, void *aux);
+
+/**
+ * Allocates memory for an empty pair table.
+ * Asserts that the required memory was allocated.
+ *
+ * @param initial_capacity the number of entries to allocate space for
+ * @return a pointer to the newly allocated table
+ */
+pair_table_t *pair_table_init(size_t initial_capacity);
+
+/**
+ * Releases the memory allocated for a pair table.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ */
+void pair_table_free(pair_table_t *table);
+
+/**
+ * Gets the number of entries stored in a pair table.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @return the number of entries
+ */
+size_t pair_table_size(pair_table_t *table);
+
+/**
+ * Adds an entry to a pair table, growing the table if needed.
+ * Does not check whether the same entry is already present.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param a the first pointer of the key
+ * @param b the second pointer of the key
+ * @param value the value to store under the key
+ */
+void pair_table_add(pair_table_t *table, void *a, void *b, void *value);
+
+/**
+ * Removes one entry with the given key and value from a pair table.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param a the first pointer of the key
+ * @param b the second pointer of the key
+ * @param value the value of the entry to remove
+ * @return whether a matching entry was found and removed
+ */
+bool pair_table_remove(pair_table_t *table, void *a, void *b, void *value);
+
+/**
+ * Returns whether any entry is stored under the given key.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param a the first pointer of the key
+ * @param b the second pointer of the key
+ * @return whether the key is present
+ */
+bool pair_table_contains(pair_table_t *table, void *a, void *b);
+
+/**
+ * Calls a visitor on every entry stored under the given key.
+ * The visitor must not add to or remove from the table.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param a the first pointer of the key
+ * @param b the second pointer of the key
+ * @param visit the function to call on each matching entry
+ * @param aux an auxiliary value to pass to visit
+ */
+void pair_table_find(pair_table_t *table, void *a, void *b,
+                     pair_visitor_t visit, void *aux);
+
+/**
+ * Calls a visitor on every entry in the table, in no particular order.
+ * The visitor must not add to or remove from the table.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param visit the function to call on each entry
+ * @param aux an auxiliary value to pass to visit
+ */
+void pair_table_foreach(pair_table_t *table, pair_visitor_t visit, void *aux);
+
+#endif // #ifndef __PAIR_TABLE_H__
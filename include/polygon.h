@@ -1,12 +1,28 @@
 #ifndef __POLYGON_H__
 #define __POLYGON_H__
 
+#include "aabb.h"
 #include "color.h"
 #include "list.h"
 #include "vector.h"
 
 typedef struct polygon polygon_t;
 
+/**
+ * The kinds of shape a polygon_t can describe.
+ */
+typedef enum {
+  /** A convex polygon, stored as its list of vertices. */
+  SHAPE_POLYGON,
+  /** A circle, stored as its center and radius, without any vertices. */
+  SHAPE_CIRCLE,
+  /**
+   * A rectangle, stored as its center, half-extents and rotation.
+   * Its vertices are computed when needed rather than stored.
+   */
+  SHAPE_BOX,
+} shape_kind_t;
+
 /**
  * Initialize a polygon object given a list of vertices.
  *
@@ -26,8 +42,95 @@ polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
                         double rotation_speed, double red, double green,
                         double blue);
 
+/**
+ * Initialize a circle. It is drawn and tested for collisions as a true
+ * circle, so it has no vertices to move around.
+ *
+ * @param center the initial center of the circle
+ * @param radius the radius of the circle, which must be positive
+ * @param initial_velocity a vector representing the initial velocity of the
+ * circle
+ * @param rotation_speed the rotation angle of the circle per unit time
+ * @param red double value between 0 and 1 representing the red of the circle
+ * @param green double value between 0 and 1 representing the green of the
+ * circle
+ * @param blue double value between 0 and 1 representing the blue of the circle
+ * @return a polygon object pointer
+ */
+polygon_t *polygon_init_circle(vector_t center, double radius,
+                               vector_t initial_velocity,
+                               double rotation_speed, double red, double green,
+                               double blue);
+
+/**
+ * Initialize an oriented rectangle. It starts out with its sides parallel to
+ * the x and y axes, and turns with the polygon's rotation.
+ *
+ * @param center the initial center of the rectangle
+ * @param width the length of the rectangle along x, which must be positive
+ * @param height the length of the rectangle along y, which must be positive
+ * @param initial_velocity a vector representing the initial velocity of the
+ * rectangle
+ * @param rotation_speed the rotation angle of the rectangle per unit time
+ * @param red double value between 0 and 1 representing the red of the
+ * rectangle
+ * @param green double value between 0 and 1 representing the green of the
+ * rectangle
+ * @param blue double value between 0 and 1 representing the blue of the
+ * rectangle
+ * @return a polygon object pointer
+ */
+polygon_t *polygon_init_box(vector_t center, double width, double height,
+                            vector_t initial_velocity, double rotation_speed,
+                            double red, double green, double blue);
+
+/**
+ * Returns what kind of shape the polygon is.
+ *
+ * @param polygon a polygon_t struct
+ * @return SHAPE_CIRCLE if it was made with polygon_init_circle(), SHAPE_BOX
+ *   if it was made with polygon_init_box(), otherwise SHAPE_POLYGON
+ */
+shape_kind_t polygon_get_kind(polygon_t *polygon);
+
+/**
+ * Returns the radius of a circle.
+ *
+ * @param polygon a polygon_t struct
+ * @return the radius if the polygon is a circle, otherwise 0
+ */
+double polygon_get_radius(polygon_t *polygon);
+
+/**
+ * Returns half the width and height of a box, measured along its own axes.
+ *
+ * @param polygon a polygon_t struct
+ * @return the half-extents if the polygon is a box, otherwise (0, 0)
+ */
+vector_t polygon_get_half_extents(polygon_t *polygon);
+
+/**
+ * Returns the number of vertices of the polygon.
+ *
+ * @param polygon a polygon_t struct
+ * @return 4 for a box, 0 for a circle, otherwise the number of points
+ */
+size_t polygon_num_vertices(polygon_t *polygon);
+
+/**
+ * Returns a vertex of the polygon, in counterclockwise order.
+ * Unlike polygon_get_points(), this also works for boxes, whose corners are
+ * computed from their center, half-extents and rotation.
+ *
+ * @param polygon a polygon_t struct that is not a circle
+ * @param index the index of the vertex, less than polygon_num_vertices()
+ * @return the position of the vertex
+ */
+vector_t polygon_get_vertex(polygon_t *polygon, size_t index);
+
 /**
  * Return the list of vectors representing the vertices of the polygon.
+ * Circles and boxes do not store their vertices, so their list is empty.
  *
  * @param polygon the list of vertices that make up the polygon
  * @return a list of vectors
@@ -64,6 +167,15 @@ double polygon_area(polygon_t *polygon);
  */
 vector_t polygon_centroid(polygon_t *polygon);
 
+/**
+ * Computes the axis-aligned bounding box of a polygon.
+ * The box is cached, and only recomputed after the polygon rotates.
+ *
+ * @param polygon a polygon_t struct
+ * @return the smallest axis-aligned box containing every vertex
+ */
+aabb_t polygon_get_aabb(polygon_t *polygon);
+
 /**
  * Translates all vertices in a polygon by a given vector.
  * Note: mutates the original polygon.
@@ -132,6 +244,20 @@ void polygon_set_rotation(polygon_t *polygon, double rot);
  */
 double polygon_get_rotation(polygon_t *polygon);
 
+/**
+ * Returns the unit outward normals of the polygon's edges.
+ * Normal i is perpendicular to the edge from vertex i to vertex i + 1.
+ * The normals are computed once when the polygon is created and only
+ * rotated again when the polygon's rotation has changed.
+ * A box has just two normals, its local x and y axes, since opposite edges
+ * share them.
+ *
+ * @param polygon a polygon_t struct
+ * @return an array with one normal per vertex (two for a box), owned by the
+ *   polygon and valid until the polygon is next rotated. NULL for a circle.
+ */
+const vector_t *polygon_get_normals(polygon_t *polygon);
+
 /**
  * Set the x and y components of a polygon's velocity vector.
  *
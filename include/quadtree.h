@@ -0,0 +1,75 @@
+#ifndef __QUADTREE_H__
+#define __QUADTREE_H__
+
+#include <stddef.h>
+
+#include "vector.h"
+
+/**
+ * A Barnes-Hut quadtree over a set of point masses, for approximating the
+ * inverse-square field (e.g. gravity) they produce.
+ * Each node is a square that stores the total mass and center of mass of the
+ * points inside it. A field query treats a node that looks small from where
+ * it is evaluated as a single point mass, so evaluating the field at every
+ * point takes O(n log n) time instead of O(n^2).
+ *
+ * The tree is rebuilt from scratch whenever the points move, reusing its
+ * memory between builds.
+ */
+typedef struct quadtree quadtree_t;
+
+/**
+ * Allocates memory for an empty tree.
+ * Asserts that the required memory was allocated.
+ *
+ * @param theta the opening angle: a node is approximated by its center of
+ *   mass when its width divided by its distance is less than theta.
+ *   0 makes queries exact; around 0.5 is a good trade-off.
+ * @return a pointer to the newly allocated tree
+ */
+quadtree_t *quadtree_init(double theta);
+
+/**
+ * Releases the memory allocated for a tree.
+ *
+ * @param tree a pointer to a tree returned from quadtree_init()
+ */
+void quadtree_free(quadtree_t *tree);
+
+/**
+ * Gets the number of points in a tree.
+ *
+ * @param tree a pointer to a tree returned from quadtree_init()
+ * @return the number of points passed to the last quadtree_build()
+ */
+size_t quadtree_size(quadtree_t *tree);
+
+/**
+ * Replaces the points in a tree. The arrays are copied.
+ *
+ * @param tree a pointer to a tree returned from quadtree_init()
+ * @param positions the position of each point
+ * @param masses the mass of each point, which must be non-negative
+ * @param num_points the length of positions and masses
+ */
+void quadtree_build(quadtree_t *tree, const vector_t *positions,
+                    const double *masses, size_t num_points);
+
+/**
+ * Approximates the inverse-square field of the points at a position,
+ * i.e. the sum over each point of m * d / |d|^3, where m is its mass and d
+ * its displacement from the position.
+ * Multiply by G and a body's mass to get its gravitational force.
+ *
+ * @param tree a pointer to a tree returned from quadtree_init()
+ * @param position where to evaluate the field
+ * @param skip the index of a point to leave out (usually the point at
+ *   position), or any index not less than quadtree_size() to leave out none
+ * @param min_distance points closer than this to position are left out,
+ *   since the field blows up near each point
+ * @return the field at position
+ */
+vector_t quadtree_field(quadtree_t *tree, vector_t position, size_t skip,
+                        double min_distance);
+
+#endif // #ifndef __QUADTREE_H__
@@ -2,7 +2,9 @@
 #define __SCENE_H__
 
 #include "body.h"
+#include "collision.h"
 #include "list.h"
+#include "slot_map.h"
 
 /**
  * A collection of bodies and force creators.
@@ -11,6 +13,18 @@
  */
 typedef struct scene scene_t;
 
+/**
+ * A stable reference to a body in a scene, which stays valid while the scene
+ * reorders its bodies and becomes stale once the body is freed.
+ */
+typedef slot_handle_t body_handle_t;
+
+/**
+ * A stable reference to a force creator or solver in a scene, which becomes
+ * stale once the scene frees it.
+ */
+typedef slot_handle_t force_handle_t;
+
 /**
  * A function which adds some forces or impulses to bodies,
  * e.g. from collisions, gravity, or spring forces.
@@ -18,6 +32,136 @@ typedef struct scene scene_t;
  */
 typedef void (*force_creator_t)(void *aux);
 
+/**
+ * A function which integrates some forces implicitly over a tick, by adding
+ * impulses to bodies. It is run after every force creator has added its
+ * forces, so it can account for them, and is told the length of the tick.
+ */
+typedef void (*force_solver_t)(void *aux, double dt);
+
+/**
+ * The algorithms a scene can use to find the pairs of bodies that may be
+ * colliding, before running their collision force creators.
+ */
+typedef enum {
+  /** Rebuilds a uniform grid of bounding boxes every tick (the default). */
+  BROAD_PHASE_GRID,
+  /**
+   * Keeps bounding boxes sorted between ticks and tracks overlapping pairs
+   * incrementally. Cheapest when most bodies move slowly.
+   */
+  BROAD_PHASE_SWEEP,
+} broad_phase_t;
+
+/**
+ * The schemes a scene can use to advance its bodies over a tick.
+ */
+typedef enum {
+  /**
+   * Translates each body at a Simpson's rule average of its last, current
+   * and next velocity, see body_tick() (the default).
+   */
+  INTEGRATOR_SIMPSON,
+  /** See body_tick_symplectic_euler(). The cheapest scheme. */
+  INTEGRATOR_SYMPLECTIC_EULER,
+  /** See body_tick_velocity_verlet(). Suits long-running orbits. */
+  INTEGRATOR_VELOCITY_VERLET,
+  /**
+   * Classic fourth-order Runge-Kutta: the scene's force fields and force
+   * creators are run three more times per tick, with the bodies moved to
+   * each intermediate stage. Collisions, contacts and force solvers are only
+   * resolved once, at the start of the tick.
+   *
+   * Every force creator must therefore be a pure function of the bodies'
+   * current positions and velocities: it may only add forces, and running it
+   * again at a stage must not change its auxiliary value or anything else.
+   * A creator that counts calls, plays sounds or accumulates state runs four
+   * times per tick, three of them at positions the bodies never reach.
+   * It also costs four evaluations per tick, so expensive creators such as
+   * Barnes-Hut gravity rebuild their tree four times.
+   */
+  INTEGRATOR_RK4,
+} integrator_t;
+
+/**
+ * A function that decides whether a scene query should consider a body.
+ *
+ * @param body a body in the scene
+ * @param aux the auxiliary value passed to the query
+ * @return whether the query should consider the body
+ */
+typedef bool (*body_filter_t)(body_t *body, void *aux);
+
+/**
+ * A function called on each body found by a scene query.
+ *
+ * @param body a body in the scene
+ * @param aux the auxiliary value passed to the query
+ */
+typedef void (*body_handler_t)(body_t *body, void *aux);
+
+/**
+ * Whether a body has started or stopped overlapping a sensor.
+ */
+typedef enum {
+  SENSOR_ENTER,
+  SENSOR_EXIT,
+} sensor_event_t;
+
+/**
+ * A function called when a body starts or stops overlapping a sensor
+ * (see body_set_sensor()).
+ *
+ * @param sensor the sensor
+ * @param body the body overlapping it
+ * @param event whether the body started or stopped overlapping the sensor
+ * @param aux the auxiliary value passed to scene_set_sensor_handler()
+ */
+typedef void (*sensor_handler_t)(body_t *sensor, body_t *body,
+                                 sensor_event_t event, void *aux);
+
+/**
+ * A force acting on every body in a scene (that passes the field's filter),
+ * computed from each body's mass and velocity. The force on a body with
+ * mass m and velocity v, moving relative to the flow at u = v - flow, is
+ *   m * acceleration - linear_drag * u - quadratic_drag * |u| * u.
+ * So uniform gravity sets only acceleration, drag sets only the drag
+ * coefficients, and wind also sets flow to the wind's velocity.
+ */
+typedef struct {
+  vector_t acceleration;
+  vector_t flow;
+  double linear_drag;
+  double quadratic_drag;
+} force_field_t;
+
+/**
+ * Statistics on the substeps scene_step_adaptive() has taken.
+ */
+typedef struct {
+  /** The number of substeps taken */
+  size_t accepted_steps;
+  /** The number of substeps tried and rejected for being too inaccurate */
+  size_t rejected_steps;
+  /** The shortest and longest substeps taken, in seconds */
+  double shortest_step;
+  double longest_step;
+} step_stats_t;
+
+/**
+ * The first body a ray or shape cast through the scene touches.
+ */
+typedef struct {
+  /** The body that was hit, or NULL if the cast hit nothing */
+  body_t *body;
+  /** Where on the body's surface the cast touched it */
+  vector_t point;
+  /** The body's unit outward normal at the point */
+  vector_t normal;
+  /** How far along the cast the body was touched, between 0 and 1 */
+  double fraction;
+} raycast_hit_t;
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -45,6 +189,9 @@ size_t scene_bodies(scene_t *scene);
 
 /**
  * Gets the body at a given index in a scene.
+ * Bodies keep their indices only until the end of the next tick:
+ * scene_tick() moves the last body into the index of each removed one.
+ * Keep a body_handle_t to refer to a body across ticks.
  * Asserts that the index is valid.
  *
  * @param scene a pointer to a scene returned from scene_init()
@@ -55,11 +202,45 @@ body_t *scene_get_body(scene_t *scene, size_t index);
 
 /**
  * Adds a body to a scene.
+ * Bodies with infinite mass (walls and other level geometry) are kept in a
+ * bounding volume hierarchy instead of the scene's broad phase, so moving
+ * bodies find the ones they overlap in logarithmic time.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param body a pointer to the body to add to the scene
+ * @return a handle to the body
+ */
+body_handle_t scene_add_body(scene_t *scene, body_t *body);
+
+/**
+ * Gets the handle to the body at a given index in a scene.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the body in the scene (starting at 0)
+ * @return the handle scene_add_body() returned for the body
+ */
+body_handle_t scene_get_body_handle(scene_t *scene, size_t index);
+
+/**
+ * Gets the body a handle refers to, in constant time.
+ * A body marked with body_remove() is still found until the end of the tick
+ * that frees it.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param handle a handle returned from scene_add_body()
+ * @return a pointer to the body, or NULL if it has been freed
+ */
+body_t *scene_get_body_by_handle(scene_t *scene, body_handle_t handle);
+
+/**
+ * Marks the body a handle refers to for removal, like body_remove().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param handle a handle returned from scene_add_body()
+ * @return false if the body has already been freed, true otherwise
  */
-void scene_add_body(scene_t *scene, body_t *body);
+bool scene_remove_body_by_handle(scene_t *scene, body_handle_t handle);
 
 /**
  * @deprecated Use body_remove() instead
@@ -82,23 +263,459 @@ void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux);
  * Adds a force creator to a scene,
  * to be invoked every time scene_tick() is called.
  * The auxiliary value is passed to the force creator each time it is called.
+ * The scene never looks inside it or frees it; see
+ * scene_add_force_creator_with_freer() to hand it over to the scene.
  * The force creator is registered with a list of bodies it applies to,
  * so it can be removed when any one of the bodies is removed.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param forcer a force creator function
+ * @param aux an auxiliary value of any type to pass to forcer when it is
+ *   called
+ * @param bodies the list of bodies affected by the force creator.
+ *   The force creator will be removed if any of these bodies are removed.
+ *   This list does not own the bodies, so its freer should be NULL.
+ * @return a handle to the force creator
+ */
+force_handle_t scene_add_bodies_force_creator(scene_t *scene,
+                                              force_creator_t forcer, void *aux,
+                                              list_t *bodies);
+
+/**
+ * Adds a force creator like scene_add_bodies_force_creator(), but hands its
+ * auxiliary value over to the scene to free with the given function.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
  * @param aux an auxiliary value to pass to forcer when it is called
  * @param bodies the list of bodies affected by the force creator.
  *   The force creator will be removed if any of these bodies are removed.
  *   This list does not own the bodies, so its freer should be NULL.
+ * @param freer a function to free aux with when the force creator is removed
+ * @return a handle to the force creator
+ */
+force_handle_t scene_add_force_creator_with_freer(scene_t *scene,
+                                                  force_creator_t forcer,
+                                                  void *aux, list_t *bodies,
+                                                  free_func_t freer);
+
+/**
+ * Adds a force solver to a scene, to be invoked every time scene_tick() is
+ * called, after all of the scene's force creators.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param solver a force solver function
+ * @param aux an auxiliary value to pass to solver when it is called
+ * @param bodies the list of bodies affected by the force solver.
+ *   The force solver will be removed if any of these bodies are removed.
+ *   This list does not own the bodies, so its freer should be NULL.
+ * @param freer a function to free aux with when the force solver is removed
+ * @return a handle to the force solver
+ */
+force_handle_t scene_add_force_solver(scene_t *scene, force_solver_t solver,
+                                      void *aux, list_t *bodies,
+                                      free_func_t freer);
+
+/**
+ * Adds a force creator that acts on the scene as a whole, such as a field
+ * acting on every body, to be invoked every time scene_tick() is called.
+ * Unlike scene_add_bodies_force_creator(), it does not depend on any
+ * particular bodies, so it stays registered until the scene is freed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param freer if non-NULL, a function to free aux with when the scene is
+ *   freed
+ * @return a handle to the force creator
+ */
+force_handle_t scene_add_field_force_creator(scene_t *scene,
+                                             force_creator_t forcer, void *aux,
+                                             free_func_t freer);
+
+/**
+ * Adds a force creator that resolves a collision between two bodies.
+ * Unlike scene_add_bodies_force_creator(), the force creator is not invoked
+ * every tick: the scene's broad phase buckets bodies by their bounding boxes
+ * and only runs it while the two bodies' bounding boxes overlap.
+ * It is also run once on the first tick after the boxes separate,
+ * so it can notice that the bodies are no longer colliding.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the two bodies that may collide.
+ *   The force creator will be removed if either body is removed.
+ *   This list does not own the bodies, so its freer should be NULL.
+ * @param freer if non-NULL, a function to free aux with when the force
+ *   creator is removed
+ * @return a handle to the force creator
+ */
+force_handle_t scene_add_collision_force_creator(scene_t *scene,
+                                                 force_creator_t forcer,
+                                                 void *aux, list_t *bodies,
+                                                 free_func_t freer);
+
+/**
+ * Removes a force creator or solver from a scene. It is no longer run from
+ * the start of the next tick, when the scene frees it.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param handle a handle returned when the force was added
+ * @return false if the force had already been removed, true otherwise
+ */
+bool scene_remove_force(scene_t *scene, force_handle_t handle);
+
+/**
+ * Checks whether a force creator or solver is still registered with a scene,
+ * which it stops being once it is removed, or once one of its bodies is.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param handle a handle returned when the force was added
+ * @return whether the force has neither been freed nor removed
+ */
+bool scene_has_force(scene_t *scene, force_handle_t handle);
+
+/**
+ * Makes every pair of bodies in two collision categories collide, so large
+ * levels need not register a collision for each pair of bodies up front.
+ * Whenever the broad phase finds two bodies whose bounding boxes overlap,
+ * and one body's category (see body_set_collision_filter()) shares bits with
+ * category1 and the other's with category2, the scene creates a collision
+ * force creator for the pair, as create_collision() or
+ * create_physics_collision() would register it. It runs like any other
+ * collision force creator, and is freed once the bounding boxes separate.
+ * Both bodies' masks must also allow the collision.
+ * If several rules match a pair, only the first one added is used.
+ * Rules never pair two bodies with infinite mass.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param category1 the categories of the body passed first to the handler
+ * @param category2 the categories of the body passed second to the handler
+ * @param handler a function to call when the bodies first collide, or NULL
+ * @param aux an auxiliary value to pass to the handler
+ * @param force_const a constant to pass to the handler, which is also the
+ *   elasticity if the scene resolves the contact
+ * @param resolves_contact whether the scene's contact solver should keep the
+ *   bodies apart, see create_physics_collision()
+ */
+void scene_add_collision_rule(scene_t *scene, uint32_t category1,
+                              uint32_t category2, collision_handler_t handler,
+                              void *aux, double force_const,
+                              bool resolves_contact);
+
+/**
+ * Changes the algorithm the scene uses to find pairs of bodies that may be
+ * colliding. See broad_phase_t.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param broad_phase the broad phase to use from the next tick on
+ */
+void scene_set_broad_phase(scene_t *scene, broad_phase_t broad_phase);
+
+/**
+ * Changes the scheme the scene uses to advance its bodies each tick.
+ * See integrator_t; INTEGRATOR_RK4 needs every force creator to be a pure
+ * function of the bodies' state.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param integrator the integrator to use from the next tick on
+ */
+void scene_set_integrator(scene_t *scene, integrator_t integrator);
+
+/**
+ * Gets the scheme the scene uses to advance its bodies each tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's integrator, INTEGRATOR_SIMPSON unless changed
+ */
+integrator_t scene_get_integrator(scene_t *scene);
+
+/**
+ * Advances a scene by a time interval in as many ticks as it takes to keep
+ * the error of each tick within a tolerance, so quiet scenes take a few long
+ * ticks and violent ones many short ones.
+ * Before each tick, the error is estimated with an embedded pair of
+ * solutions: the force fields and force creators are run at the bodies'
+ * current state and again at an Euler step ahead, and each body is advanced
+ * once holding its starting acceleration and once with its acceleration
+ * changing linearly to the one found ahead. The error is the largest
+ * difference between the two, over all bodies, in position or in velocity
+ * times the tick's length (the distance the velocity's difference would
+ * misplace the body by over another tick). A tick whose error exceeds the
+ * tolerance is rejected and retried with a shorter length, unless it is
+ * already at the scene's shortest allowed tick.
+ * The forces found at the current state are reused by the tick and by any
+ * retries, so an accepted tick runs the force creators twice and a rejected
+ * one once more. The next tick's length is picked from the last estimate
+ * and carried over between calls. Collisions and force solvers are assumed
+ * to be exact.
+ * The estimate is of a second order integrator's error, so the tolerance
+ * holds with INTEGRATOR_VELOCITY_VERLET and INTEGRATOR_RK4, while
+ * INTEGRATOR_SIMPSON ticks are only made shorter where motion is violent.
+ *
+ * Every force creator must therefore be a pure function of the bodies'
+ * positions and velocities, as with INTEGRATOR_RK4: the run an Euler step
+ * ahead sees the bodies at a state they never reach, so a creator that
+ * counts calls, plays sounds or removes bodies acts on it as if it were
+ * real, and does so once more for every rejected tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param dt the time to advance the scene by, in seconds
+ * @param tolerance the largest distance any body may be misplaced by in
+ *   one tick
+ */
+void scene_step_adaptive(scene_t *scene, double dt, double tolerance);
+
+/**
+ * Limits the length of the ticks scene_step_adaptive() takes.
+ * A shorter min_step allows more rejected ticks, each running the force
+ * creators at a state the bodies never reach, so they must be pure functions
+ * of body state; see scene_step_adaptive().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param min_step the shortest tick, in seconds, taken even if it is too
+ *   inaccurate; at least 0
+ * @param max_step the longest tick, in seconds, taken even if a longer one
+ *   would be accurate enough; at least min_step
+ */
+void scene_set_step_limits(scene_t *scene, double min_step, double max_step);
+
+/**
+ * Gets statistics on the ticks scene_step_adaptive() has taken since the
+ * scene was created.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the statistics; the shortest step is INFINITY and the longest 0
+ *   before any tick is taken
+ */
+step_stats_t scene_get_step_stats(scene_t *scene);
+
+/**
+ * Advances a scene by the time a frame took in whole fixed-length ticks,
+ * so the physics behaves the same at any frame rate.
+ * The frame's time is added to an accumulator, and a tick is taken for every
+ * fixed step that fits in it; the rest carries over to the next frame.
+ * If more than the scene's catch-up limit of ticks fit, for example after a
+ * long stall, the extra time is dropped rather than simulated.
+ * Before each tick, every body's transform is saved with
+ * body_save_transform(), so the scene can be drawn between its last two
+ * ticks with scene_get_interpolation_alpha().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param frame_dt the time since the last frame, in seconds
+ * @return the number of ticks taken
+ */
+size_t scene_advance(scene_t *scene, double frame_dt);
+
+/**
+ * Sets the tick length and catch-up limit of scene_advance().
+ * The defaults are 1/60 seconds and 5 ticks per call.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param fixed_step the length of each tick, in seconds; positive
+ * @param max_steps the most ticks scene_advance() takes in one call;
+ *   positive
+ */
+void scene_set_fixed_step(scene_t *scene, double fixed_step,
+                          size_t max_steps);
+
+/**
+ * Gets how far between its last two ticks a scene should be drawn:
+ * a body at alpha is drawn at its previous transform plus alpha times the
+ * change since. After scene_advance(), alpha is the fraction of a fixed
+ * step left in the accumulator; after a scene_tick() outside of
+ * scene_advance(), it is 1, which draws the bodies where they are.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the interpolation alpha, between 0 and 1
+ */
+double scene_get_interpolation_alpha(scene_t *scene);
+
+/**
+ * Changes the algorithm the scene's collision force creators use to test
+ * whether their bodies collide. See narrow_phase_t.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param narrow_phase the narrow phase to use from the next tick on
+ */
+void scene_set_narrow_phase(scene_t *scene, narrow_phase_t narrow_phase);
+
+/**
+ * Gets the algorithm the scene's collision force creators use to test
+ * whether their bodies collide.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's narrow phase, NARROW_PHASE_SAT unless changed
+ */
+narrow_phase_t scene_get_narrow_phase(scene_t *scene);
+
+/**
+ * Changes the cell size of the scene's broad-phase grid.
+ * Cells around the size of the typical moving body work best.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param cell_size the side length of each grid cell
+ */
+void scene_set_cell_size(scene_t *scene, double cell_size);
+
+/**
+ * Records that two bodies were found overlapping during the current tick.
+ * Once the tick's collisions have run, scene_tick() solves every recorded
+ * contact together with sequential impulses, so that no contact point is
+ * left approaching, and then pushes the bodies apart.
+ * Physics collisions call this every tick their bodies overlap.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param manifold where the bodies touch, with its normal pointing from
+ *   body1 towards body2
+ * @param elasticity the coefficient of restitution of the contact
+ * @param impulses if non-NULL, the normal impulse at each contact point on
+ *   the previous tick, which the solver is warm-started from and then
+ *   replaces with this tick's. Must stay valid until the end of the tick.
+ */
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       contact_manifold_t manifold, double elasticity,
+                       double *impulses);
+
+/**
+ * Changes how many passes the contact solver makes over the tick's contacts.
+ * More passes let impulses spread further through stacks of bodies.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of passes, at least 1
+ */
+void scene_set_solver_iterations(scene_t *scene, size_t iterations);
+
+/**
+ * Changes how overlapping bodies are pushed apart each tick.
+ * Each contact moves its bodies apart along its normal by a fraction of
+ * the depth beyond the slop, split according to their inverse masses.
+ * Moving only a fraction each tick keeps resting contacts from jittering,
+ * and leaving a slop keeps the contact touching for the next tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param fraction how much of the penetration to remove each tick, between
+ *   0 (which turns the correction off) and 1
+ * @param slop the penetration that is left alone
+ */
+void scene_set_position_correction(scene_t *scene, double fraction,
+                                   double slop);
+
+/**
+ * Finds the first body a ray passes into.
+ * Bodies with infinite mass are found through the scene's bounding volume
+ * hierarchy, and the others by walking the broad-phase grid along the ray,
+ * so only the bodies near the ray are tested. Bodies are found where they
+ * were at the end of the last tick or when they were added; bodies moved
+ * since then with body_set_centroid() may be missed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param origin the start of the ray
+ * @param direction the direction of the ray, which need not be a unit vector
+ * @param max_distance how far the ray reaches
+ * @param filter a function deciding which bodies the ray can hit,
+ *   or NULL to let it hit any body
+ * @param aux an auxiliary value to pass to filter
+ * @return the first body hit, with fraction the distance to it divided by
+ *   max_distance; the body is NULL if the ray hits nothing. A ray starting
+ *   inside a body does not hit it.
+ */
+raycast_hit_t scene_raycast(scene_t *scene, vector_t origin, vector_t direction,
+                            double max_distance, body_filter_t filter,
+                            void *aux);
+
+/**
+ * Finds the first body a circle moving in a straight line touches,
+ * like scene_raycast() for a ray with thickness. Useful for predicting
+ * where a ball will go.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param origin the center of the circle at the start of the cast
+ * @param radius the radius of the circle
+ * @param direction the direction the circle moves in, which need not be a
+ *   unit vector
+ * @param max_distance how far the circle moves
+ * @param filter a function deciding which bodies the circle can hit,
+ *   or NULL to let it hit any body
+ * @param aux an auxiliary value to pass to filter
+ * @return the first body touched, with point on its surface; the body is
+ *   NULL if the circle touches nothing. Bodies the circle already touches at
+ *   its start are not hit.
+ */
+raycast_hit_t scene_shapecast(scene_t *scene, vector_t origin, double radius,
+                              vector_t direction, double max_distance,
+                              body_filter_t filter, void *aux);
+
+/**
+ * Calls a handler on every body containing a point.
+ * Like scene_raycast(), only the bodies whose bounding boxes are near the
+ * point are tested, through the scene's tree and grid.
+ * The handler must not add bodies or run other scene queries.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param point the point to look up
+ * @param handler the function to call on each body found
+ * @param aux an auxiliary value to pass to handler
+ */
+void scene_query_point(scene_t *scene, vector_t point, body_handler_t handler,
+                       void *aux);
+
+/**
+ * Calls a handler on every body whose bounding box overlaps a box.
+ * Like scene_raycast(), only the bodies near the box are visited, through
+ * the scene's tree and grid.
+ * The handler must not add bodies or run other scene queries.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param box the region to look up
+ * @param handler the function to call on each body found
+ * @param aux an auxiliary value to pass to handler
+ */
+void scene_query_aabb(scene_t *scene, aabb_t box, body_handler_t handler,
+                      void *aux);
+
+/**
+ * Sets the function called when a body starts or stops overlapping one of
+ * the scene's sensors (see body_set_sensor()). Sensors are paired with the
+ * bodies whose bounding boxes overlap them by the broad phase, like the
+ * pairs generated by collision rules, and only with bodies whose category and
+ * mask allow it (see body_set_collision_filter()). The handler is called
+ * while the scene runs its collisions; no exit is reported for bodies that
+ * are removed from the scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param handler the function to call on each event, or NULL to stop
+ *   reporting them
+ * @param aux an auxiliary value to pass to handler
+ */
+void scene_set_sensor_handler(scene_t *scene, sensor_handler_t handler,
+                              void *aux);
+
+/**
+ * Adds a force field to a scene. Every tick, before the force creators run,
+ * the scene applies all of its fields in a single pass over its bodies,
+ * which is much cheaper than a force creator per body.
+ * Bodies with infinite mass are left alone.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param field the force field
+ * @param filter a function deciding which bodies the field acts on,
+ *   or NULL to act on every body
+ * @param aux an auxiliary value to pass to filter
  */
-void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
-                                    void *aux, list_t *bodies);
+void scene_add_force_field(scene_t *scene, force_field_t field,
+                           body_filter_t filter, void *aux);
 
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
  * and then ticking each body (see body_tick()).
+ * Collision force creators run after the others, and only for the pairs of
+ * bodies found by the broad phase. Contacts they report with
+ * scene_add_contact() are then solved.
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
  *
@@ -79,12 +79,23 @@ void sdl_clear(void);
 
 /**
  * Draws a polygon from the given list of vertices and a color.
+ * Circles are drawn with SDL_gfx's circle primitive instead.
  *
  * @param poly a struct representing the polygon
  * @param color the color used to fill in the polygon
  */
 void sdl_draw_polygon(polygon_t *poly, rgb_color_t color);
 
+/**
+ * Draws a body in its own color, part of the way from its previous
+ * transform to its current one; see scene_get_interpolation_alpha().
+ *
+ * @param body the body to draw
+ * @param alpha how far from the body's previous transform (0) to its
+ *   current one (1) to draw it
+ */
+void sdl_draw_body(body_t *body, double alpha);
+
 /**
  * Displays the rendered frame on the SDL window.
  * Must be called after drawing the polygons in order to show them.
@@ -92,8 +103,9 @@ void sdl_draw_polygon(polygon_t *poly, rgb_color_t color);
 void sdl_show(void);
 
 /**
- * Draws all bodies in a scene.
- * This internally calls sdl_clear(), sdl_draw_polygon(), and sdl_show(),
+ * Draws all bodies in a scene, between their last two ticks by the scene's
+ * interpolation alpha.
+ * This internally calls sdl_clear(), sdl_draw_body(), and sdl_show(),
  * so those functions should not be called directly.
  *
  * @param scene the scene to draw
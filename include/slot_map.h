@@ -0,0 +1,90 @@
+#ifndef __SLOT_MAP_H__
+#define __SLOT_MAP_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A stable reference to an element of a densely packed array, which stays
+ * valid while the element moves around the array, and is recognized as
+ * stale once the element is removed, even if its slot is reused.
+ */
+typedef struct {
+  uint32_t index;
+  uint32_t generation;
+} slot_handle_t;
+
+/**
+ * Maps handles to the positions of elements in a densely packed array kept
+ * by the caller, such as a list_t removed from with list_swap_remove().
+ * Each handle names a slot, which holds the element's position and a
+ * generation that changes whenever the slot is freed or reused. Freed slots
+ * are kept on a free list, so adding, finding and removing elements all
+ * take constant time.
+ */
+typedef struct slot_map slot_map_t;
+
+/**
+ * Allocates memory for an empty slot map.
+ * Asserts that the required memory was allocated.
+ *
+ * @param initial_capacity the number of elements to allocate space for
+ * @return a pointer to the newly allocated slot map
+ */
+slot_map_t *slot_map_init(size_t initial_capacity);
+
+/**
+ * Releases the memory allocated for a slot map.
+ *
+ * @param map a pointer to a slot map returned from slot_map_init()
+ */
+void slot_map_free(slot_map_t *map);
+
+/**
+ * Gets the number of elements in a slot map.
+ *
+ * @param map a pointer to a slot map returned from slot_map_init()
+ * @return the number of elements added and not yet removed
+ */
+size_t slot_map_size(slot_map_t *map);
+
+/**
+ * Adds an element at the end of the array, at position slot_map_size().
+ *
+ * @param map a pointer to a slot map returned from slot_map_init()
+ * @return a new handle to the element
+ */
+slot_handle_t slot_map_add(slot_map_t *map);
+
+/**
+ * Finds the element a handle refers to.
+ *
+ * @param map a pointer to a slot map returned from slot_map_init()
+ * @param handle a handle returned from slot_map_add()
+ * @param position set to the element's position if the handle is live
+ * @return whether the element is still in the array
+ */
+bool slot_map_find(slot_map_t *map, slot_handle_t handle, size_t *position);
+
+/**
+ * Gets the handle to the element at a position.
+ * Asserts that the position is valid.
+ *
+ * @param map a pointer to a slot map returned from slot_map_init()
+ * @param position the position of the element
+ * @return the handle slot_map_add() returned for the element
+ */
+slot_handle_t slot_map_get_handle(slot_map_t *map, size_t position);
+
+/**
+ * Removes the element at a position, moving the last element into its
+ * place, like list_swap_remove(). The removed element's handle becomes
+ * stale. Asserts that the position is valid.
+ *
+ * @param map a pointer to a slot map returned from slot_map_init()
+ * @param position the position of the element to remove
+ */
+void slot_map_swap_remove(slot_map_t *map, size_t position);
+
+#endif // #ifndef __SLOT_MAP_H__
@@ -0,0 +1,113 @@
+#ifndef __SPATIAL_HASH_H__
+#define __SPATIAL_HASH_H__
+
+#include <stddef.h>
+
+#include "aabb.h"
+
+/**
+ * A uniform grid broad phase.
+ * Space is divided into square cells and each proxy (usually a body) is
+ * bucketed into every cell its bounding box touches. The cells are stored in
+ * a hash table, so the grid is unbounded and empty space costs nothing.
+ * Only proxies sharing a cell are ever compared with each other.
+ *
+ * The grid is rebuilt from scratch every tick: spatial_hash_clear() followed
+ * by one spatial_hash_insert() per proxy. Its memory is reused across ticks.
+ */
+typedef struct spatial_hash spatial_hash_t;
+
+/**
+ * Allocates memory for an empty grid.
+ * Asserts that the required memory was allocated.
+ *
+ * @param cell_size the side length of each cell. Works best when it is
+ *   around the size of the typical moving body.
+ * @return a pointer to the newly allocated grid
+ */
+spatial_hash_t *spatial_hash_init(double cell_size);
+
+/**
+ * Releases the memory allocated for a grid.
+ * Does not free the data stored with the proxies.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ */
+void spatial_hash_free(spatial_hash_t *grid);
+
+/**
+ * Gets the side length of the grid's cells.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ * @return the cell size
+ */
+double spatial_hash_get_cell_size(spatial_hash_t *grid);
+
+/**
+ * Changes the side length of the grid's cells.
+ * Removes every proxy, since they were bucketed using the old size.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ * @param cell_size the new cell size
+ */
+void spatial_hash_set_cell_size(spatial_hash_t *grid, double cell_size);
+
+/**
+ * Removes every proxy from the grid, keeping its memory for reuse.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ */
+void spatial_hash_clear(spatial_hash_t *grid);
+
+/**
+ * Adds a proxy to the grid.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ * @param data the value reported for this proxy by queries
+ * @param box the bounding box of the proxy
+ */
+void spatial_hash_insert(spatial_hash_t *grid, void *data, aabb_t box);
+
+/**
+ * Calls a handler once for every pair of proxies whose bounding boxes
+ * overlap. Each pair is reported exactly once, even when the two proxies
+ * share several cells.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ * @param handler the function to call on each overlapping pair
+ * @param aux an auxiliary value to pass to handler
+ */
+void spatial_hash_query_pairs(spatial_hash_t *grid, pair_handler_t handler,
+                              void *aux);
+
+/**
+ * Calls a handler once for every proxy whose bounding box overlaps a box.
+ * Only the cells the box covers are looked up.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ * @param box the region to search
+ * @param handler the function to call on the data of each proxy found
+ * @param aux an auxiliary value to pass to handler
+ */
+void spatial_hash_query(spatial_hash_t *grid, aabb_t box,
+                        proxy_handler_t handler, void *aux);
+
+/**
+ * Calls a handler once for every proxy whose bounding box a ray passes
+ * through, or comes within a radius of. The ray walks the grid cell by cell
+ * from its origin, and stops at the first cell beyond the fraction returned
+ * by the handler, so a ray that hits something nearby stays cheap.
+ *
+ * @param grid a pointer to a grid returned from spatial_hash_init()
+ * @param origin the start of the ray
+ * @param delta the displacement from the start of the ray to its end
+ * @param radius how far from the ray a box may be and still be reported,
+ *   0 for a thin ray
+ * @param handler the function to call on the data of each proxy found
+ * @param aux an auxiliary value to pass to handler
+ */
+void spatial_hash_raycast(spatial_hash_t *grid, vector_t origin,
+                          vector_t delta, double radius, ray_handler_t handler,
+                          void *aux);
+
+#endif // #ifndef __SPATIAL_HASH_H__
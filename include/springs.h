@@ -0,0 +1,122 @@
+#ifndef __SPRINGS_H__
+#define __SPRINGS_H__
+
+#include <stddef.h>
+
+#include "body.h"
+
+/**
+ * A network of damped springs between bodies, such as a rope or a soft body.
+ * Unlike create_spring(), which needs a force creator per spring, a network
+ * keeps every spring's endpoints, rest length, stiffness and damping in flat
+ * arrays and evaluates all of its springs in one loop.
+ *
+ * The springs are kept in compressed sparse row (CSR) order: sorted by their
+ * first body, with an offset array marking where each body's springs start,
+ * which is rebuilt the next time the network is used after springs are added.
+ */
+typedef struct spring_network spring_network_t;
+
+/**
+ * Allocates memory for an empty network.
+ * Asserts that the required memory was allocated.
+ *
+ * @return a pointer to the newly allocated network
+ */
+spring_network_t *spring_network_init(void);
+
+/**
+ * Releases the memory allocated for a network.
+ * Does not free its bodies.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void spring_network_free(spring_network_t *network);
+
+/**
+ * Adds a body to a network, so springs can be attached to it.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param body the body, which the network does not own
+ * @return the index of the body in the network
+ */
+size_t spring_network_add_body(spring_network_t *network, body_t *body);
+
+/**
+ * Adds a spring between two of a network's bodies. The spring pulls
+ * (or pushes) the bodies with a force of stiffness times how far they are
+ * from their rest length apart, plus damping times their relative speed
+ * along the spring.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param body1 the index of one body, from spring_network_add_body()
+ * @param body2 the index of the other body
+ * @param stiffness the Hooke's constant of the spring
+ * @param rest_length the distance between the bodies' centroids at which the
+ *   spring exerts no force; 0 gives create_spring()'s spring
+ * @param damping the damping constant of the spring, or 0 for none
+ */
+void spring_network_add_spring(spring_network_t *network, size_t body1,
+                               size_t body2, double stiffness,
+                               double rest_length, double damping);
+
+/**
+ * Sets the linear drag on every body in a network, like create_drag(),
+ * so that it is integrated along with the springs by
+ * spring_network_solve_implicit(). The default is no drag.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param gamma the proportionality constant between force and velocity
+ */
+void spring_network_set_drag(spring_network_t *network, double gamma);
+
+/**
+ * Gets the number of bodies in a network.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @return the number of bodies added with spring_network_add_body()
+ */
+size_t spring_network_bodies(spring_network_t *network);
+
+/**
+ * Gets a body in a network.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param index the index returned by spring_network_add_body()
+ * @return the body
+ */
+body_t *spring_network_get_body(spring_network_t *network, size_t index);
+
+/**
+ * Gets the number of springs in a network.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @return the number of springs added with spring_network_add_spring()
+ */
+size_t spring_network_springs(spring_network_t *network);
+
+/**
+ * Adds the force of every spring in a network to its bodies.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void spring_network_apply(spring_network_t *network);
+
+/**
+ * Advances a network's bodies' velocities over a tick with linearly implicit
+ * (backward) Euler, which stays stable for springs far too stiff for
+ * spring_network_apply() at the same tick length.
+ * The spring and drag forces are linearized around the bodies' current
+ * positions and velocities, and the resulting sparse, symmetric positive
+ * definite system is solved for the bodies' change in velocity with a
+ * Jacobi-preconditioned conjugate gradient over the springs. The change is
+ * applied as impulses, after accounting for the forces already added to the
+ * bodies this tick, so body_tick() finishes the step.
+ * Bodies with infinite mass do not move.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param dt the length of the tick
+ */
+void spring_network_solve_implicit(spring_network_t *network, double dt);
+
+#endif // #ifndef __SPRINGS_H__
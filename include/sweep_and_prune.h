@@ -0,0 +1,99 @@
+#ifndef __SWEEP_AND_PRUNE_H__
+#define __SWEEP_AND_PRUNE_H__
+
+#include <stddef.h>
+
+#include "aabb.h"
+
+/**
+ * An incremental sort-and-sweep broad phase.
+ * The endpoints of every proxy's bounding box are kept sorted along both
+ * axes between updates. Bodies move only a little each tick, so the arrays
+ * stay nearly sorted and an insertion sort re-sorts them in close to linear
+ * time. Every swap of two endpoints is a change in whether two proxies
+ * overlap along that axis, which is used to maintain a persistent set of
+ * overlapping pairs without ever comparing proxies that are far apart.
+ */
+typedef struct sweep_and_prune sweep_and_prune_t;
+
+/**
+ * Allocates memory for an empty sweep-and-prune broad phase.
+ * Asserts that the required memory was allocated.
+ *
+ * @param on_add if non-NULL, called during sweep_and_prune_update()
+ *   with the data of each pair that starts overlapping
+ * @param on_remove if non-NULL, called with the data of each pair that stops
+ *   overlapping, including when one of its proxies is removed
+ * @param aux an auxiliary value to pass to on_add and on_remove
+ * @return a pointer to the newly allocated broad phase
+ */
+sweep_and_prune_t *sweep_and_prune_init(pair_handler_t on_add,
+                                        pair_handler_t on_remove, void *aux);
+
+/**
+ * Releases the memory allocated for a sweep-and-prune broad phase.
+ * Does not free the data stored with the proxies.
+ *
+ * @param sap a pointer to a broad phase returned from sweep_and_prune_init()
+ */
+void sweep_and_prune_free(sweep_and_prune_t *sap);
+
+/**
+ * Adds a proxy to the broad phase.
+ * Its overlaps are found on the next sweep_and_prune_update().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_and_prune_init()
+ * @param data the value reported for this proxy
+ * @param box the bounding box of the proxy
+ * @return an id identifying the proxy in later calls
+ */
+size_t sweep_and_prune_add(sweep_and_prune_t *sap, void *data, aabb_t box);
+
+/**
+ * Changes the bounding box of a proxy.
+ * The pair set is brought up to date on the next sweep_and_prune_update().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_and_prune_init()
+ * @param proxy an id returned from sweep_and_prune_add()
+ * @param box the new bounding box of the proxy
+ */
+void sweep_and_prune_move(sweep_and_prune_t *sap, size_t proxy, aabb_t box);
+
+/**
+ * Removes a proxy and every pair containing it.
+ * The id may be reused by a later sweep_and_prune_add().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_and_prune_init()
+ * @param proxy an id returned from sweep_and_prune_add()
+ */
+void sweep_and_prune_remove(sweep_and_prune_t *sap, size_t proxy);
+
+/**
+ * Re-sorts the endpoints after proxies have moved,
+ * adding and removing pairs as their bounding boxes start and stop
+ * overlapping.
+ *
+ * @param sap a pointer to a broad phase returned from sweep_and_prune_init()
+ */
+void sweep_and_prune_update(sweep_and_prune_t *sap);
+
+/**
+ * Gets the number of pairs of proxies that currently overlap.
+ *
+ * @param sap a pointer to a broad phase returned from sweep_and_prune_init()
+ * @return the size of the pair set as of the last update
+ */
+size_t sweep_and_prune_num_pairs(sweep_and_prune_t *sap);
+
+/**
+ * Calls a handler on every pair of proxies in the pair set,
+ * i.e. every pair overlapping as of the last sweep_and_prune_update().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_and_prune_init()
+ * @param handler the function to call on the data of each pair
+ * @param aux an auxiliary value to pass to handler
+ */
+void sweep_and_prune_query_pairs(sweep_and_prune_t *sap,
+                                 pair_handler_t handler, void *aux);
+
+#endif // #ifndef __SWEEP_AND_PRUNE_H__
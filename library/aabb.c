@@ -0,0 +1,53 @@
+#include "aabb.h"
+#include <math.h>
+#include <stddef.h>
+
+bool aabb_overlap(aabb_t a, aabb_t b) {
+  return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y &&
+         b.min.y <= a.max.y;
+}
+
+bool aabb_contains(aabb_t outer, aabb_t inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+         inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+bool aabb_contains_point(aabb_t box, vector_t point) {
+  return box.min.x <= point.x && point.x <= box.max.x && box.min.y <= point.y &&
+         point.y <= box.max.y;
+}
+
+double aabb_ray_fraction(aabb_t box, vector_t origin, vector_t delta) {
+  double enter = 0, leave = 1;
+  double starts[2] = {origin.x, origin.y};
+  double steps[2] = {delta.x, delta.y};
+  double mins[2] = {box.min.x, box.min.y};
+  double maxs[2] = {box.max.x, box.max.y};
+  for (size_t i = 0; i < 2; i++) {
+    if (steps[i] == 0) {
+      if (starts[i] < mins[i] || starts[i] > maxs[i]) {
+        return INFINITY;
+      }
+      continue;
+    }
+    double t1 = (mins[i] - starts[i]) / steps[i];
+    double t2 = (maxs[i] - starts[i]) / steps[i];
+    enter = fmax(enter, fmin(t1, t2));
+    leave = fmin(leave, fmax(t1, t2));
+  }
+  return enter <= leave ? enter : INFINITY;
+}
+
+aabb_t aabb_union(aabb_t a, aabb_t b) {
+  return (aabb_t){.min = {fmin(a.min.x, b.min.x), fmin(a.min.y, b.min.y)},
+                  .max = {fmax(a.max.x, b.max.x), fmax(a.max.y, b.max.y)}};
+}
+
+aabb_t aabb_fatten(aabb_t box, double margin) {
+  return (aabb_t){.min = {box.min.x - margin, box.min.y - margin},
+                  .max = {box.max.x + margin, box.max.y + margin}};
+}
+
+double aabb_perimeter(aabb_t box) {
+  return 2 * ((box.max.x - box.min.x) + (box.max.y - box.min.y));
+}
@@ -4,54 +4,117 @@
 #include <math.h>
 
 #include "body.h"
+#include "body_store.h"
 #include "color.h"
 #include "list.h"
 #include "polygon.h"
 #include "vector.h"
 
-const double SIXTH = 0.1666667;
+// vertices in the polygon body_get_shape() returns for a circle
+const size_t CIRCLE_SHAPE_POINTS = 20;
+const size_t GUESS_FORCES_PER_BODY = 2;
 
 typedef struct body {
   polygon_t *poly;
-  double mass;
-  double prev_dt;
-  vector_t prev_vel;
-  vector_t force;
-  vector_t impulse;
-  bool removed;
+  // the body's slot in the store holding its pose, velocity, forces, mass
+  // and flags: a store of its own until it is attached to a scene's
+  body_store_t *store;
+  size_t slot;
+  bool owns_store;
+  size_t proxy;
+  // the force entries in the body's scene that depend on it
+  list_t *force_entries;
+  uint32_t category;
+  uint32_t mask;
   void *info;
   free_func_t info_freer;
 } body_t;
 
 void body_reset(body_t *body) {
-  body->force = VEC_ZERO;
-  body->impulse = VEC_ZERO;
+  body->store->forces[body->slot] = VEC_ZERO;
+  body->store->impulses[body->slot] = VEC_ZERO;
 }
 
 body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
   return body_init_with_info(shape, mass, color, NULL, NULL);
 }
 
-body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
-                            void *info, free_func_t info_freer) {
+/**
+ * Allocates a body at rest around an existing polygon, which it takes
+ * ownership of.
+ */
+static body_t *body_init_with_polygon(polygon_t *poly, double mass,
+                                      void *info, free_func_t info_freer) {
   assert(mass > 0);
   body_t *body = malloc(sizeof(body_t));
   assert(body);
-  body->poly = polygon_init(shape, VEC_ZERO, 0.0, color.r, color.g, color.b);
-  body->mass = mass;
-  body->force = VEC_ZERO;
-  body->impulse = VEC_ZERO;
-  body->removed = false;
+  body->poly = poly;
+  body->store = body_store_init(1);
+  body->slot = body_store_add(body->store);
+  body->owns_store = true;
+  body->store->centroids[0] = polygon_get_center(poly);
+  body->store->rotations[0] = polygon_get_rotation(poly);
+  body->store->masses[0] = mass;
+  body->store->inverse_masses[0] = 1 / mass;
+  body->proxy = 0;
+  body->force_entries = list_init(GUESS_FORCES_PER_BODY, NULL);
+  body->category = 0;
+  body->mask = UINT32_MAX;
   body->info = info;
   body->info_freer = info_freer;
-  body->prev_vel = VEC_ZERO; 
-  body->prev_dt = 0;
+  body_save_transform(body);
 
   return body;
 }
 
-polygon_t *body_get_polygon(body_t *body) { 
-  return body->poly; 
+body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
+                            void *info, free_func_t info_freer) {
+  polygon_t *poly =
+      polygon_init(shape, VEC_ZERO, 0.0, color.r, color.g, color.b);
+  return body_init_with_polygon(poly, mass, info, info_freer);
+}
+
+body_t *body_init_circle(vector_t center, double radius, double mass,
+                         rgb_color_t color) {
+  return body_init_circle_with_info(center, radius, mass, color, NULL, NULL);
+}
+
+body_t *body_init_circle_with_info(vector_t center, double radius, double mass,
+                                   rgb_color_t color, void *info,
+                                   free_func_t info_freer) {
+  polygon_t *poly = polygon_init_circle(center, radius, VEC_ZERO, 0.0, color.r,
+                                        color.g, color.b);
+  return body_init_with_polygon(poly, mass, info, info_freer);
+}
+
+body_t *body_init_box(vector_t center, double width, double height,
+                      double mass, rgb_color_t color) {
+  return body_init_box_with_info(center, width, height, mass, color, NULL,
+                                 NULL);
+}
+
+body_t *body_init_box_with_info(vector_t center, double width, double height,
+                                double mass, rgb_color_t color, void *info,
+                                free_func_t info_freer) {
+  polygon_t *poly = polygon_init_box(center, width, height, VEC_ZERO, 0.0,
+                                     color.r, color.g, color.b);
+  return body_init_with_polygon(poly, mass, info, info_freer);
+}
+
+polygon_t *body_get_polygon(body_t *body) {
+  double rotation = body->store->rotations[body->slot];
+  vector_t centroid = body->store->centroids[body->slot];
+  // the polygon is only moved to the body's pose when it is asked for, so
+  // ticks move just the centroids; rotate first, since rotating a polygon
+  // recomputes its centroid
+  if (polygon_get_rotation(body->poly) != rotation) {
+    polygon_set_rotation(body->poly, rotation);
+  }
+  vector_t center = polygon_get_center(body->poly);
+  if (center.x != centroid.x || center.y != centroid.y) {
+    polygon_set_center(body->poly, centroid);
+  }
+  return body->poly;
 }
 
 void *body_get_info(body_t *body) { 
@@ -60,35 +123,150 @@ void *body_get_info(body_t *body) {
 
 void body_free(body_t *body) {
   polygon_free(body->poly);
+  if (body->owns_store) {
+    body_store_free(body->store);
+  }
+  list_free(body->force_entries);
   if (body->info_freer) {
     body->info_freer(body->info);
   }
   free(body);
 }
 
+/**
+ * Returns a regular polygon approximating a circular body.
+ */
+static list_t *get_circle_shape(body_t *body) {
+  vector_t center = body_get_centroid(body);
+  double radius = polygon_get_radius(body->poly);
+  list_t *points = list_init(CIRCLE_SHAPE_POINTS, free);
+  for (size_t i = 0; i < CIRCLE_SHAPE_POINTS; i++) {
+    double angle = 2 * M_PI * i / CIRCLE_SHAPE_POINTS;
+    vector_t *point = malloc(sizeof(vector_t));
+    assert(point);
+    *point = (vector_t){center.x + radius * cos(angle),
+                        center.y + radius * sin(angle)};
+    list_add(points, point);
+  }
+  return points;
+}
+
 list_t *body_get_shape(body_t *body) {
-  list_t *poly_points = polygon_get_points(body->poly);
-  list_t *new_points = list_init(list_size(poly_points), free);
-  for (size_t i = 0; i < list_size(poly_points); i++) {
-    vector_t *old_vec = list_get(poly_points, i);
+  polygon_t *poly = body_get_polygon(body);
+  if (polygon_get_kind(body->poly) == SHAPE_CIRCLE) {
+    return get_circle_shape(body);
+  }
+
+  size_t num_points = polygon_num_vertices(poly);
+  list_t *new_points = list_init(num_points, free);
+  for (size_t i = 0; i < num_points; i++) {
     vector_t *new_vec = malloc(sizeof(vector_t));
     assert(new_vec);
-    new_vec->x = old_vec->x;
-    new_vec->y = old_vec->y;
+    *new_vec = polygon_get_vertex(poly, i);
     list_add(new_points, new_vec);
   }
   return new_points;
 }
 
 vector_t body_get_centroid(body_t *body) {
-  return polygon_get_center(body->poly);
+  return body->store->centroids[body->slot];
+}
+
+aabb_t body_get_aabb(body_t *body) {
+  return polygon_get_aabb(body_get_polygon(body));
+}
+
+bool body_contains_point(body_t *body, vector_t point) {
+  polygon_t *poly = body_get_polygon(body);
+  if (polygon_get_kind(poly) == SHAPE_CIRCLE) {
+    double radius = polygon_get_radius(poly);
+    vector_t offset = vec_subtract(point, polygon_get_center(poly));
+    return vec_dot(offset, offset) <= radius * radius;
+  }
+  // a convex polygon contains the points on the left of all its edges
+  size_t n = polygon_num_vertices(poly);
+  for (size_t i = 0; i < n; i++) {
+    vector_t vertex = polygon_get_vertex(poly, i);
+    vector_t edge = vec_subtract(polygon_get_vertex(poly, (i + 1) % n), vertex);
+    if (vec_cross(edge, vec_subtract(point, vertex)) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+vector_t body_get_force(body_t *body) {
+  return body->store->forces[body->slot];
+}
+
+vector_t body_get_impulse(body_t *body) {
+  return body->store->impulses[body->slot];
 }
 
 vector_t body_get_velocity(body_t *body) {
-  return (vector_t){.x = polygon_get_velocity(body->poly)->x,
-                    .y = polygon_get_velocity(body->poly)->y};
+  return body->store->velocities[body->slot];
+}
+
+void body_attach(body_t *body, body_store_t *store) {
+  size_t slot = body_store_add(store);
+  body_store_copy(store, slot, body->store, body->slot);
+  if (body->owns_store) {
+    body_store_free(body->store);
+  }
+  body->store = store;
+  body->slot = slot;
+  body->owns_store = false;
 }
 
+size_t body_get_slot(body_t *body) { return body->slot; }
+
+void body_move_slot(body_t *body, size_t slot) {
+  body_store_move(body->store, body->slot, slot);
+  body->slot = slot;
+}
+
+/**
+ * Sets or clears one of a body's flags.
+ */
+static void set_flag(body_t *body, body_flag_t flag, bool value) {
+  uint8_t *flags = &body->store->flags[body->slot];
+  *flags = value ? *flags | flag : *flags & ~flag;
+}
+
+static bool get_flag(body_t *body, body_flag_t flag) {
+  return body->store->flags[body->slot] & flag;
+}
+
+size_t body_get_proxy(body_t *body) { 
+  return body->proxy; 
+}
+
+void body_set_proxy(body_t *body, size_t proxy) { 
+  body->proxy = proxy; 
+}
+
+list_t *body_get_force_entries(body_t *body) { return body->force_entries; }
+
+void body_set_ccd(body_t *body, bool ccd) { set_flag(body, BODY_CCD, ccd); }
+
+bool body_get_ccd(body_t *body) { return get_flag(body, BODY_CCD); }
+
+void body_set_collision_filter(body_t *body, uint32_t category,
+                               uint32_t mask) {
+  body->category = category;
+  body->mask = mask;
+}
+
+uint32_t body_get_category(body_t *body) { return body->category; }
+
+uint32_t body_get_mask(body_t *body) { return body->mask; }
+
+void body_set_sensor(body_t *body, bool sensor) {
+  set_flag(body, BODY_SENSOR, sensor);
+}
+
+bool body_is_sensor(body_t *body) { return get_flag(body, BODY_SENSOR); }
+
 rgb_color_t *body_get_color(body_t *body) {
   return polygon_get_color(body->poly);
 }
@@ -98,71 +276,79 @@ void body_set_color(body_t *body, rgb_color_t *col) {
 }
 
 void body_set_centroid(body_t *body, vector_t x) {
-  polygon_set_center(body->poly, x);
+  body->store->centroids[body->slot] = x;
 }
 
 void body_set_velocity(body_t *body, vector_t v) {
-  polygon_set_velocity(body->poly, v);
+  body->store->velocities[body->slot] = v;
 }
 
 double body_get_rotation(body_t *body) {
-  return polygon_get_rotation(body->poly);
+  return body->store->rotations[body->slot];
+}
+
+vector_t body_get_previous_centroid(body_t *body) {
+  return body->store->prev_centroids[body->slot];
+}
+
+double body_get_previous_rotation(body_t *body) {
+  return body->store->prev_rotations[body->slot];
+}
+
+void body_save_transform(body_t *body) {
+  body->store->prev_centroids[body->slot] = body_get_centroid(body);
+  body->store->prev_rotations[body->slot] = body_get_rotation(body);
 }
 
 void body_set_rotation(body_t *body, double angle) {
-  polygon_set_rotation(body->poly, angle);
+  body->store->rotations[body->slot] = angle;
 }
 
 void body_tick(body_t *body, double dt) {
-  vector_t force_contribution = vec_multiply(dt / body->mass, body->force);
-  vector_t impulse_contribution = vec_multiply(1 / body->mass, body->impulse);
-  vector_t total_velocity_change =
-      vec_add(force_contribution, impulse_contribution);
-  vector_t curr_vel = body_get_velocity(body);
-  vector_t new_velocity =
-      vec_add(curr_vel, total_velocity_change);
-  
-  vector_t pre_mean_simpson_vel = vec_add(vec_add(body->prev_vel, 
-      vec_multiply(4, curr_vel)), new_velocity); // using
-    // Simpson's rule to approximate the integral from curr_time - prev_dt
-    // to curr_time + dt
-  
-  vector_t avg_simpson_vel = vec_multiply(SIXTH, pre_mean_simpson_vel);
-    // note: Simpson will give the integral from curr_time - prev_dt to
-    // curr_time + dt but we only want curr_time to curr_time + dt, so uses
-    // delta_x = (dt + prev_dt / 6) * (dt / dt + prev_dt) = dt / 6. Since
-    // polygon_move will handle moving at a velocity over a time of dt, we
-    // divide by dt and use polygon_move to handle the multiplication by dt.
-    // this means that we only need to multiply by 1/6.  
-    // Since Simpson's rule gives a greater convergence than trapezoid method,
-    // this is an improved integration scheme.
-
-  polygon_set_velocity(body->poly, avg_simpson_vel);
-  polygon_move(body->poly, dt);
-  polygon_set_velocity(body->poly, new_velocity);
-
-  body->force = VEC_ZERO;
-  body->impulse = VEC_ZERO;
-  body->prev_dt = dt;
-  body->prev_vel = curr_vel;
+  body_store_tick(body->store, body->slot, body->slot + 1, dt);
+}
+
+void body_tick_symplectic_euler(body_t *body, double dt) {
+  body_store_tick_symplectic_euler(body->store, body->slot, body->slot + 1,
+                                   dt);
+}
+
+void body_tick_velocity_verlet(body_t *body, double dt) {
+  body_store_tick_velocity_verlet(body->store, body->slot, body->slot + 1,
+                                  dt);
+}
+
+void body_advance(body_t *body, double dt, vector_t position_acceleration,
+                  vector_t velocity_acceleration) {
+  body_store_advance(body->store, body->slot, body->slot + 1, dt,
+                     &position_acceleration, &velocity_acceleration);
 }
 
 double body_get_mass(body_t *body) {
-  return body->mass; 
+  return body->store->masses[body->slot];
 }
 
 void body_add_force(body_t *body, vector_t force) {
-  body->force = vec_add(body->force, force);
+  vector_t *total = &body->store->forces[body->slot];
+  *total = vec_add(*total, force);
 }
 
 void body_add_impulse(body_t *body, vector_t impulse) {
-  body->impulse = vec_add(body->impulse, impulse);
+  vector_t *total = &body->store->impulses[body->slot];
+  *total = vec_add(*total, impulse);
+}
+
+vector_t body_get_next_velocity(body_t *body, double dt) {
+  vector_t change = vec_add(vec_multiply(dt, body_get_force(body)),
+                            body_get_impulse(body));
+  return vec_add(body_get_velocity(body),
+                 vec_multiply(body->store->inverse_masses[body->slot], change));
 }
 
 void body_remove(body_t *body) {
-  body->removed = true; 
+  set_flag(body, BODY_REMOVED, true);
 }
 
-bool body_is_removed(body_t *body) { 
-  return body->removed; 
+bool body_is_removed(body_t *body) {
+  return get_flag(body, BODY_REMOVED);
 }
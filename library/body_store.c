@@ -0,0 +1,218 @@
+#include "body_store.h"
+#include <assert.h>
+#include <stdlib.h>
+
+const size_t MIN_BODY_STORE_CAPACITY = 4;
+const double SIXTH = 0.1666667;
+
+/**
+ * Resizes every array in a store to hold capacity slots.
+ */
+static void resize(body_store_t *store, size_t capacity) {
+  store->capacity = capacity;
+  store->centroids = realloc(store->centroids, sizeof(vector_t) * capacity);
+  store->rotations = realloc(store->rotations, sizeof(double) * capacity);
+  store->velocities = realloc(store->velocities, sizeof(vector_t) * capacity);
+  store->forces = realloc(store->forces, sizeof(vector_t) * capacity);
+  store->impulses = realloc(store->impulses, sizeof(vector_t) * capacity);
+  store->masses = realloc(store->masses, sizeof(double) * capacity);
+  store->inverse_masses =
+      realloc(store->inverse_masses, sizeof(double) * capacity);
+  store->flags = realloc(store->flags, sizeof(uint8_t) * capacity);
+  store->prev_centroids =
+      realloc(store->prev_centroids, sizeof(vector_t) * capacity);
+  store->prev_rotations =
+      realloc(store->prev_rotations, sizeof(double) * capacity);
+  store->prev_dts = realloc(store->prev_dts, sizeof(double) * capacity);
+  store->prev_velocities =
+      realloc(store->prev_velocities, sizeof(vector_t) * capacity);
+  store->prev_accelerations =
+      realloc(store->prev_accelerations, sizeof(vector_t) * capacity);
+  assert(store->centroids && store->rotations && store->velocities &&
+         store->forces && store->impulses && store->masses &&
+         store->inverse_masses && store->flags && store->prev_centroids &&
+         store->prev_rotations && store->prev_dts && store->prev_velocities &&
+         store->prev_accelerations);
+}
+
+body_store_t *body_store_init(size_t initial_capacity) {
+  body_store_t *store = calloc(1, sizeof(body_store_t));
+  assert(store);
+  if (initial_capacity > 0) {
+    resize(store, initial_capacity);
+  }
+  return store;
+}
+
+void body_store_free(body_store_t *store) {
+  free(store->centroids);
+  free(store->rotations);
+  free(store->velocities);
+  free(store->forces);
+  free(store->impulses);
+  free(store->masses);
+  free(store->inverse_masses);
+  free(store->flags);
+  free(store->prev_centroids);
+  free(store->prev_rotations);
+  free(store->prev_dts);
+  free(store->prev_velocities);
+  free(store->prev_accelerations);
+  free(store);
+}
+
+size_t body_store_add(body_store_t *store) {
+  if (store->size == store->capacity) {
+    resize(store, store->capacity < MIN_BODY_STORE_CAPACITY
+                      ? MIN_BODY_STORE_CAPACITY
+                      : 2 * store->capacity);
+  }
+  size_t slot = store->size++;
+  store->centroids[slot] = VEC_ZERO;
+  store->rotations[slot] = 0;
+  store->velocities[slot] = VEC_ZERO;
+  store->forces[slot] = VEC_ZERO;
+  store->impulses[slot] = VEC_ZERO;
+  store->masses[slot] = 0;
+  store->inverse_masses[slot] = 0;
+  store->flags[slot] = 0;
+  store->prev_centroids[slot] = VEC_ZERO;
+  store->prev_rotations[slot] = 0;
+  store->prev_dts[slot] = 0;
+  store->prev_velocities[slot] = VEC_ZERO;
+  store->prev_accelerations[slot] = VEC_ZERO;
+  return slot;
+}
+
+void body_store_copy(body_store_t *store, size_t slot, body_store_t *from,
+                     size_t from_slot) {
+  assert(slot < store->size && from_slot < from->size);
+  store->centroids[slot] = from->centroids[from_slot];
+  store->rotations[slot] = from->rotations[from_slot];
+  store->velocities[slot] = from->velocities[from_slot];
+  store->forces[slot] = from->forces[from_slot];
+  store->impulses[slot] = from->impulses[from_slot];
+  store->masses[slot] = from->masses[from_slot];
+  store->inverse_masses[slot] = from->inverse_masses[from_slot];
+  store->flags[slot] = from->flags[from_slot];
+  store->prev_centroids[slot] = from->prev_centroids[from_slot];
+  store->prev_rotations[slot] = from->prev_rotations[from_slot];
+  store->prev_dts[slot] = from->prev_dts[from_slot];
+  store->prev_velocities[slot] = from->prev_velocities[from_slot];
+  store->prev_accelerations[slot] = from->prev_accelerations[from_slot];
+}
+
+void body_store_move(body_store_t *store, size_t from, size_t to) {
+  body_store_copy(store, to, store, from);
+}
+
+void body_store_truncate(body_store_t *store, size_t size) {
+  assert(size <= store->size);
+  store->size = size;
+}
+
+void body_store_reset(body_store_t *store) {
+  for (size_t i = 0; i < store->size; i++) {
+    store->forces[i] = VEC_ZERO;
+    store->impulses[i] = VEC_ZERO;
+  }
+}
+
+void body_store_save_transforms(body_store_t *store) {
+  for (size_t i = 0; i < store->size; i++) {
+    store->prev_centroids[i] = store->centroids[i];
+    store->prev_rotations[i] = store->rotations[i];
+  }
+}
+
+/**
+ * Finishes a slot's tick: clears its forces and impulses and remembers the
+ * tick for the next one.
+ */
+static void end_tick(body_store_t *store, size_t i, double dt,
+                     vector_t velocity, vector_t acceleration) {
+  store->forces[i] = VEC_ZERO;
+  store->impulses[i] = VEC_ZERO;
+  store->prev_dts[i] = dt;
+  store->prev_velocities[i] = velocity;
+  store->prev_accelerations[i] = acceleration;
+}
+
+void body_store_tick(body_store_t *store, size_t begin, size_t end,
+                     double dt) {
+  for (size_t i = begin; i < end; i++) {
+    double inverse_mass = store->inverse_masses[i];
+    vector_t acceleration = vec_multiply(inverse_mass, store->forces[i]);
+    vector_t velocity = store->velocities[i];
+    vector_t new_velocity =
+        vec_add(velocity, vec_add(vec_multiply(dt, acceleration),
+                                  vec_multiply(inverse_mass,
+                                               store->impulses[i])));
+    // Simpson's rule over the last tick and this one gives the distance
+    // moved from the start of the last tick to the end of this one, so the
+    // mean velocity over this tick alone is (v0 + 4 v1 + v2) / 6, with
+    // greater convergence than the trapezoid method
+    vector_t mean = vec_multiply(
+        SIXTH, vec_add(vec_add(store->prev_velocities[i],
+                               vec_multiply(4, velocity)),
+                       new_velocity));
+    store->centroids[i] = vec_add(store->centroids[i], vec_multiply(dt, mean));
+    store->velocities[i] = new_velocity;
+    end_tick(store, i, dt, velocity, acceleration);
+  }
+}
+
+void body_store_tick_symplectic_euler(body_store_t *store, size_t begin,
+                                      size_t end, double dt) {
+  for (size_t i = begin; i < end; i++) {
+    double inverse_mass = store->inverse_masses[i];
+    vector_t acceleration = vec_multiply(inverse_mass, store->forces[i]);
+    vector_t velocity = store->velocities[i];
+    vector_t change = vec_add(vec_multiply(dt, acceleration),
+                              vec_multiply(inverse_mass, store->impulses[i]));
+    store->velocities[i] = vec_add(velocity, change);
+    store->centroids[i] =
+        vec_add(store->centroids[i], vec_multiply(dt, store->velocities[i]));
+    end_tick(store, i, dt, velocity, acceleration);
+  }
+}
+
+/**
+ * Ticks a slot with given constant accelerations, see body_advance().
+ */
+static void advance(body_store_t *store, size_t i, double dt,
+                    vector_t position_acceleration,
+                    vector_t velocity_acceleration) {
+  vector_t velocity = store->velocities[i];
+  vector_t start = vec_add(
+      velocity, vec_multiply(store->inverse_masses[i], store->impulses[i]));
+  vector_t mean = vec_add(start, vec_multiply(dt / 2, position_acceleration));
+  store->centroids[i] = vec_add(store->centroids[i], vec_multiply(dt, mean));
+  store->velocities[i] =
+      vec_add(start, vec_multiply(dt, velocity_acceleration));
+  end_tick(store, i, dt, velocity, velocity_acceleration);
+}
+
+void body_store_tick_velocity_verlet(body_store_t *store, size_t begin,
+                                     size_t end, double dt) {
+  for (size_t i = begin; i < end; i++) {
+    vector_t acceleration =
+        vec_multiply(store->inverse_masses[i], store->forces[i]);
+    // the last tick's velocity assumed the acceleration would stay the
+    // same, so finish its second half kick with the acceleration reached
+    vector_t correction =
+        vec_multiply(store->prev_dts[i] / 2,
+                     vec_subtract(acceleration, store->prev_accelerations[i]));
+    store->velocities[i] = vec_add(store->velocities[i], correction);
+    advance(store, i, dt, acceleration, acceleration);
+  }
+}
+
+void body_store_advance(body_store_t *store, size_t begin, size_t end,
+                        double dt, const vector_t *position_accelerations,
+                        const vector_t *velocity_accelerations) {
+  for (size_t i = begin; i < end; i++) {
+    advance(store, i, dt, position_accelerations[i - begin],
+            velocity_accelerations[i - begin]);
+  }
+}
@@ -0,0 +1,365 @@
+#include "bvh.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t GUESS_NUM_BVH_NODES = 16;
+const size_t BVH_NULL_NODE = SIZE_MAX;
+// a proxy whose fat box has grown to more than this many margins around its
+// box is reinserted with a fresh fat box, so the tree does not stay bloated
+// after something shrinks or stops moving
+const double BVH_MAX_MARGINS = 4;
+
+typedef struct bvh_node {
+  aabb_t box;
+  void *data;
+  // doubles as the next node in the free list for unused nodes
+  size_t parent;
+  size_t child1;
+  size_t child2;
+  // leaves have height 1, internal nodes 1 more than their tallest child,
+  // and unused nodes 0
+  size_t height;
+} bvh_node_t;
+
+struct bvh {
+  double margin;
+  bvh_node_t *nodes;
+  size_t node_capacity;
+  size_t root;
+  size_t free_list;
+  size_t num_leaves;
+  // stack of nodes left to visit, reused across queries
+  size_t *stack;
+  size_t stack_capacity;
+};
+
+static bool is_leaf(bvh_node_t *node) { return node->child1 == BVH_NULL_NODE; }
+
+static size_t max_size(size_t a, size_t b) { return a > b ? a : b; }
+
+/**
+ * Adds nodes[start] up to nodes[node_capacity] to the free list.
+ */
+static void add_free_nodes(bvh_t *tree, size_t start) {
+  for (size_t i = tree->node_capacity; i > start; i--) {
+    tree->nodes[i - 1].height = 0;
+    tree->nodes[i - 1].parent = tree->free_list;
+    tree->free_list = i - 1;
+  }
+}
+
+bvh_t *bvh_init(double margin) {
+  assert(margin >= 0);
+  bvh_t *tree = malloc(sizeof(bvh_t));
+  assert(tree);
+  tree->margin = margin;
+  tree->node_capacity = GUESS_NUM_BVH_NODES;
+  tree->nodes = malloc(sizeof(bvh_node_t) * tree->node_capacity);
+  assert(tree->nodes);
+  tree->root = BVH_NULL_NODE;
+  tree->free_list = BVH_NULL_NODE;
+  add_free_nodes(tree, 0);
+  tree->num_leaves = 0;
+  tree->stack_capacity = GUESS_NUM_BVH_NODES;
+  tree->stack = malloc(sizeof(size_t) * tree->stack_capacity);
+  assert(tree->stack);
+  return tree;
+}
+
+void bvh_free(bvh_t *tree) {
+  free(tree->nodes);
+  free(tree->stack);
+  free(tree);
+}
+
+size_t bvh_size(bvh_t *tree) { return tree->num_leaves; }
+
+size_t bvh_height(bvh_t *tree) {
+  return tree->root == BVH_NULL_NODE ? 0 : tree->nodes[tree->root].height;
+}
+
+static size_t allocate_node(bvh_t *tree) {
+  if (tree->free_list == BVH_NULL_NODE) {
+    size_t old_capacity = tree->node_capacity;
+    tree->node_capacity *= 2;
+    tree->nodes =
+        realloc(tree->nodes, sizeof(bvh_node_t) * tree->node_capacity);
+    assert(tree->nodes);
+    add_free_nodes(tree, old_capacity);
+  }
+  size_t index = tree->free_list;
+  bvh_node_t *node = &tree->nodes[index];
+  tree->free_list = node->parent;
+  node->parent = BVH_NULL_NODE;
+  node->child1 = BVH_NULL_NODE;
+  node->child2 = BVH_NULL_NODE;
+  node->data = NULL;
+  node->height = 1;
+  return index;
+}
+
+static void free_node(bvh_t *tree, size_t index) {
+  tree->nodes[index].height = 0;
+  tree->nodes[index].parent = tree->free_list;
+  tree->free_list = index;
+}
+
+/**
+ * Recomputes an internal node's box and height from its children.
+ */
+static void refit(bvh_t *tree, size_t index) {
+  bvh_node_t *node = &tree->nodes[index];
+  bvh_node_t *child1 = &tree->nodes[node->child1];
+  bvh_node_t *child2 = &tree->nodes[node->child2];
+  node->box = aabb_union(child1->box, child2->box);
+  node->height = 1 + max_size(child1->height, child2->height);
+}
+
+/**
+ * Replaces one of a node's children (or the root, if parent is
+ * BVH_NULL_NODE) with another node.
+ */
+static void replace_child(bvh_t *tree, size_t parent, size_t old_child,
+                          size_t new_child) {
+  tree->nodes[new_child].parent = parent;
+  if (parent == BVH_NULL_NODE) {
+    tree->root = new_child;
+  } else if (tree->nodes[parent].child1 == old_child) {
+    tree->nodes[parent].child1 = new_child;
+  } else {
+    tree->nodes[parent].child2 = new_child;
+  }
+}
+
+/**
+ * Lifts the taller grandchild of node a under `tall`, one of a's children,
+ * into a's place. `tall` keeps its taller child and takes a as its other
+ * child; a keeps its other child and takes tall's shorter child.
+ * Returns the node now in a's place.
+ */
+static size_t rotate(bvh_t *tree, size_t a, size_t tall) {
+  bvh_node_t *node_a = &tree->nodes[a];
+  bvh_node_t *node_tall = &tree->nodes[tall];
+  size_t f = node_tall->child1, g = node_tall->child2;
+  if (tree->nodes[f].height < tree->nodes[g].height) {
+    size_t swap = f;
+    f = g;
+    g = swap;
+  }
+
+  // tall moves up to take a's place, with a as its second child
+  replace_child(tree, node_a->parent, a, tall);
+  node_tall->child1 = f;
+  node_tall->child2 = a;
+  node_a->parent = tall;
+
+  // a keeps its other child and adopts tall's shorter child g
+  if (node_a->child1 == tall) {
+    node_a->child1 = g;
+  } else {
+    node_a->child2 = g;
+  }
+  tree->nodes[g].parent = a;
+
+  refit(tree, a);
+  refit(tree, tall);
+  return tall;
+}
+
+/**
+ * Performs a rotation at a node if one of its subtrees is more than one level
+ * taller than the other. Returns the node now in its place.
+ */
+static size_t balance(bvh_t *tree, size_t a) {
+  bvh_node_t *node = &tree->nodes[a];
+  if (is_leaf(node) || node->height < 3) {
+    return a;
+  }
+  size_t b = node->child1, c = node->child2;
+  size_t height_b = tree->nodes[b].height, height_c = tree->nodes[c].height;
+  if (height_c > height_b + 1) {
+    return rotate(tree, a, c);
+  }
+  if (height_b > height_c + 1) {
+    return rotate(tree, a, b);
+  }
+  return a;
+}
+
+/**
+ * Refits and rebalances every ancestor of a node, from its parent to the root.
+ */
+static void fix_upwards(bvh_t *tree, size_t index) {
+  while (index != BVH_NULL_NODE) {
+    index = balance(tree, index);
+    refit(tree, index);
+    index = tree->nodes[index].parent;
+  }
+}
+
+/**
+ * Returns the increase in perimeter of a node's box when a box is added
+ * below it, plus the full perimeter if the node is a leaf (since a new
+ * parent would have to be created for it).
+ */
+static double descend_cost(bvh_t *tree, size_t index, aabb_t box) {
+  bvh_node_t *node = &tree->nodes[index];
+  double combined = aabb_perimeter(aabb_union(node->box, box));
+  return is_leaf(node) ? combined : combined - aabb_perimeter(node->box);
+}
+
+/**
+ * Finds a cheap sibling for a new leaf by walking down from the root,
+ * minimising the total perimeter added to the tree.
+ */
+static size_t find_sibling(bvh_t *tree, aabb_t box) {
+  size_t index = tree->root;
+  while (!is_leaf(&tree->nodes[index])) {
+    bvh_node_t *node = &tree->nodes[index];
+    double perimeter = aabb_perimeter(node->box);
+    double combined = aabb_perimeter(aabb_union(node->box, box));
+
+    // cost of pairing the new leaf with this node
+    double cost = 2 * combined;
+    // cost every descendant pays for this node growing
+    double inherited = 2 * (combined - perimeter);
+    double cost1 = descend_cost(tree, node->child1, box) + inherited;
+    double cost2 = descend_cost(tree, node->child2, box) + inherited;
+
+    if (cost < cost1 && cost < cost2) {
+      break;
+    }
+    index = cost1 < cost2 ? node->child1 : node->child2;
+  }
+  return index;
+}
+
+static void insert_leaf(bvh_t *tree, size_t leaf) {
+  if (tree->root == BVH_NULL_NODE) {
+    tree->root = leaf;
+    tree->nodes[leaf].parent = BVH_NULL_NODE;
+    return;
+  }
+
+  size_t sibling = find_sibling(tree, tree->nodes[leaf].box);
+  size_t old_parent = tree->nodes[sibling].parent;
+  size_t new_parent = allocate_node(tree);
+  replace_child(tree, old_parent, sibling, new_parent);
+  tree->nodes[new_parent].child1 = sibling;
+  tree->nodes[new_parent].child2 = leaf;
+  tree->nodes[sibling].parent = new_parent;
+  tree->nodes[leaf].parent = new_parent;
+  fix_upwards(tree, new_parent);
+}
+
+static void remove_leaf(bvh_t *tree, size_t leaf) {
+  if (leaf == tree->root) {
+    tree->root = BVH_NULL_NODE;
+    return;
+  }
+
+  // the leaf's sibling takes its parent's place
+  size_t parent = tree->nodes[leaf].parent;
+  size_t grandparent = tree->nodes[parent].parent;
+  size_t sibling = tree->nodes[parent].child1 == leaf
+                       ? tree->nodes[parent].child2
+                       : tree->nodes[parent].child1;
+  replace_child(tree, grandparent, parent, sibling);
+  free_node(tree, parent);
+  fix_upwards(tree, grandparent);
+}
+
+size_t bvh_insert(bvh_t *tree, void *data, aabb_t box) {
+  size_t leaf = allocate_node(tree);
+  tree->nodes[leaf].data = data;
+  tree->nodes[leaf].box = aabb_fatten(box, tree->margin);
+  insert_leaf(tree, leaf);
+  tree->num_leaves++;
+  return leaf;
+}
+
+void bvh_remove(bvh_t *tree, size_t proxy) {
+  assert(proxy < tree->node_capacity && tree->nodes[proxy].height == 1);
+  remove_leaf(tree, proxy);
+  free_node(tree, proxy);
+  tree->num_leaves--;
+}
+
+bool bvh_move(bvh_t *tree, size_t proxy, aabb_t box) {
+  assert(proxy < tree->node_capacity && tree->nodes[proxy].height == 1);
+  aabb_t fat_box = tree->nodes[proxy].box;
+  if (aabb_contains(fat_box, box) &&
+      aabb_contains(aabb_fatten(box, BVH_MAX_MARGINS * tree->margin),
+                    fat_box)) {
+    return false;
+  }
+
+  remove_leaf(tree, proxy);
+  tree->nodes[proxy].box = aabb_fatten(box, tree->margin);
+  insert_leaf(tree, proxy);
+  return true;
+}
+
+aabb_t bvh_get_fat_aabb(bvh_t *tree, size_t proxy) {
+  assert(proxy < tree->node_capacity && tree->nodes[proxy].height == 1);
+  return tree->nodes[proxy].box;
+}
+
+/**
+ * Pushes a node onto the query stack, growing it if needed.
+ */
+static void push(bvh_t *tree, size_t *size, size_t index) {
+  if (*size == tree->stack_capacity) {
+    tree->stack_capacity *= 2;
+    tree->stack = realloc(tree->stack, sizeof(size_t) * tree->stack_capacity);
+    assert(tree->stack);
+  }
+  tree->stack[(*size)++] = index;
+}
+
+void bvh_query(bvh_t *tree, aabb_t box, proxy_handler_t handler, void *aux) {
+  if (tree->root == BVH_NULL_NODE) {
+    return;
+  }
+  size_t size = 0;
+  push(tree, &size, tree->root);
+  while (size > 0) {
+    bvh_node_t *node = &tree->nodes[tree->stack[--size]];
+    if (!aabb_overlap(node->box, box)) {
+      continue;
+    }
+    if (is_leaf(node)) {
+      handler(node->data, aux);
+    } else {
+      size_t child1 = node->child1, child2 = node->child2;
+      push(tree, &size, child1);
+      push(tree, &size, child2);
+    }
+  }
+}
+
+void bvh_raycast(bvh_t *tree, vector_t origin, vector_t delta, double radius,
+                 ray_handler_t handler, void *aux) {
+  if (tree->root == BVH_NULL_NODE) {
+    return;
+  }
+  double max_fraction = 1;
+  size_t size = 0;
+  push(tree, &size, tree->root);
+  while (size > 0) {
+    bvh_node_t *node = &tree->nodes[tree->stack[--size]];
+    aabb_t box = aabb_fatten(node->box, radius);
+    if (aabb_ray_fraction(box, origin, delta) > max_fraction) {
+      continue;
+    }
+    if (is_leaf(node)) {
+      max_fraction = fmin(max_fraction, handler(node->data, aux));
+    } else {
+      size_t child1 = node->child1, child2 = node->child2;
+      push(tree, &size, child1);
+      push(tree, &size, child2);
+    }
+  }
+}
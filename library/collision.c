@@ -5,26 +5,10 @@
 #include <math.h>
 #include <stdlib.h>
 
-/**
- * Returns a list of vectors representing the edges of a shape.
- *
- * @param shape the list of vectors representing the vertices of a shape
- * @return a list of vectors representing the edges of the shape
- */
-static list_t *get_edges(list_t *shape) {
-  list_t *edges = list_init(list_size(shape), free);
-
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t *vec = malloc(sizeof(vector_t));
-    assert(vec);
-    *vec =
-        vec_subtract(*(vector_t *)list_get(shape, i % list_size(shape)),
-                     *(vector_t *)list_get(shape, (i + 1) % list_size(shape)));
-    list_add(edges, vec);
-  }
-
-  return edges;
-}
+const size_t GJK_MAX_ITERATIONS = 32;
+const size_t EPA_MAX_ITERATIONS = 32;
+// EPA stops once the polytope is within this distance of the true boundary
+const double EPA_TOLERANCE = 1e-6;
 
 /**
  * Returns a vector containing the maximum and minimum length projections given
@@ -54,68 +38,1023 @@ static vector_t get_max_min_projections(list_t *shape, vector_t unit_axis) {
 }
 
 /**
- * Determines whether two convex polygons intersect.
- * The polygons are given as lists of vertices in counterclockwise order.
- * There is an edge between each pair of consecutive vertices,
- * and one between the first vertex and the last vertex.
+ * Returns how far a box reaches from its center along a unit axis.
+ */
+static double box_radius(vector_t half_extents, const vector_t *box_axes,
+                         vector_t unit_axis) {
+  return half_extents.x * fabs(vec_dot(box_axes[0], unit_axis)) +
+         half_extents.y * fabs(vec_dot(box_axes[1], unit_axis));
+}
+
+/**
+ * Like get_max_min_projections(), but for any kind of shape.
+ * Circles and boxes are projected from their centers, without vertices.
+ */
+static vector_t project_shape(polygon_t *shape, vector_t unit_axis) {
+  double radius;
+  switch (polygon_get_kind(shape)) {
+  case SHAPE_CIRCLE:
+    radius = polygon_get_radius(shape);
+    break;
+  case SHAPE_BOX:
+    radius = box_radius(polygon_get_half_extents(shape),
+                        polygon_get_normals(shape), unit_axis);
+    break;
+  case SHAPE_POLYGON:
+  default:
+    return get_max_min_projections(polygon_get_points(shape), unit_axis);
+  }
+  double center = vec_dot(polygon_get_center(shape), unit_axis);
+  return (vector_t){.x = center + radius, .y = center - radius};
+}
+
+/**
+ * Returns the number of distinct edge normals of a shape; a circle has none.
+ */
+static size_t num_axes(polygon_t *shape) {
+  switch (polygon_get_kind(shape)) {
+  case SHAPE_CIRCLE:
+    return 0;
+  case SHAPE_BOX:
+    return 2;
+  case SHAPE_POLYGON:
+  default:
+    return list_size(polygon_get_points(shape));
+  }
+}
+
+/**
+ * Returns how far shape2 would have to move either way along an axis to stop
+ * overlapping shape1. This is the overlap of their projections onto the axis,
+ * unless one projection contains the other. A negative result means the axis
+ * separates the shapes.
+ *
+ * @param reversed if non-NULL, set to whether shape2 should move against the
+ *   axis rather than along it
+ */
+static double axis_overlap(polygon_t *shape1, polygon_t *shape2,
+                           vector_t unit_axis, bool *reversed) {
+  vector_t proj1 = project_shape(shape1, unit_axis);
+  vector_t proj2 = project_shape(shape2, unit_axis);
+  double forwards = proj1.x - proj2.y;
+  double backwards = proj2.x - proj1.y;
+  if (reversed != NULL) {
+    *reversed = backwards < forwards;
+  }
+  return fmin(forwards, backwards);
+}
+
+/**
+ * Determines whether two convex polygons or boxes intersect.
+ * Only the edge normals of shape1 are used as separating axes.
+ * The shapes are only read, so the bodies' own polygons can be passed in.
  *
  * @param shape1 the first shape
  * @param shape2 the second shape
- * @return whether the shapes are colliding
+ * @param min_overlap set to the smallest overlap along any axis
+ * @param separating_edge if the shapes do not collide, set to the index of
+ *   the edge of shape1 whose normal separates them
+ * @return whether the shapes are colliding, and if so, the axis of least
+ *   overlap pointing from shape1 towards shape2
  */
-static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
-                                          double *min_overlap) {
-  list_t *edges1 = get_edges(shape1);
+static collision_info_t compare_collision(polygon_t *shape1,
+                                          polygon_t *shape2,
+                                          double *min_overlap,
+                                          size_t *separating_edge) {
+  const vector_t *normals1 = polygon_get_normals(shape1);
   vector_t best_axis;
 
-  for (size_t i = 0; i < list_size(edges1); i++) {
-    vector_t axis = *(vector_t *)list_get(edges1, i);
-    axis = vec_rotate(axis, M_PI / 2);
-    vector_t unit_axis = vec_multiply(1.0 / vec_get_length(axis), axis);
-
-    vector_t proj1 = get_max_min_projections(shape1, unit_axis);
-    vector_t proj2 = get_max_min_projections(shape2, unit_axis);
-
-    double overlap = fmin(proj1.x, proj2.x) - fmax(proj1.y, proj2.y);
+  for (size_t i = 0; i < num_axes(shape1); i++) {
+    vector_t unit_axis = normals1[i];
+    bool reversed;
+    double overlap = axis_overlap(shape1, shape2, unit_axis, &reversed);
     if (overlap < 0) {
-      list_free(edges1);
+      *separating_edge = i;
       return (collision_info_t){.collided = false};
     } else if (overlap < *min_overlap) {
       *min_overlap = overlap;
-      best_axis = unit_axis;
+      best_axis = reversed ? vec_negate(unit_axis) : unit_axis;
     }
   }
 
   // If we've reached this point, every pair of projections overlap, and thus
   // the polygons must collide.
-  list_free(edges1);
+  return (collision_info_t){
+      .collided = true, .axis = best_axis, .depth = *min_overlap};
+}
 
-  return (collision_info_t){.collided = true, .axis = best_axis};
+/**
+ * Tests two oriented boxes against each other on their four face axes,
+ * each box projected from its center and half-extents. The axis points from
+ * box1 towards box2.
+ *
+ * @param box1 the first box
+ * @param box2 the second box
+ * @param cache if non-NULL, the separating axis from the last call, which is
+ *   tested first and then updated
+ */
+static collision_info_t box_box_collision(polygon_t *box1, polygon_t *box2,
+                                          sat_cache_t *cache) {
+  vector_t between =
+      vec_subtract(polygon_get_center(box2), polygon_get_center(box1));
+  vector_t half1 = polygon_get_half_extents(box1);
+  vector_t half2 = polygon_get_half_extents(box2);
+  const vector_t *axes1 = polygon_get_normals(box1);
+  const vector_t *axes2 = polygon_get_normals(box2);
+  const vector_t *axes[2] = {axes1, axes2};
+
+  if (cache != NULL && cache->separated && cache->axis_edge < 2) {
+    vector_t axis = axes[cache->axis_body % 2][cache->axis_edge];
+    if (box_radius(half1, axes1, axis) + box_radius(half2, axes2, axis) <
+        fabs(vec_dot(between, axis))) {
+      return (collision_info_t){.collided = false};
+    }
+  }
+
+  vector_t best_axis = VEC_ZERO;
+  double min_overlap = __DBL_MAX__;
+  for (size_t body = 0; body < 2; body++) {
+    for (size_t i = 0; i < 2; i++) {
+      vector_t axis = axes[body][i];
+      double distance = vec_dot(between, axis);
+      double overlap = box_radius(half1, axes1, axis) +
+                       box_radius(half2, axes2, axis) - fabs(distance);
+      if (overlap < 0) {
+        if (cache != NULL) {
+          *cache = (sat_cache_t){
+              .separated = true, .axis_body = body, .axis_edge = i};
+        }
+        return (collision_info_t){.collided = false};
+      }
+      if (overlap < min_overlap) {
+        min_overlap = overlap;
+        best_axis = distance < 0 ? vec_negate(axis) : axis;
+      }
+    }
+  }
+
+  if (cache != NULL) {
+    cache->separated = false;
+  }
+  return (collision_info_t){
+      .collided = true, .axis = best_axis, .depth = min_overlap};
 }
 
-collision_info_t find_collision(body_t *body1, body_t *body2) {
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
+/**
+ * Tests a circle against an oriented box by clamping the circle's center to
+ * the box in the box's own frame. The axis points from the box towards the
+ * circle.
+ */
+static collision_info_t circle_box_collision(polygon_t *circle,
+                                             polygon_t *box) {
+  double radius = polygon_get_radius(circle);
+  vector_t half = polygon_get_half_extents(box);
+  const vector_t *axes = polygon_get_normals(box);
+  vector_t between =
+      vec_subtract(polygon_get_center(circle), polygon_get_center(box));
+  vector_t local = {.x = vec_dot(between, axes[0]),
+                    .y = vec_dot(between, axes[1])};
 
-  double c1_overlap = __DBL_MAX__;
-  double c2_overlap = __DBL_MAX__;
+  if (fabs(local.x) <= half.x && fabs(local.y) <= half.y) {
+    // the center is inside the box, so push it out of the nearest face
+    double gap_x = half.x - fabs(local.x);
+    double gap_y = half.y - fabs(local.y);
+    if (gap_x < gap_y) {
+      vector_t axis = local.x < 0 ? vec_negate(axes[0]) : axes[0];
+      return (collision_info_t){
+          .collided = true, .axis = axis, .depth = radius + gap_x};
+    }
+    vector_t axis = local.y < 0 ? vec_negate(axes[1]) : axes[1];
+    return (collision_info_t){
+        .collided = true, .axis = axis, .depth = radius + gap_y};
+  }
+
+  vector_t outside = {.x = local.x - fmax(-half.x, fmin(half.x, local.x)),
+                      .y = local.y - fmax(-half.y, fmin(half.y, local.y))};
+  double distance_squared = vec_dot(outside, outside);
+  if (distance_squared > radius * radius) {
+    return (collision_info_t){.collided = false};
+  }
+  double distance = sqrt(distance_squared);
+  vector_t axis = vec_add(vec_multiply(outside.x / distance, axes[0]),
+                          vec_multiply(outside.y / distance, axes[1]));
+  return (collision_info_t){
+      .collided = true, .axis = axis, .depth = radius - distance};
+}
+
+/**
+ * Tests two circles against each other. The axis points from circle1
+ * towards circle2.
+ */
+static collision_info_t circle_circle_collision(polygon_t *circle1,
+                                                polygon_t *circle2) {
+  vector_t between = vec_subtract(polygon_get_center(circle2),
+                                  polygon_get_center(circle1));
+  double radii = polygon_get_radius(circle1) + polygon_get_radius(circle2);
+  double distance_squared = vec_dot(between, between);
+  if (distance_squared > radii * radii) {
+    return (collision_info_t){.collided = false};
+  }
 
-  collision_info_t collision1 = compare_collision(shape1, shape2, &c1_overlap);
-  collision_info_t collision2 = compare_collision(shape2, shape1, &c2_overlap);
+  double distance = sqrt(distance_squared);
+  // concentric circles may be pushed apart in any direction
+  vector_t axis = distance > 0 ? vec_multiply(1 / distance, between)
+                               : (vector_t){.x = 1, .y = 0};
+  return (collision_info_t){
+      .collided = true, .axis = axis, .depth = radii - distance};
+}
 
-  list_free(shape1);
-  list_free(shape2);
+/**
+ * Tests a circle against a convex polygon, looking at each edge once.
+ * The axis points from the polygon towards the circle.
+ *
+ * @param circle the circle
+ * @param poly the polygon
+ * @param cache if non-NULL, the separating edge from the last call, which is
+ *   tested first and then updated
+ * @param poly_index which body the polygon is (0 or 1), to record in cache
+ */
+static collision_info_t circle_polygon_collision(polygon_t *circle,
+                                                 polygon_t *poly,
+                                                 sat_cache_t *cache,
+                                                 size_t poly_index) {
+  vector_t center = polygon_get_center(circle);
+  double radius = polygon_get_radius(circle);
+  list_t *points = polygon_get_points(poly);
+  const vector_t *normals = polygon_get_normals(poly);
+  size_t num_points = list_size(points);
 
+  // the circle lies entirely outside an edge if its center is more than
+  // radius beyond the edge's line
+  if (cache != NULL && cache->separated && cache->axis_body == poly_index &&
+      cache->axis_edge < num_points) {
+    vector_t *vertex = list_get(points, cache->axis_edge);
+    vector_t to_center = vec_subtract(center, *vertex);
+    if (vec_dot(normals[cache->axis_edge], to_center) > radius) {
+      return (collision_info_t){.collided = false};
+    }
+  }
+
+  // find the edge the center is furthest outside of
+  size_t best_edge = 0;
+  double max_separation = -__DBL_MAX__;
+  for (size_t i = 0; i < num_points; i++) {
+    vector_t *vertex = list_get(points, i);
+    double separation = vec_dot(normals[i], vec_subtract(center, *vertex));
+    if (separation > radius) {
+      if (cache != NULL) {
+        *cache = (sat_cache_t){
+            .separated = true, .axis_body = poly_index, .axis_edge = i};
+      }
+      return (collision_info_t){.collided = false};
+    }
+    if (separation > max_separation) {
+      max_separation = separation;
+      best_edge = i;
+    }
+  }
+  if (cache != NULL) {
+    cache->separated = false;
+  }
+
+  vector_t normal = normals[best_edge];
+  if (max_separation <= 0) {
+    // the center is inside the polygon
+    return (collision_info_t){
+        .collided = true, .axis = normal, .depth = radius - max_separation};
+  }
+
+  // the center is outside the closest edge, so it is nearest either that
+  // edge or one of its two vertices
+  vector_t *v1 = list_get(points, best_edge);
+  vector_t *v2 = list_get(points, (best_edge + 1) % num_points);
+  vector_t nearest;
+  if (vec_dot(vec_subtract(center, *v1), vec_subtract(*v2, *v1)) <= 0) {
+    nearest = *v1;
+  } else if (vec_dot(vec_subtract(center, *v2), vec_subtract(*v1, *v2)) <= 0) {
+    nearest = *v2;
+  } else {
+    return (collision_info_t){
+        .collided = true, .axis = normal, .depth = radius - max_separation};
+  }
+
+  vector_t to_center = vec_subtract(center, nearest);
+  double distance_squared = vec_dot(to_center, to_center);
+  if (distance_squared > radius * radius) {
+    return (collision_info_t){.collided = false};
+  }
+  double distance = sqrt(distance_squared);
+  vector_t axis = distance > 0 ? vec_multiply(1 / distance, to_center) : normal;
+  return (collision_info_t){
+      .collided = true, .axis = axis, .depth = radius - distance};
+}
+
+/**
+ * Tests a circle against a box or a polygon. The axis points from the other
+ * shape towards the circle.
+ */
+static collision_info_t circle_shape_collision(polygon_t *circle,
+                                               polygon_t *shape,
+                                               sat_cache_t *cache,
+                                               size_t shape_index) {
+  switch (polygon_get_kind(shape)) {
+  case SHAPE_CIRCLE:
+    return circle_circle_collision(shape, circle);
+  case SHAPE_BOX:
+    return circle_box_collision(circle, shape);
+  case SHAPE_POLYGON:
+  default:
+    return circle_polygon_collision(circle, shape, cache, shape_index);
+  }
+}
+
+/**
+ * Tests a pair of bodies involving at least one circle, or two boxes, using
+ * the test specific to their shapes. The axis points from body1 towards
+ * body2.
+ */
+static collision_info_t find_special_collision(polygon_t *poly1,
+                                               polygon_t *poly2,
+                                               sat_cache_t *cache) {
+  if (polygon_get_kind(poly2) == SHAPE_CIRCLE) {
+    return circle_shape_collision(poly2, poly1, cache, 0);
+  }
+  if (polygon_get_kind(poly1) == SHAPE_CIRCLE) {
+    collision_info_t info = circle_shape_collision(poly1, poly2, cache, 1);
+    info.axis = vec_negate(info.axis);
+    return info;
+  }
+  return box_box_collision(poly1, poly2, cache);
+}
+
+/**
+ * Returns whether a pair of polygons has a test specific to their shapes:
+ * either is a circle, or both are boxes.
+ */
+static bool has_special_test(polygon_t *poly1, polygon_t *poly2) {
+  shape_kind_t kind1 = polygon_get_kind(poly1);
+  shape_kind_t kind2 = polygon_get_kind(poly2);
+  return kind1 == SHAPE_CIRCLE || kind2 == SHAPE_CIRCLE ||
+         (kind1 == SHAPE_BOX && kind2 == SHAPE_BOX);
+}
+
+collision_info_t find_collision_sat(body_t *body1, body_t *body2,
+                                    sat_cache_t *cache) {
+  // borrow the bodies' vertices rather than copying them with body_get_shape()
+  polygon_t *poly1 = body_get_polygon(body1);
+  polygon_t *poly2 = body_get_polygon(body2);
+  if (has_special_test(poly1, poly2)) {
+    return find_special_collision(poly1, poly2, cache);
+  }
+
+  // bodies rarely move far in one tick, so an edge that separated them last
+  // time usually still does
+  if (cache != NULL && cache->separated) {
+    polygon_t *owner = cache->axis_body == 0 ? poly1 : poly2;
+    if (cache->axis_edge < num_axes(owner)) {
+      vector_t axis = polygon_get_normals(owner)[cache->axis_edge];
+      if (axis_overlap(poly1, poly2, axis, NULL) < 0) {
+        return (collision_info_t){.collided = false};
+      }
+    }
+  }
+
+  double c1_overlap = __DBL_MAX__;
+  double c2_overlap = __DBL_MAX__;
+  size_t separating_edge = 0;
+
+  collision_info_t collision1 =
+      compare_collision(poly1, poly2, &c1_overlap, &separating_edge);
   if (!collision1.collided) {
+    if (cache != NULL) {
+      *cache = (sat_cache_t){
+          .separated = true, .axis_body = 0, .axis_edge = separating_edge};
+    }
     return collision1;
   }
 
+  collision_info_t collision2 =
+      compare_collision(poly2, poly1, &c2_overlap, &separating_edge);
   if (!collision2.collided) {
+    if (cache != NULL) {
+      *cache = (sat_cache_t){
+          .separated = true, .axis_body = 1, .axis_edge = separating_edge};
+    }
     return collision2;
   }
 
+  if (cache != NULL) {
+    cache->separated = false;
+  }
   if (c1_overlap < c2_overlap) {
     return collision1;
   }
+  // collision2's axis points from body2 towards body1
+  collision2.axis = vec_negate(collision2.axis);
   return collision2;
 }
+
+collision_info_t find_collision(body_t *body1, body_t *body2) {
+  return find_collision_sat(body1, body2, NULL);
+}
+
+/**
+ * A point on the Minkowski difference of two shapes, along with the vertices
+ * it is the difference of.
+ */
+typedef struct support_point {
+  vector_t point;
+  size_t index1;
+  size_t index2;
+} support_point_t;
+
+/**
+ * Returns the index of the vertex of a shape furthest along a direction.
+ */
+static size_t furthest_vertex(polygon_t *shape, vector_t direction) {
+  size_t best = 0;
+  double best_proj = -__DBL_MAX__;
+  for (size_t i = 0; i < polygon_num_vertices(shape); i++) {
+    double proj = vec_dot(polygon_get_vertex(shape, i), direction);
+    if (proj > best_proj) {
+      best_proj = proj;
+      best = i;
+    }
+  }
+  return best;
+}
+
+static support_point_t make_support_point(polygon_t *shape1,
+                                          polygon_t *shape2, size_t index1,
+                                          size_t index2) {
+  vector_t v1 = polygon_get_vertex(shape1, index1);
+  vector_t v2 = polygon_get_vertex(shape2, index2);
+  return (support_point_t){
+      .point = vec_subtract(v1, v2), .index1 = index1, .index2 = index2};
+}
+
+/**
+ * Returns the point of shape1 - shape2 furthest along a direction.
+ */
+static support_point_t support(polygon_t *shape1, polygon_t *shape2,
+                               vector_t direction) {
+  return make_support_point(shape1, shape2,
+                            furthest_vertex(shape1, direction),
+                            furthest_vertex(shape2, vec_negate(direction)));
+}
+
+/**
+ * Returns the component of v perpendicular to the segment direction `edge`,
+ * i.e. a vector perpendicular to edge on the same side as v.
+ * A zero result means v is parallel to edge.
+ */
+static vector_t perpendicular_towards(vector_t edge, vector_t v) {
+  // the triple product edge x v x edge, expanded in two dimensions
+  double cross = vec_cross(edge, v);
+  return (vector_t){.x = -edge.y * cross, .y = edge.x * cross};
+}
+
+/**
+ * Reduces a simplex to the feature closest to the origin and finds the
+ * direction from that feature towards the origin.
+ * The newest point is always last. Returns true if the simplex contains the
+ * origin, in which case it is left as a triangle.
+ */
+static bool update_simplex(support_point_t *simplex, size_t *num_points,
+                           vector_t *direction) {
+  support_point_t a = simplex[*num_points - 1];
+  vector_t to_origin = vec_negate(a.point);
+
+  if (*num_points == 1) {
+    *direction = to_origin;
+    return vec_dot(to_origin, to_origin) == 0;
+  }
+
+  if (*num_points == 2) {
+    vector_t ab = vec_subtract(simplex[0].point, a.point);
+    if (vec_dot(ab, to_origin) <= 0) {
+      simplex[0] = a;
+      *num_points = 1;
+      *direction = to_origin;
+      return vec_dot(to_origin, to_origin) == 0;
+    }
+    *direction = perpendicular_towards(ab, to_origin);
+    if (vec_dot(*direction, *direction) == 0) {
+      // the origin lies on the segment; look to either side of it
+      *direction = (vector_t){.x = -ab.y, .y = ab.x};
+    }
+    return false;
+  }
+
+  vector_t ab = vec_subtract(simplex[1].point, a.point);
+  vector_t ac = vec_subtract(simplex[0].point, a.point);
+  if (vec_cross(ab, ac) == 0) {
+    // a flat triangle cannot contain the origin, so fall back to ab
+    simplex[0] = simplex[1];
+    simplex[1] = a;
+    *num_points = 2;
+    return update_simplex(simplex, num_points, direction);
+  }
+  // normals of the edges through a, pointing away from the third point
+  vector_t ab_normal = perpendicular_towards(ab, vec_negate(ac));
+  vector_t ac_normal = perpendicular_towards(ac, vec_negate(ab));
+  if (vec_dot(ab_normal, to_origin) > 0) {
+    // the origin is beyond edge ab, so drop c
+    simplex[0] = simplex[1];
+    simplex[1] = a;
+    *num_points = 2;
+    *direction = ab_normal;
+    return false;
+  }
+  if (vec_dot(ac_normal, to_origin) > 0) {
+    // the origin is beyond edge ac, so drop b
+    simplex[1] = a;
+    *num_points = 2;
+    *direction = ac_normal;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Expands the triangle GJK found around the origin towards the boundary of
+ * the Minkowski difference, to find the boundary edge closest to the origin.
+ * Its normal is the collision axis, and its distance the depth.
+ */
+static collision_info_t expand_polytope(polygon_t *shape1,
+                                        polygon_t *shape2,
+                                        support_point_t *simplex) {
+  // the polytope only gains one vertex per iteration, so it fits on the stack
+  vector_t polytope[3 + EPA_MAX_ITERATIONS];
+  size_t size = 3;
+  polytope[0] = simplex[0].point;
+  // keep the polytope counterclockwise
+  if (vec_cross(vec_subtract(simplex[1].point, simplex[0].point),
+                vec_subtract(simplex[2].point, simplex[0].point)) >= 0) {
+    polytope[1] = simplex[1].point;
+    polytope[2] = simplex[2].point;
+  } else {
+    polytope[1] = simplex[2].point;
+    polytope[2] = simplex[1].point;
+  }
+
+  vector_t best_normal = VEC_ZERO;
+  double best_distance = __DBL_MAX__;
+  for (size_t iteration = 0; iteration <= EPA_MAX_ITERATIONS; iteration++) {
+    size_t best_edge = 0;
+    best_distance = __DBL_MAX__;
+    for (size_t i = 0; i < size; i++) {
+      vector_t edge = vec_subtract(polytope[(i + 1) % size], polytope[i]);
+      double length = vec_get_length(edge);
+      if (length == 0) {
+        continue;
+      }
+      vector_t normal = {.x = edge.y / length, .y = -edge.x / length};
+      double distance = vec_dot(normal, polytope[i]);
+      if (distance < best_distance) {
+        best_distance = distance;
+        best_normal = normal;
+        best_edge = i;
+      }
+    }
+
+    vector_t point = support(shape1, shape2, best_normal).point;
+    if (vec_dot(point, best_normal) - best_distance < EPA_TOLERANCE ||
+        iteration == EPA_MAX_ITERATIONS) {
+      break;
+    }
+    for (size_t i = size; i > best_edge + 1; i--) {
+      polytope[i] = polytope[i - 1];
+    }
+    polytope[best_edge + 1] = point;
+    size++;
+  }
+
+  return (collision_info_t){
+      .collided = true, .axis = best_normal, .depth = fmax(best_distance, 0)};
+}
+
+collision_info_t find_collision_gjk(body_t *body1, body_t *body2,
+                                    gjk_cache_t *cache) {
+  polygon_t *shape1 = body_get_polygon(body1);
+  polygon_t *shape2 = body_get_polygon(body2);
+  if (has_special_test(shape1, shape2)) {
+    // these tests are already linear in the number of vertices
+    return find_special_collision(shape1, shape2, NULL);
+  }
+
+  support_point_t simplex[3];
+  size_t num_points = 0;
+  if (cache != NULL) {
+    for (size_t i = 0; i < cache->num_points; i++) {
+      if (cache->index1[i] < polygon_num_vertices(shape1) &&
+          cache->index2[i] < polygon_num_vertices(shape2)) {
+        simplex[num_points++] = make_support_point(
+            shape1, shape2, cache->index1[i], cache->index2[i]);
+      }
+    }
+  }
+  if (num_points == 0) {
+    vector_t direction = vec_subtract(body_get_centroid(body2),
+                                      body_get_centroid(body1));
+    if (vec_dot(direction, direction) == 0) {
+      direction = (vector_t){.x = 1, .y = 0};
+    }
+    simplex[num_points++] = support(shape1, shape2, direction);
+  }
+
+  vector_t direction;
+  bool contains_origin = update_simplex(simplex, &num_points, &direction);
+  for (size_t i = 0; i < GJK_MAX_ITERATIONS && !contains_origin; i++) {
+    support_point_t point = support(shape1, shape2, direction);
+    if (vec_dot(point.point, direction) < 0) {
+      // the furthest point towards the origin falls short of it
+      break;
+    }
+    simplex[num_points++] = point;
+    contains_origin = update_simplex(simplex, &num_points, &direction);
+  }
+
+  if (cache != NULL) {
+    cache->num_points = num_points;
+    for (size_t i = 0; i < num_points; i++) {
+      cache->index1[i] = simplex[i].index1;
+      cache->index2[i] = simplex[i].index2;
+    }
+  }
+
+  if (!contains_origin) {
+    return (collision_info_t){.collided = false};
+  }
+  if (num_points < 3) {
+    // the origin is a vertex of the difference, so the shapes only touch
+    vector_t axis = vec_subtract(body_get_centroid(body2),
+                                 body_get_centroid(body1));
+    return (collision_info_t){
+        .collided = true,
+        .axis = vec_multiply(1 / vec_get_length(axis), axis),
+        .depth = 0};
+  }
+  // the outward normal of the edge of shape1 - shape2 closest to the origin
+  // points from body1 towards body2
+  return expand_polytope(shape1, shape2, simplex);
+}
+
+collision_info_t find_collision_with(narrow_phase_t narrow_phase,
+                                     body_t *body1, body_t *body2,
+                                     collision_cache_t *cache) {
+  switch (narrow_phase) {
+  case NARROW_PHASE_GJK:
+    return find_collision_gjk(body1, body2,
+                              cache != NULL ? &cache->simplex : NULL);
+  case NARROW_PHASE_SAT:
+  default:
+    return find_collision_sat(body1, body2,
+                              cache != NULL ? &cache->axis : NULL);
+  }
+}
+
+/**
+ * An edge of a shape facing along some direction, in counterclockwise order.
+ */
+typedef struct contact_edge {
+  vector_t start;
+  vector_t end;
+} contact_edge_t;
+
+/**
+ * Returns the edge of a shape that most directly faces along a direction:
+ * whichever of the two edges at the furthest vertex is most perpendicular to
+ * the direction.
+ */
+static contact_edge_t facing_edge(polygon_t *shape, vector_t direction) {
+  size_t num_points = polygon_num_vertices(shape);
+  size_t index = furthest_vertex(shape, direction);
+  vector_t vertex = polygon_get_vertex(shape, index);
+  vector_t prev =
+      polygon_get_vertex(shape, (index + num_points - 1) % num_points);
+  vector_t next = polygon_get_vertex(shape, (index + 1) % num_points);
+
+  vector_t from_prev = vec_subtract(vertex, prev);
+  vector_t from_next = vec_subtract(vertex, next);
+  double prev_slope =
+      vec_dot(from_prev, direction) / vec_get_length(from_prev);
+  double next_slope =
+      vec_dot(from_next, direction) / vec_get_length(from_next);
+  if (prev_slope <= next_slope) {
+    return (contact_edge_t){.start = prev, .end = vertex};
+  }
+  return (contact_edge_t){.start = vertex, .end = next};
+}
+
+/**
+ * Clips a segment to the points p with vec_dot(direction, p) >= offset.
+ * Returns the number of points left, which are written to clipped.
+ */
+static size_t clip_segment(vector_t *points, vector_t direction, double offset,
+                           vector_t *clipped) {
+  size_t num_clipped = 0;
+  double distance1 = vec_dot(direction, points[0]) - offset;
+  double distance2 = vec_dot(direction, points[1]) - offset;
+  if (distance1 >= 0) {
+    clipped[num_clipped++] = points[0];
+  }
+  if (distance2 >= 0) {
+    clipped[num_clipped++] = points[1];
+  }
+  if (distance1 * distance2 < 0) {
+    double fraction = distance1 / (distance1 - distance2);
+    clipped[num_clipped++] = vec_add(
+        points[0],
+        vec_multiply(fraction, vec_subtract(points[1], points[0])));
+  }
+  return num_clipped;
+}
+
+/**
+ * Finds the contact points of two colliding polygons or boxes by clipping.
+ * Returns the number of points found, which may be 0 if the shapes barely
+ * touch.
+ */
+static size_t clip_contacts(polygon_t *shape1, polygon_t *shape2,
+                            vector_t normal, contact_manifold_t *manifold) {
+  contact_edge_t edge1 = facing_edge(shape1, normal);
+  contact_edge_t edge2 = facing_edge(shape2, vec_negate(normal));
+  vector_t dir1 = vec_subtract(edge1.end, edge1.start);
+  vector_t dir2 = vec_subtract(edge2.end, edge2.start);
+
+  // the reference edge is the one most perpendicular to the normal; the
+  // other, incident edge is clipped to the reference edge's extent
+  contact_edge_t reference = edge1;
+  contact_edge_t incident = edge2;
+  if (fabs(vec_dot(dir1, normal)) / vec_get_length(dir1) >
+      fabs(vec_dot(dir2, normal)) / vec_get_length(dir2)) {
+    reference = edge2;
+    incident = edge1;
+  }
+  vector_t along = vec_subtract(reference.end, reference.start);
+  along = vec_multiply(1 / vec_get_length(along), along);
+
+  vector_t points[2] = {incident.start, incident.end};
+  vector_t clipped[2];
+  if (clip_segment(points, along, vec_dot(along, reference.start), clipped) <
+      2) {
+    return 0;
+  }
+  if (clip_segment(clipped, vec_negate(along),
+                   -vec_dot(along, reference.end), points) < 2) {
+    return 0;
+  }
+
+  // keep the clipped points behind the reference edge, whose outward normal
+  // is its direction turned clockwise
+  vector_t outward = {.x = along.y, .y = -along.x};
+  double face = vec_dot(outward, reference.start);
+  size_t num_points = 0;
+  for (size_t i = 0; i < 2; i++) {
+    double depth = face - vec_dot(outward, points[i]);
+    if (depth >= 0) {
+      manifold->points[num_points] = points[i];
+      manifold->depths[num_points] = depth;
+      num_points++;
+    }
+  }
+  return num_points;
+}
+
+contact_manifold_t find_contact_manifold(body_t *body1, body_t *body2,
+                                         collision_info_t info) {
+  assert(info.collided);
+  polygon_t *shape1 = body_get_polygon(body1);
+  polygon_t *shape2 = body_get_polygon(body2);
+  contact_manifold_t manifold = {
+      .num_points = 1, .normal = info.axis, .depth = info.depth};
+  manifold.depths[0] = info.depth;
+
+  // a circle touches the other body at the point of it furthest across
+  if (polygon_get_kind(shape2) == SHAPE_CIRCLE) {
+    manifold.points[0] =
+        vec_subtract(polygon_get_center(shape2),
+                     vec_multiply(polygon_get_radius(shape2), info.axis));
+    return manifold;
+  }
+  if (polygon_get_kind(shape1) == SHAPE_CIRCLE) {
+    manifold.points[0] =
+        vec_add(polygon_get_center(shape1),
+                vec_multiply(polygon_get_radius(shape1), info.axis));
+    return manifold;
+  }
+
+  manifold.num_points = clip_contacts(shape1, shape2, info.axis, &manifold);
+  if (manifold.num_points == 0) {
+    // fall back on body2's deepest vertex
+    manifold.num_points = 1;
+    manifold.points[0] = polygon_get_vertex(
+        shape2, furthest_vertex(shape2, vec_negate(info.axis)));
+    manifold.depths[0] = info.depth;
+  }
+  return manifold;
+}
+
+/**
+ * Returns when two circles moving apart at a relative displacement first
+ * touch, solving |between + t * motion| = radii for the earliest t. The
+ * circles must not be colliding already.
+ */
+static double circle_time_of_impact(polygon_t *circle1, polygon_t *circle2,
+                                    vector_t motion) {
+  vector_t between = vec_subtract(polygon_get_center(circle2),
+                                  polygon_get_center(circle1));
+  double radii = polygon_get_radius(circle1) + polygon_get_radius(circle2);
+  double a = vec_dot(motion, motion);
+  double b = 2 * vec_dot(between, motion);
+  double c = vec_dot(between, between) - radii * radii;
+  if (a == 0) {
+    // not moving relative to each other
+    return INFINITY;
+  }
+  double discriminant = b * b - 4 * a * c;
+  if (discriminant < 0) {
+    return INFINITY;
+  }
+  double time = (-b - sqrt(discriminant)) / (2 * a);
+  return time >= 0 && time <= 1 ? time : INFINITY;
+}
+
+/**
+ * Narrows the interval of times during which shape2, displaced by
+ * time * motion, overlaps shape1 along an axis.
+ *
+ * @param first the start of the interval, raised if the shapes only start
+ *   overlapping along the axis later
+ * @param last the end of the interval, lowered if the shapes stop
+ *   overlapping along the axis sooner
+ */
+static void sweep_axis(polygon_t *shape1, polygon_t *shape2, vector_t motion,
+                       vector_t unit_axis, double *first, double *last) {
+  vector_t proj1 = project_shape(shape1, unit_axis);
+  vector_t proj2 = project_shape(shape2, unit_axis);
+  double speed = vec_dot(motion, unit_axis);
+  if (speed == 0) {
+    if (proj2.y > proj1.x || proj2.x < proj1.y) {
+      *first = INFINITY;
+    }
+    return;
+  }
+  double enter = (proj1.y - proj2.x) / speed;
+  double leave = (proj1.x - proj2.y) / speed;
+  if (enter > leave) {
+    double swap = enter;
+    enter = leave;
+    leave = swap;
+  }
+  *first = fmax(*first, enter);
+  *last = fmin(*last, leave);
+}
+
+/**
+ * Returns where a circle of a given radius, cast from origin along delta,
+ * first touches a circle with a given center and radius.
+ */
+static cast_info_t cast_at_circle(vector_t center, double body_radius,
+                                  vector_t origin, double radius,
+                                  vector_t delta) {
+  cast_info_t info = {.hit = false};
+  vector_t between = vec_subtract(origin, center);
+  double radii = body_radius + radius;
+  double a = vec_dot(delta, delta);
+  double b = 2 * vec_dot(between, delta);
+  double c = vec_dot(between, between) - radii * radii;
+  if (c <= 0 || a == 0) {
+    // already touching, or not moving
+    return info;
+  }
+  double discriminant = b * b - 4 * a * c;
+  if (discriminant < 0) {
+    return info;
+  }
+  double fraction = (-b - sqrt(discriminant)) / (2 * a);
+  if (fraction < 0 || fraction > 1) {
+    return info;
+  }
+  info.hit = true;
+  info.fraction = fraction;
+  info.normal = vec_multiply(
+      1 / radii, vec_add(between, vec_multiply(fraction, delta)));
+  info.point = vec_add(center, vec_multiply(body_radius, info.normal));
+  return info;
+}
+
+/**
+ * Returns where a circle of a given radius, cast from origin along delta,
+ * first touches a polygon or box. It first touches either the face of an
+ * edge, pushed out by the radius, or the circle of that radius around a
+ * corner. A radius of 0 casts a ray.
+ */
+static cast_info_t cast_at_polygon(polygon_t *shape, vector_t origin,
+                                   double radius, vector_t delta) {
+  cast_info_t best = {.hit = false, .fraction = INFINITY};
+  size_t n = polygon_num_vertices(shape);
+  bool inside = true;
+  double closest = INFINITY;
+  for (size_t i = 0; i < n; i++) {
+    vector_t vertex = polygon_get_vertex(shape, i);
+    vector_t next = polygon_get_vertex(shape, (i + 1) % n);
+    vector_t edge = vec_subtract(next, vertex);
+    double length_squared = vec_dot(edge, edge);
+    vector_t normal =
+        vec_multiply(1 / sqrt(length_squared), (vector_t){edge.y, -edge.x});
+    vector_t offset = vec_subtract(origin, vertex);
+    double distance = vec_dot(offset, normal);
+    inside = inside && distance < 0;
+    double along = fmax(0, fmin(1, vec_dot(offset, edge) / length_squared));
+    vector_t from_edge = vec_subtract(offset, vec_multiply(along, edge));
+    closest = fmin(closest, vec_get_length(from_edge));
+
+    double approach = vec_dot(delta, normal);
+    if (approach < 0 && distance >= radius) {
+      double fraction = (distance - radius) / -approach;
+      vector_t center = vec_add(offset, vec_multiply(fraction, delta));
+      double hit_along = vec_dot(center, edge) / length_squared;
+      if (fraction <= 1 && fraction < best.fraction && hit_along >= 0 &&
+          hit_along <= 1) {
+        best = (cast_info_t){.hit = true,
+                             .fraction = fraction,
+                             .point = vec_add(vertex,
+                                              vec_multiply(hit_along, edge)),
+                             .normal = normal};
+      }
+    }
+    if (radius > 0) {
+      cast_info_t corner = cast_at_circle(vertex, 0, origin, radius, delta);
+      if (corner.hit && corner.fraction < best.fraction) {
+        best = corner;
+      }
+    }
+  }
+  if (inside || closest < radius) {
+    // already touching at the start
+    best.hit = false;
+  }
+  return best;
+}
+
+double find_time_of_impact(body_t *body1, vector_t motion1, body_t *body2,
+                           vector_t motion2) {
+  // only body2 moves, relative to body1
+  vector_t motion = vec_subtract(motion2, motion1);
+  collision_info_t touching = find_collision(body1, body2);
+  if (touching.collided) {
+    // the axis points towards body2, so moving against it drives the
+    // bodies further into each other
+    return vec_dot(motion, touching.axis) < 0 ? 0 : INFINITY;
+  }
+
+  polygon_t *shape1 = body_get_polygon(body1);
+  polygon_t *shape2 = body_get_polygon(body2);
+  bool circle1 = polygon_get_kind(shape1) == SHAPE_CIRCLE;
+  bool circle2 = polygon_get_kind(shape2) == SHAPE_CIRCLE;
+  if (circle1 && circle2) {
+    return circle_time_of_impact(shape1, shape2, motion);
+  }
+  if (circle1 || circle2) {
+    // a circle first touches a polygon's face or the circle around one of
+    // its corners, which casting the circle at the polygon finds exactly
+    polygon_t *circle = circle1 ? shape1 : shape2;
+    cast_info_t cast = cast_at_polygon(
+        circle1 ? shape2 : shape1, polygon_get_center(circle),
+        polygon_get_radius(circle), circle1 ? vec_negate(motion) : motion);
+    return cast.hit ? cast.fraction : INFINITY;
+  }
+
+  // under translation, the edges of shape1 - shape2 are the edges of the two
+  // shapes, so shape2 first touches shape1 once it overlaps on every axis
+  double first = 0;
+  double last = 1;
+  polygon_t *shapes[2] = {shape1, shape2};
+  for (size_t i = 0; i < 2; i++) {
+    const vector_t *normals = polygon_get_normals(shapes[i]);
+    for (size_t j = 0; j < num_axes(shapes[i]) && first <= last; j++) {
+      sweep_axis(shape1, shape2, motion, normals[j], &first, &last);
+    }
+  }
+  if (first > last || last <= 0) {
+    // they never touch, or only touch as they move apart
+    return INFINITY;
+  }
+  return first;
+}
+
+cast_info_t find_shapecast(body_t *body, vector_t origin, double radius,
+                           vector_t delta) {
+  polygon_t *shape = body_get_polygon(body);
+  if (polygon_get_kind(shape) == SHAPE_CIRCLE) {
+    return cast_at_circle(polygon_get_center(shape), polygon_get_radius(shape),
+                          origin, radius, delta);
+  }
+  return cast_at_polygon(shape, origin, radius, delta);
+}
+
+cast_info_t find_raycast(body_t *body, vector_t origin, vector_t delta) {
+  return find_shapecast(body, origin, 0, delta);
+}
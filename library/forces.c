@@ -4,6 +4,8 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "quadtree.h"
+#include "springs.h"
 #include "state.h"
 #include "sdl_wrapper.h"
 #include <SDL2/SDL_mixer.h>
@@ -23,6 +25,9 @@ typedef struct collision_aux {
   collision_handler_t handler;
   bool collided;
   void *aux; // aux (if allocated in memory) should be free'd by the caller
+  scene_t *scene; // consulted for the narrow phase to use
+  collision_cache_t cache; // the narrow phase's state from the last tick
+  bool resolves_contact; // whether the scene's contact solver handles them
 } collision_aux_t;
 
 force_entry_t *force_entry_init(force_creator_t force_creator, void *aux,
@@ -32,6 +37,15 @@ force_entry_t *force_entry_init(force_creator_t force_creator, void *aux,
   entry->force_creator = force_creator;
   entry->aux = aux;
   entry->bodies = bodies;
+  entry->is_collision = false;
+  entry->last_tick = 0;
+  entry->aux_freer = NULL;
+  entry->solver = NULL;
+  entry->removed = false;
+  entry->handle = (force_handle_t){.index = 0, .generation = 0};
+  entry->generated = false;
+  entry->rule_index = 0;
+  entry->active_index = 0;
   return entry;
 }
 
@@ -42,8 +56,8 @@ void body_aux_free(void *aux) {
 
 void force_free(force_entry_t *entry) {
   force_entry_t *force = (force_entry_t *)entry;
-  if (force->aux) {
-    body_aux_free(force->aux);
+  if (force->aux_freer) {
+    force->aux_freer(force->aux);
   }
   if (force->bodies) {
     list_free(force->bodies);
@@ -67,9 +81,9 @@ body_aux_t *body_aux_init(double force_const, list_t *bodies) {
   return aux;
 }
 
-collision_aux_t *collision_aux_init(double force_const, list_t *bodies,
-                                    collision_handler_t handler, bool collided,
-                                    void *aux) {
+collision_aux_t *collision_aux_init(scene_t *scene, double force_const,
+                                    list_t *bodies, collision_handler_t handler,
+                                    bool collided, void *aux) {
   collision_aux_t *collision_aux = malloc(sizeof(collision_aux_t));
   assert(collision_aux);
 
@@ -78,9 +92,21 @@ collision_aux_t *collision_aux_init(double force_const, list_t *bodies,
   collision_aux->handler = handler;
   collision_aux->collided = collided;
   collision_aux->aux = aux;
+  collision_aux->scene = scene;
+  collision_aux->cache = (collision_cache_t){0};
+  collision_aux->resolves_contact = false;
   return collision_aux;
 }
 
+/**
+ * Frees a collision force creator's state, but not the handler's aux, which
+ * belongs to the caller.
+ */
+static void collision_aux_free(void *aux) {
+  list_free(((collision_aux_t *)aux)->bodies);
+  free(aux);
+}
+
 /**
  * The force creator for gravitational forces between objects. Calculates
  * the magnitude of the force components and adds the force to each
@@ -119,8 +145,87 @@ void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
   list_add(aux_bodies, body1);
   list_add(aux_bodies, body2);
   body_aux_t *aux = body_aux_init(G, aux_bodies);
-  scene_add_bodies_force_creator(scene, (force_creator_t)newtonian_gravity, aux,
-                                 bodies);
+  scene_add_force_creator_with_freer(
+      scene, (force_creator_t)newtonian_gravity, aux, bodies, body_aux_free);
+}
+
+typedef struct gravity_field_aux {
+  scene_t *scene;
+  double G;
+  body_filter_t filter;
+  void *filter_aux;
+  quadtree_t *tree;
+  // the bodies pulled by the field this tick, reused between ticks
+  body_t **bodies;
+  vector_t *positions;
+  double *masses;
+  size_t capacity;
+} gravity_field_aux_t;
+
+static void gravity_field_aux_free(gravity_field_aux_t *aux) {
+  quadtree_free(aux->tree);
+  free(aux->bodies);
+  free(aux->positions);
+  free(aux->masses);
+  free(aux);
+}
+
+/**
+ * The force creator for Barnes-Hut gravity. Rebuilds the quadtree over the
+ * bodies with finite mass that pass the filter, then pulls each of them
+ * towards the others.
+ *
+ * @param info the gravity field's auxiliary information
+ */
+static void gravity_field(void *info) {
+  gravity_field_aux_t *aux = info;
+  size_t num_bodies = scene_bodies(aux->scene);
+  if (num_bodies > aux->capacity) {
+    aux->capacity = num_bodies;
+    aux->bodies = realloc(aux->bodies, sizeof(body_t *) * aux->capacity);
+    aux->positions = realloc(aux->positions, sizeof(vector_t) * aux->capacity);
+    aux->masses = realloc(aux->masses, sizeof(double) * aux->capacity);
+    assert(aux->bodies && aux->positions && aux->masses);
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = scene_get_body(aux->scene, i);
+    double mass = body_get_mass(body);
+    if (body_is_removed(body) || isinf(mass) ||
+        (aux->filter && !aux->filter(body, aux->filter_aux))) {
+      continue;
+    }
+    aux->bodies[count] = body;
+    aux->positions[count] = body_get_centroid(body);
+    aux->masses[count] = mass;
+    count++;
+  }
+
+  quadtree_build(aux->tree, aux->positions, aux->masses, count);
+  for (size_t i = 0; i < count; i++) {
+    vector_t field =
+        quadtree_field(aux->tree, aux->positions[i], i, MIN_DIST);
+    body_add_force(aux->bodies[i],
+                   vec_multiply(aux->G * aux->masses[i], field));
+  }
+}
+
+void create_barnes_hut_gravity(scene_t *scene, double G, double theta,
+                               body_filter_t filter, void *aux) {
+  gravity_field_aux_t *field_aux = malloc(sizeof(gravity_field_aux_t));
+  assert(field_aux);
+  field_aux->scene = scene;
+  field_aux->G = G;
+  field_aux->filter = filter;
+  field_aux->filter_aux = aux;
+  field_aux->tree = quadtree_init(theta);
+  field_aux->bodies = NULL;
+  field_aux->positions = NULL;
+  field_aux->masses = NULL;
+  field_aux->capacity = 0;
+  scene_add_field_force_creator(scene, (force_creator_t)gravity_field,
+                                field_aux, (free_func_t)gravity_field_aux_free);
 }
 
 /**
@@ -154,8 +259,33 @@ void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
   list_add(aux_bodies, body1);
   list_add(aux_bodies, body2);
   body_aux_t *aux = body_aux_init(k, aux_bodies);
-  scene_add_bodies_force_creator(scene, (force_creator_t)spring_force, aux,
-                                 bodies);
+  scene_add_force_creator_with_freer(scene, (force_creator_t)spring_force, aux,
+                                     bodies, body_aux_free);
+}
+
+/**
+ * Makes a list of a spring network's bodies, for registering it.
+ */
+static list_t *network_bodies(spring_network_t *network) {
+  size_t num_bodies = spring_network_bodies(network);
+  list_t *bodies = list_init(num_bodies, NULL);
+  for (size_t i = 0; i < num_bodies; i++) {
+    list_add(bodies, spring_network_get_body(network, i));
+  }
+  return bodies;
+}
+
+void create_spring_network(scene_t *scene, spring_network_t *network) {
+  scene_add_force_creator_with_freer(
+      scene, (force_creator_t)spring_network_apply, network,
+      network_bodies(network), (free_func_t)spring_network_free);
+}
+
+void create_implicit_spring_network(scene_t *scene,
+                                    spring_network_t *network) {
+  scene_add_force_solver(scene, (force_solver_t)spring_network_solve_implicit,
+                         network, network_bodies(network),
+                         (free_func_t)spring_network_free);
 }
 
 /**
@@ -179,8 +309,27 @@ void create_drag(scene_t *scene, double gamma, body_t *body) {
   list_add(bodies, body);
   list_add(aux_bodies, body);
   body_aux_t *aux = body_aux_init(gamma, aux_bodies);
-  scene_add_bodies_force_creator(scene, (force_creator_t)drag_force, aux,
-                                 bodies);
+  scene_add_force_creator_with_freer(scene, (force_creator_t)drag_force, aux,
+                                     bodies, body_aux_free);
+}
+
+void create_uniform_gravity(scene_t *scene, vector_t acceleration,
+                            body_filter_t filter, void *aux) {
+  force_field_t field = {.acceleration = acceleration};
+  scene_add_force_field(scene, field, filter, aux);
+}
+
+void create_drag_field(scene_t *scene, double linear, double quadratic,
+                       body_filter_t filter, void *aux) {
+  force_field_t field = {.linear_drag = linear, .quadratic_drag = quadratic};
+  scene_add_force_field(scene, field, filter, aux);
+}
+
+void create_wind(scene_t *scene, vector_t velocity, double linear,
+                 double quadratic, body_filter_t filter, void *aux) {
+  force_field_t field = {
+      .flow = velocity, .linear_drag = linear, .quadratic_drag = quadratic};
+  scene_add_force_field(scene, field, filter, aux);
 }
 
 /**
@@ -199,12 +348,16 @@ static void collision_force_creator(void *collision_aux) {
   // Check for collision; if bodies collide, call collision_handler
   bool prev_collision = col_aux->collided;
 
-  collision_info_t info = find_collision(body1, body2);
+  collision_info_t info =
+      find_collision_with(scene_get_narrow_phase(col_aux->scene), body1, body2,
+                          &col_aux->cache);
   // avoids registering impulse multiple times while bodies are still colliding
   if (info.collided && !prev_collision) {
     collision_handler_t handler = col_aux->handler;
 
-    handler(body1, body2, info.axis, col_aux->aux, col_aux->force_const);
+    if (handler != NULL) {
+      handler(body1, body2, info.axis, col_aux->aux, col_aux->force_const);
+    }
     if (col_aux->force_const == BOUNCY_CIRCLE_ELASTICITY) {
       sdl_play_sound(BOUNCY_AUDIO_PATH);
     }
@@ -215,24 +368,155 @@ static void collision_force_creator(void *collision_aux) {
   } else if (!info.collided && prev_collision) {
     col_aux->collided = false;
   }
+  // the scene solves the contact every tick the bodies overlap, starting from
+  // the impulses it needed last tick; sensors never push
+  if (!col_aux->resolves_contact || body_is_sensor(body1) ||
+      body_is_sensor(body2)) {
+    return;
+  }
+  if (info.collided) {
+    scene_add_contact(col_aux->scene, body1, body2,
+                      find_contact_manifold(body1, body2, info),
+                      col_aux->force_const, col_aux->cache.impulses);
+  } else {
+    col_aux->cache.impulses[0] = 0;
+    col_aux->cache.impulses[1] = 0;
+  }
 }
 
-void create_collision(scene_t *scene, body_t *body1, body_t *body2,
-                      collision_handler_t handler, void *aux,
-                      double force_const) {
+/**
+ * Allocates the state of a collision force creator. If it resolves contacts,
+ * the scene's contact solver keeps its bodies apart, with force_const as the
+ * elasticity, and the handler (which may be NULL) only needs to react to the
+ * collision.
+ */
+static collision_aux_t *make_collision_aux(scene_t *scene, body_t *body1,
+                                           body_t *body2,
+                                           collision_handler_t handler,
+                                           void *aux, double force_const,
+                                           bool resolves_contact) {
+  list_t *aux_bodies = list_init(2, NULL);
+  list_add(aux_bodies, body1);
+  list_add(aux_bodies, body2);
+
+  collision_aux_t *collision_aux =
+      collision_aux_init(scene, force_const, aux_bodies, handler, false, aux);
+  collision_aux->resolves_contact = resolves_contact;
+  return collision_aux;
+}
+
+/**
+ * Registers a collision force creator, see make_collision_aux().
+ */
+static void add_collision(scene_t *scene, body_t *body1, body_t *body2,
+                          collision_handler_t handler, void *aux,
+                          double force_const, bool resolves_contact) {
   list_t *bodies = list_init(2, NULL);
   list_add(bodies, body1);
   list_add(bodies, body2);
 
+  scene_add_collision_force_creator(
+      scene, collision_force_creator,
+      make_collision_aux(scene, body1, body2, handler, aux, force_const,
+                         resolves_contact),
+      bodies, collision_aux_free);
+}
+
+force_entry_t *collision_entry_init(scene_t *scene, body_t *body1,
+                                    body_t *body2, collision_handler_t handler,
+                                    void *aux, double force_const,
+                                    bool resolves_contact) {
+  list_t *bodies = list_init(2, NULL);
+  list_add(bodies, body1);
+  list_add(bodies, body2);
+
+  force_entry_t *entry = force_entry_init(
+      collision_force_creator,
+      make_collision_aux(scene, body1, body2, handler, aux, force_const,
+                         resolves_contact),
+      bodies);
+  entry->aux_freer = collision_aux_free;
+  entry->is_collision = true;
+  return entry;
+}
+
+typedef struct sensor_aux {
+  list_t *bodies;
+  sensor_handler_t handler;
+  void *aux;
+  scene_t *scene; // consulted for the narrow phase to use
+  collision_cache_t cache;
+  bool overlapping;
+} sensor_aux_t;
+
+/**
+ * Frees a sensor entry's state, but not the handler's aux.
+ */
+static void sensor_aux_free(void *aux) {
+  list_free(((sensor_aux_t *)aux)->bodies);
+  free(aux);
+}
+
+/**
+ * The force creator for a body and a sensor. Reports when the body starts or
+ * stops overlapping the sensor.
+ *
+ * @param info auxiliary information about the sensor and the body
+ */
+static void sensor_force_creator(void *info) {
+  sensor_aux_t *sensor_aux = info;
+  body_t *sensor = list_get(sensor_aux->bodies, 0);
+  body_t *body = list_get(sensor_aux->bodies, 1);
+  bool overlapping =
+      find_collision_with(scene_get_narrow_phase(sensor_aux->scene), sensor,
+                          body, &sensor_aux->cache)
+          .collided;
+  if (overlapping == sensor_aux->overlapping) {
+    return;
+  }
+  sensor_aux->overlapping = overlapping;
+  if (sensor_aux->handler != NULL) {
+    sensor_aux->handler(sensor, body, overlapping ? SENSOR_ENTER : SENSOR_EXIT,
+                        sensor_aux->aux);
+  }
+}
+
+force_entry_t *sensor_entry_init(scene_t *scene, body_t *sensor, body_t *body,
+                                 sensor_handler_t handler, void *aux) {
+  list_t *bodies = list_init(2, NULL);
+  list_add(bodies, sensor);
+  list_add(bodies, body);
   list_t *aux_bodies = list_init(2, NULL);
-  list_add(aux_bodies, body1);
-  list_add(aux_bodies, body2);
+  list_add(aux_bodies, sensor);
+  list_add(aux_bodies, body);
 
-  collision_aux_t *collision_aux =
-      collision_aux_init(force_const, aux_bodies, handler, false, aux);
+  sensor_aux_t *sensor_aux = malloc(sizeof(sensor_aux_t));
+  assert(sensor_aux);
+  sensor_aux->bodies = aux_bodies;
+  sensor_aux->handler = handler;
+  sensor_aux->aux = aux;
+  sensor_aux->scene = scene;
+  sensor_aux->cache = (collision_cache_t){0};
+  sensor_aux->overlapping = false;
+
+  force_entry_t *entry = force_entry_init(sensor_force_creator, sensor_aux,
+                                          bodies);
+  entry->aux_freer = sensor_aux_free;
+  entry->is_collision = true;
+  return entry;
+}
 
-  scene_add_bodies_force_creator(scene, collision_force_creator, collision_aux,
-                                 bodies);
+void create_collision(scene_t *scene, body_t *body1, body_t *body2,
+                      collision_handler_t handler, void *aux,
+                      double force_const) {
+  add_collision(scene, body1, body2, handler, aux, force_const, false);
+}
+
+void create_collision_rule(scene_t *scene, uint32_t category1,
+                           uint32_t category2, collision_handler_t handler,
+                           void *aux, double force_const) {
+  scene_add_collision_rule(scene, category1, category2, handler, aux,
+                           force_const, false);
 }
 
 static void ramp_force_creator(void *collision_aux) {
@@ -241,7 +525,9 @@ static void ramp_force_creator(void *collision_aux) {
   list_t *bodies = col_aux->bodies;
   body_t *body1 = list_get(bodies, 0);
   body_t *body2 = list_get(bodies, 1);
-  collision_info_t info = find_collision(body1, body2);
+  collision_info_t info =
+      find_collision_with(scene_get_narrow_phase(col_aux->scene), body1, body2,
+                          &col_aux->cache);
   bool prev_collision = col_aux->collided;
 
   if (info.collided && !prev_collision) {
@@ -268,10 +554,10 @@ void create_ramp(scene_t *scene, body_t *body1, body_t *body2,
   list_add(aux_bodies, body2);
 
   collision_aux_t *collision_aux =
-      collision_aux_init(force_const, aux_bodies, handler, false, aux);
+      collision_aux_init(scene, force_const, aux_bodies, handler, false, aux);
 
-  scene_add_bodies_force_creator(scene, ramp_force_creator, collision_aux,
-                                 bodies);
+  scene_add_collision_force_creator(scene, ramp_force_creator, collision_aux,
+                                    bodies, collision_aux_free);
 }
 
 /**
@@ -345,17 +631,30 @@ void create_ramp_collision(scene_t *scene, body_t *body1, body_t *body2,
 
 void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
                               double elasticity) {
-  create_collision(scene, body1, body2, physics_collision_handler, NULL,
-                   elasticity);
+  add_collision(scene, body1, body2, NULL, NULL, elasticity, true);
+}
+
+void create_physics_rule(scene_t *scene, uint32_t category1,
+                         uint32_t category2, double elasticity) {
+  scene_add_collision_rule(scene, category1, category2, NULL, NULL, elasticity,
+                           true);
 }
 
 void breakout_collision_handler(body_t *body1, body_t *body2, vector_t axis,
                                 void *aux, double force_const) {
   physics_collision_handler(body1, body2, axis, aux, force_const);
-  body_remove(body2);               
+  body_remove(body2);
+}
+
+/**
+ * Removes the brick once the contact solver has bounced the ball off it.
+ */
+static void remove_brick(body_t *ball, body_t *brick, vector_t axis, void *aux,
+                         double force_const) {
+  body_remove(brick);
 }
 
 void create_breakout_collision(scene_t *scene, body_t *body1, body_t *body2,
                                double elasticity) {                         
-  create_collision(scene, body1, body2, breakout_collision_handler, scene, elasticity);
+  add_collision(scene, body1, body2, remove_brick, scene, elasticity, true);
 }
\ No newline at end of file
@@ -71,3 +71,10 @@ void *list_remove(list_t *list, size_t index) {
   list->size--;
   return ans;
 }
+
+void *list_swap_remove(list_t *list, size_t index) {
+  assert(index < list_size(list));
+  void *ans = list->data[index];
+  list->data[index] = list->data[--list->size];
+  return ans;
+}
@@ -0,0 +1,171 @@
+#include "pair_table.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t MIN_PAIR_TABLE_CAPACITY = 16;
+
+typedef enum { SLOT_EMPTY, SLOT_FULL, SLOT_DELETED } slot_state_t;
+
+typedef struct slot {
+  void *a;
+  void *b;
+  void *value;
+  slot_state_t state;
+} slot_t;
+
+struct pair_table {
+  slot_t *slots;
+  size_t capacity; // always a power of 2
+  size_t size;
+  size_t deleted;
+};
+
+/**
+ * Orders the pointers of a key so (a, b) and (b, a) are stored identically.
+ */
+static void order_key(void **a, void **b) {
+  if ((uintptr_t)*a > (uintptr_t)*b) {
+    void *temp = *a;
+    *a = *b;
+    *b = temp;
+  }
+}
+
+/**
+ * Hashes an ordered key. Pointers are aligned, so their low bits carry no
+ * information; multiplying by odd constants spreads the high bits back down.
+ */
+static size_t hash_key(void *a, void *b) {
+  uint64_t h = (uint64_t)(uintptr_t)a * 0x9E3779B97F4A7C15ULL;
+  h ^= (uint64_t)(uintptr_t)b * 0xC2B2AE3D27D4EB4FULL;
+  h ^= h >> 29;
+  return (size_t)h;
+}
+
+static slot_t *slots_init(size_t capacity) {
+  slot_t *slots = calloc(capacity, sizeof(slot_t));
+  assert(slots);
+  return slots;
+}
+
+pair_table_t *pair_table_init(size_t initial_capacity) {
+  pair_table_t *table = malloc(sizeof(pair_table_t));
+  assert(table);
+
+  size_t capacity = MIN_PAIR_TABLE_CAPACITY;
+  while (capacity < 2 * initial_capacity) {
+    capacity *= 2;
+  }
+  table->slots = slots_init(capacity);
+  table->capacity = capacity;
+  table->size = 0;
+  table->deleted = 0;
+  return table;
+}
+
+void pair_table_free(pair_table_t *table) {
+  free(table->slots);
+  free(table);
+}
+
+size_t pair_table_size(pair_table_t *table) { return table->size; }
+
+/**
+ * Moves every entry into a freshly allocated slot array, dropping tombstones.
+ */
+static void rehash(pair_table_t *table, size_t new_capacity) {
+  slot_t *old_slots = table->slots;
+  size_t old_capacity = table->capacity;
+
+  table->slots = slots_init(new_capacity);
+  table->capacity = new_capacity;
+  table->deleted = 0;
+
+  for (size_t i = 0; i < old_capacity; i++) {
+    slot_t *old = &old_slots[i];
+    if (old->state != SLOT_FULL) {
+      continue;
+    }
+    size_t j = hash_key(old->a, old->b) & (new_capacity - 1);
+    while (table->slots[j].state == SLOT_FULL) {
+      j = (j + 1) & (new_capacity - 1);
+    }
+    table->slots[j] = *old;
+  }
+  free(old_slots);
+}
+
+void pair_table_add(pair_table_t *table, void *a, void *b, void *value) {
+  // keep at most half of the slots in use so probe sequences stay short
+  if (2 * (table->size + table->deleted + 1) > table->capacity) {
+    size_t new_capacity = table->capacity;
+    if (2 * (table->size + 1) > table->capacity / 2) {
+      new_capacity *= 2;
+    }
+    rehash(table, new_capacity);
+  }
+
+  order_key(&a, &b);
+  size_t i = hash_key(a, b) & (table->capacity - 1);
+  while (table->slots[i].state == SLOT_FULL) {
+    i = (i + 1) & (table->capacity - 1);
+  }
+  if (table->slots[i].state == SLOT_DELETED) {
+    table->deleted--;
+  }
+  table->slots[i] = (slot_t){.a = a, .b = b, .value = value, .state = SLOT_FULL};
+  table->size++;
+}
+
+bool pair_table_remove(pair_table_t *table, void *a, void *b, void *value) {
+  order_key(&a, &b);
+  size_t i = hash_key(a, b) & (table->capacity - 1);
+  while (table->slots[i].state != SLOT_EMPTY) {
+    slot_t *slot = &table->slots[i];
+    if (slot->state == SLOT_FULL && slot->a == a && slot->b == b &&
+        slot->value == value) {
+      slot->state = SLOT_DELETED;
+      table->size--;
+      table->deleted++;
+      return true;
+    }
+    i = (i + 1) & (table->capacity - 1);
+  }
+  return false;
+}
+
+bool pair_table_contains(pair_table_t *table, void *a, void *b) {
+  order_key(&a, &b);
+  size_t i = hash_key(a, b) & (table->capacity - 1);
+  while (table->slots[i].state != SLOT_EMPTY) {
+    slot_t *slot = &table->slots[i];
+    if (slot->state == SLOT_FULL && slot->a == a && slot->b == b) {
+      return true;
+    }
+    i = (i + 1) & (table->capacity - 1);
+  }
+  return false;
+}
+
+void pair_table_find(pair_table_t *table, void *a, void *b,
+                     pair_visitor_t visit, void *aux) {
+  order_key(&a, &b);
+  size_t i = hash_key(a, b) & (table->capacity - 1);
+  while (table->slots[i].state != SLOT_EMPTY) {
+    slot_t *slot = &table->slots[i];
+    if (slot->state == SLOT_FULL && slot->a == a && slot->b == b) {
+      visit(slot->a, slot->b, slot->value, aux);
+    }
+    i = (i + 1) & (table->capacity - 1);
+  }
+}
+
+void pair_table_foreach(pair_table_t *table, pair_visitor_t visit, void *aux) {
+  for (size_t i = 0; i < table->capacity; i++) {
+    slot_t *slot = &table->slots[i];
+    if (slot->state == SLOT_FULL) {
+      visit(slot->a, slot->b, slot->value, aux);
+    }
+  }
+}
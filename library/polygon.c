@@ -4,29 +4,176 @@
 #include <stdlib.h>
 
 typedef struct polygon {
+  shape_kind_t kind;
+  // empty unless kind is SHAPE_POLYGON
   list_t *points;
+  // only used if kind is SHAPE_CIRCLE
+  double radius;
+  // only used if kind is SHAPE_BOX, along the box's own axes
+  vector_t half_extents;
   vector_t center;
   double rotation;
   vector_t velocity;
   rgb_color_t *color;
   double total_rot;
+  // bounding box of the points, recomputed lazily after a rotation
+  aabb_t box;
+  bool box_valid;
+  // unit outward edge normals with no rotation applied, or a box's two axes
+  vector_t *local_normals;
+  // local_normals rotated by normals_rot, updated lazily when total_rot changes
+  vector_t *normals;
+  double normals_rot;
 } polygon_t;
 
+/**
+ * Computes the unit outward normal of every edge of a counterclockwise
+ * polygon. Normal i belongs to the edge from vertex i to vertex i + 1.
+ */
+static void compute_normals(list_t *points, vector_t *normals) {
+  size_t num_points = list_size(points);
+  for (size_t i = 0; i < num_points; i++) {
+    vector_t *v1 = list_get(points, i);
+    vector_t *v2 = list_get(points, (i + 1) % num_points);
+    // the edge from v1 to v2 rotated by -pi/2
+    vector_t normal = {.x = v2->y - v1->y, .y = v1->x - v2->x};
+    normals[i] = vec_multiply(1.0 / vec_get_length(normal), normal);
+  }
+}
+
+/**
+ * Returns how many normals a polygon stores: one per edge, two for a box
+ * (whose opposite edges share an axis) and none for a circle.
+ */
+static size_t num_normals(polygon_t *polygon) {
+  switch (polygon->kind) {
+  case SHAPE_BOX:
+    return 2;
+  case SHAPE_CIRCLE:
+    return 0;
+  case SHAPE_POLYGON:
+  default:
+    return list_size(polygon->points);
+  }
+}
+
 polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
                         double rotation_speed, double red, double green,
                         double blue) {
   polygon_t *polygon = malloc(sizeof(polygon_t));
   assert(polygon);
+  polygon->kind = SHAPE_POLYGON;
   polygon->points = points;
+  polygon->radius = 0;
+  polygon->half_extents = VEC_ZERO;
   polygon->rotation = rotation_speed;
   polygon->velocity = initial_velocity;
   polygon->color = color_init(red, green, blue);
   polygon->center = polygon_centroid(polygon);
   polygon->total_rot = 0;
+  polygon->box = (aabb_t){.min = VEC_ZERO, .max = VEC_ZERO};
+  polygon->box_valid = false;
+
+  size_t num_points = list_size(points);
+  polygon->local_normals = malloc(sizeof(vector_t) * num_points);
+  assert(polygon->local_normals);
+  polygon->normals = malloc(sizeof(vector_t) * num_points);
+  assert(polygon->normals);
+  compute_normals(points, polygon->local_normals);
+  for (size_t i = 0; i < num_points; i++) {
+    polygon->normals[i] = polygon->local_normals[i];
+  }
+  polygon->normals_rot = 0;
+
+  return polygon;
+}
+
+polygon_t *polygon_init_circle(vector_t center, double radius,
+                               vector_t initial_velocity,
+                               double rotation_speed, double red, double green,
+                               double blue) {
+  assert(radius > 0);
+  polygon_t *polygon = malloc(sizeof(polygon_t));
+  assert(polygon);
+  polygon->kind = SHAPE_CIRCLE;
+  polygon->points = list_init(0, free);
+  polygon->radius = radius;
+  polygon->half_extents = VEC_ZERO;
+  polygon->rotation = rotation_speed;
+  polygon->velocity = initial_velocity;
+  polygon->color = color_init(red, green, blue);
+  polygon->center = center;
+  polygon->total_rot = 0;
+  polygon->box = (aabb_t){.min = VEC_ZERO, .max = VEC_ZERO};
+  polygon->box_valid = false;
+  polygon->local_normals = NULL;
+  polygon->normals = NULL;
+  polygon->normals_rot = 0;
+
+  return polygon;
+}
+
+polygon_t *polygon_init_box(vector_t center, double width, double height,
+                            vector_t initial_velocity, double rotation_speed,
+                            double red, double green, double blue) {
+  assert(width > 0 && height > 0);
+  polygon_t *polygon = malloc(sizeof(polygon_t));
+  assert(polygon);
+  polygon->kind = SHAPE_BOX;
+  polygon->points = list_init(0, free);
+  polygon->radius = 0;
+  polygon->half_extents = (vector_t){.x = width / 2, .y = height / 2};
+  polygon->rotation = rotation_speed;
+  polygon->velocity = initial_velocity;
+  polygon->color = color_init(red, green, blue);
+  polygon->center = center;
+  polygon->total_rot = 0;
+  polygon->box = (aabb_t){.min = VEC_ZERO, .max = VEC_ZERO};
+  polygon->box_valid = false;
+
+  polygon->local_normals = malloc(sizeof(vector_t) * 2);
+  assert(polygon->local_normals);
+  polygon->normals = malloc(sizeof(vector_t) * 2);
+  assert(polygon->normals);
+  polygon->local_normals[0] = (vector_t){.x = 1, .y = 0};
+  polygon->local_normals[1] = (vector_t){.x = 0, .y = 1};
+  polygon->normals[0] = polygon->local_normals[0];
+  polygon->normals[1] = polygon->local_normals[1];
+  polygon->normals_rot = 0;
 
   return polygon;
 }
 
+shape_kind_t polygon_get_kind(polygon_t *polygon) { return polygon->kind; }
+
+double polygon_get_radius(polygon_t *polygon) { return polygon->radius; }
+
+vector_t polygon_get_half_extents(polygon_t *polygon) {
+  return polygon->half_extents;
+}
+
+size_t polygon_num_vertices(polygon_t *polygon) {
+  if (polygon->kind == SHAPE_BOX) {
+    return 4;
+  }
+  return list_size(polygon->points);
+}
+
+vector_t polygon_get_vertex(polygon_t *polygon, size_t index) {
+  if (polygon->kind != SHAPE_BOX) {
+    return *(vector_t *)list_get(polygon->points, index);
+  }
+
+  assert(index < 4);
+  const vector_t *axes = polygon_get_normals(polygon);
+  // counterclockwise from the corner at (-x, -y) along the box's axes
+  double x = (index == 1 || index == 2) ? polygon->half_extents.x
+                                        : -polygon->half_extents.x;
+  double y = index >= 2 ? polygon->half_extents.y : -polygon->half_extents.y;
+  return vec_add(polygon->center, vec_add(vec_multiply(x, axes[0]),
+                                          vec_multiply(y, axes[1])));
+}
+
 list_t *polygon_get_points(polygon_t *polygon) { return polygon->points; }
 
 void polygon_move(polygon_t *polygon, double time_elapsed) {
@@ -41,6 +188,8 @@ void polygon_set_velocity(polygon_t *polygon, vector_t vel) {
 void polygon_free(polygon_t *polygon) {
   list_free(polygon->points);
   color_free(polygon->color);
+  free(polygon->local_normals);
+  free(polygon->normals);
   free(polygon);
 }
 
@@ -49,6 +198,13 @@ vector_t *polygon_get_velocity(polygon_t *polygon) {
 }
 
 double polygon_area(polygon_t *polygon) {
+  if (polygon->kind == SHAPE_CIRCLE) {
+    return M_PI * polygon->radius * polygon->radius;
+  }
+  if (polygon->kind == SHAPE_BOX) {
+    return 4 * polygon->half_extents.x * polygon->half_extents.y;
+  }
+
   double area = 0;
   list_t *points = polygon->points;
 
@@ -63,6 +219,10 @@ double polygon_area(polygon_t *polygon) {
 }
 
 vector_t polygon_centroid(polygon_t *polygon) {
+  if (polygon->kind != SHAPE_POLYGON) {
+    return polygon->center;
+  }
+
   double sum_cx = 0;
   double sum_cy = 0;
   list_t *points = polygon_get_points(polygon);
@@ -83,6 +243,47 @@ vector_t polygon_centroid(polygon_t *polygon) {
   return centroid;
 }
 
+aabb_t polygon_get_aabb(polygon_t *polygon) {
+  if (polygon->box_valid) {
+    return polygon->box;
+  }
+  if (polygon->kind == SHAPE_CIRCLE) {
+    vector_t extent = {.x = polygon->radius, .y = polygon->radius};
+    polygon->box = (aabb_t){.min = vec_subtract(polygon->center, extent),
+                            .max = vec_add(polygon->center, extent)};
+    polygon->box_valid = true;
+    return polygon->box;
+  }
+  if (polygon->kind == SHAPE_BOX) {
+    // each half-extent contributes its axis's reach along x and y
+    const vector_t *axes = polygon_get_normals(polygon);
+    vector_t h = polygon->half_extents;
+    vector_t extent = {
+        .x = h.x * fabs(axes[0].x) + h.y * fabs(axes[1].x),
+        .y = h.x * fabs(axes[0].y) + h.y * fabs(axes[1].y)};
+    polygon->box = (aabb_t){.min = vec_subtract(polygon->center, extent),
+                            .max = vec_add(polygon->center, extent)};
+    polygon->box_valid = true;
+    return polygon->box;
+  }
+
+  list_t *points = polygon->points;
+  aabb_t box = {.min = {__DBL_MAX__, __DBL_MAX__},
+                .max = {-__DBL_MAX__, -__DBL_MAX__}};
+
+  for (size_t i = 0; i < list_size(points); i++) {
+    vector_t *v = list_get(points, i);
+    box.min.x = fmin(box.min.x, v->x);
+    box.min.y = fmin(box.min.y, v->y);
+    box.max.x = fmax(box.max.x, v->x);
+    box.max.y = fmax(box.max.y, v->y);
+  }
+
+  polygon->box = box;
+  polygon->box_valid = true;
+  return box;
+}
+
 void polygon_translate(polygon_t *polygon, vector_t translation) {
   list_t *points = polygon_get_points(polygon);
 
@@ -93,6 +294,8 @@ void polygon_translate(polygon_t *polygon, vector_t translation) {
   }
 
   polygon->center = vec_add(polygon->center, translation);
+  polygon->box.min = vec_add(polygon->box.min, translation);
+  polygon->box.max = vec_add(polygon->box.max, translation);
 }
 
 void polygon_rotate(polygon_t *polygon, double angle, vector_t point) {
@@ -106,13 +309,23 @@ void polygon_rotate(polygon_t *polygon, double angle, vector_t point) {
     v->x = rotated_vertex.x + point.x;
     v->y = rotated_vertex.y + point.y;
   }
+  if (angle != 0) {
+    polygon->box_valid = false;
+  }
 
   polygon->total_rot += angle;
   while (polygon->total_rot >= 2 * M_PI) {
     polygon->total_rot -= 2 * (M_PI);
   }
 
-  polygon->center = polygon_centroid(polygon);
+  if (polygon->kind != SHAPE_POLYGON) {
+    // circles and boxes have no vertices to rotate, but their centers may
+    // still move
+    polygon->center =
+        vec_add(point, vec_rotate(vec_subtract(polygon->center, point), angle));
+  } else {
+    polygon->center = polygon_centroid(polygon);
+  }
 }
 
 rgb_color_t *polygon_get_color(polygon_t *polygon) { return polygon->color; }
@@ -134,3 +347,18 @@ void polygon_set_rotation(polygon_t *polygon, double rot) {
 }
 
 double polygon_get_rotation(polygon_t *polygon) { return polygon->total_rot; }
+
+const vector_t *polygon_get_normals(polygon_t *polygon) {
+  if (polygon->normals_rot != polygon->total_rot) {
+    // one sin and cos for every normal, rather than one per normal
+    double cos_rot = cos(polygon->total_rot);
+    double sin_rot = sin(polygon->total_rot);
+    for (size_t i = 0; i < num_normals(polygon); i++) {
+      vector_t local = polygon->local_normals[i];
+      polygon->normals[i] = (vector_t){local.x * cos_rot - local.y * sin_rot,
+                                       local.x * sin_rot + local.y * cos_rot};
+    }
+    polygon->normals_rot = polygon->total_rot;
+  }
+  return polygon->normals;
+}
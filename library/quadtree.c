@@ -0,0 +1,273 @@
+#include "quadtree.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t GUESS_NUM_QUADTREE_NODES = 16;
+const size_t QUADTREE_NULL_NODE = SIZE_MAX;
+// points closer together than the root's width over 2^QUADTREE_MAX_DEPTH
+// share a leaf, so coincident points do not split forever
+const size_t QUADTREE_MAX_DEPTH = 32;
+
+typedef struct quadtree_node {
+  // the square covered by the node
+  vector_t center;
+  double half_width;
+  double mass;
+  vector_t center_of_mass;
+  // the first of the node's four consecutive children, or QUADTREE_NULL_NODE
+  // for a leaf
+  size_t children;
+  // the node's points are order[start] up to order[end]
+  size_t start;
+  size_t end;
+} quadtree_node_t;
+
+struct quadtree {
+  double theta;
+  vector_t *positions;
+  double *masses;
+  // indices of the points, grouped so each node's points are contiguous
+  size_t *order;
+  size_t num_points;
+  size_t point_capacity;
+  quadtree_node_t *nodes;
+  size_t num_nodes;
+  size_t node_capacity;
+  // stack of nodes left to visit, reused across queries
+  size_t *stack;
+  size_t stack_capacity;
+};
+
+quadtree_t *quadtree_init(double theta) {
+  assert(theta >= 0);
+  quadtree_t *tree = malloc(sizeof(quadtree_t));
+  assert(tree);
+  tree->theta = theta;
+  tree->positions = NULL;
+  tree->masses = NULL;
+  tree->order = NULL;
+  tree->num_points = 0;
+  tree->point_capacity = 0;
+  tree->node_capacity = GUESS_NUM_QUADTREE_NODES;
+  tree->nodes = malloc(sizeof(quadtree_node_t) * tree->node_capacity);
+  assert(tree->nodes);
+  tree->num_nodes = 0;
+  tree->stack_capacity = GUESS_NUM_QUADTREE_NODES;
+  tree->stack = malloc(sizeof(size_t) * tree->stack_capacity);
+  assert(tree->stack);
+  return tree;
+}
+
+void quadtree_free(quadtree_t *tree) {
+  free(tree->positions);
+  free(tree->masses);
+  free(tree->order);
+  free(tree->nodes);
+  free(tree->stack);
+  free(tree);
+}
+
+size_t quadtree_size(quadtree_t *tree) { return tree->num_points; }
+
+/**
+ * Appends four uninitialized nodes, growing the array if needed.
+ * Returns the index of the first.
+ */
+static size_t allocate_children(quadtree_t *tree) {
+  if (tree->num_nodes + 4 > tree->node_capacity) {
+    tree->node_capacity = 2 * tree->node_capacity + 4;
+    tree->nodes =
+        realloc(tree->nodes, sizeof(quadtree_node_t) * tree->node_capacity);
+    assert(tree->nodes);
+  }
+  size_t first = tree->num_nodes;
+  tree->num_nodes += 4;
+  return first;
+}
+
+/**
+ * Moves the points in order[start] up to order[end] for which below()
+ * holds in front of the others. Returns the index of the first other point.
+ */
+static size_t partition(quadtree_t *tree, size_t start, size_t end,
+                        bool (*below)(vector_t, vector_t), vector_t center) {
+  size_t split = start;
+  for (size_t i = start; i < end; i++) {
+    size_t point = tree->order[i];
+    if (below(tree->positions[point], center)) {
+      tree->order[i] = tree->order[split];
+      tree->order[split++] = point;
+    }
+  }
+  return split;
+}
+
+static bool left_of(vector_t point, vector_t center) {
+  return point.x < center.x;
+}
+
+static bool under(vector_t point, vector_t center) {
+  return point.y < center.y;
+}
+
+/**
+ * Splits a node's points among its quadrants, recursively, and sums up the
+ * node's mass and center of mass.
+ */
+static void build_node(quadtree_t *tree, size_t index, size_t depth) {
+  quadtree_node_t node = tree->nodes[index];
+  node.children = QUADTREE_NULL_NODE;
+  if (node.end - node.start > 1 && depth < QUADTREE_MAX_DEPTH) {
+    node.children = allocate_children(tree);
+    size_t mid = partition(tree, node.start, node.end, left_of, node.center);
+    size_t bounds[5] = {
+        node.start, partition(tree, node.start, mid, under, node.center), mid,
+        partition(tree, mid, node.end, under, node.center), node.end};
+    double quarter = node.half_width / 2;
+    for (size_t i = 0; i < 4; i++) {
+      quadtree_node_t *child = &tree->nodes[node.children + i];
+      child->center = (vector_t){node.center.x + (i < 2 ? -quarter : quarter),
+                                 node.center.y + (i % 2 ? quarter : -quarter)};
+      child->half_width = quarter;
+      child->start = bounds[i];
+      child->end = bounds[i + 1];
+      build_node(tree, node.children + i, depth + 1);
+    }
+  }
+
+  node.mass = 0;
+  vector_t moment = VEC_ZERO;
+  for (size_t i = node.start; i < node.end; i++) {
+    size_t point = tree->order[i];
+    node.mass += tree->masses[point];
+    moment = vec_add(moment,
+                     vec_multiply(tree->masses[point], tree->positions[point]));
+  }
+  node.center_of_mass =
+      node.mass > 0 ? vec_multiply(1 / node.mass, moment) : node.center;
+  tree->nodes[index] = node;
+}
+
+void quadtree_build(quadtree_t *tree, const vector_t *positions,
+                    const double *masses, size_t num_points) {
+  if (num_points > tree->point_capacity) {
+    tree->point_capacity = num_points;
+    tree->positions =
+        realloc(tree->positions, sizeof(vector_t) * tree->point_capacity);
+    tree->masses = realloc(tree->masses, sizeof(double) * tree->point_capacity);
+    tree->order = realloc(tree->order, sizeof(size_t) * tree->point_capacity);
+    assert(tree->positions && tree->masses && tree->order);
+  }
+  tree->num_points = num_points;
+  tree->num_nodes = 0;
+  if (num_points == 0) {
+    return;
+  }
+
+  vector_t min = positions[0], max = positions[0];
+  for (size_t i = 0; i < num_points; i++) {
+    assert(masses[i] >= 0);
+    tree->positions[i] = positions[i];
+    tree->masses[i] = masses[i];
+    tree->order[i] = i;
+    min = (vector_t){fmin(min.x, positions[i].x), fmin(min.y, positions[i].y)};
+    max = (vector_t){fmax(max.x, positions[i].x), fmax(max.y, positions[i].y)};
+  }
+
+  // the root is the smallest square around every point, grown a little so
+  // the points on its far edges still fall strictly inside
+  tree->num_nodes = 1;
+  quadtree_node_t *root = &tree->nodes[0];
+  root->center = vec_multiply(0.5, vec_add(min, max));
+  double half_width = fmax(max.x - min.x, max.y - min.y) / 2;
+  root->half_width = half_width + fmax(half_width, 1) * 1e-9;
+  root->start = 0;
+  root->end = num_points;
+  build_node(tree, 0, 0);
+}
+
+/**
+ * Pushes a node onto the query stack, growing it if needed.
+ */
+static void push_node(quadtree_t *tree, size_t *size, size_t index) {
+  if (*size == tree->stack_capacity) {
+    tree->stack_capacity *= 2;
+    tree->stack = realloc(tree->stack, sizeof(size_t) * tree->stack_capacity);
+    assert(tree->stack);
+  }
+  tree->stack[(*size)++] = index;
+}
+
+/**
+ * The field at position of a point mass, or zero if it is within
+ * min_distance.
+ */
+static vector_t point_field(vector_t position, vector_t point, double mass,
+                            double min_distance) {
+  vector_t displacement = vec_subtract(point, position);
+  double distance = vec_get_length(displacement);
+  if (distance <= min_distance || mass == 0) {
+    return VEC_ZERO;
+  }
+  return vec_multiply(mass / (distance * distance * distance), displacement);
+}
+
+static bool node_contains(quadtree_node_t *node, vector_t point) {
+  return fabs(point.x - node->center.x) <= node->half_width &&
+         fabs(point.y - node->center.y) <= node->half_width;
+}
+
+/**
+ * Whether a node looks small enough from position to be treated as a
+ * single point mass. A node around position or the skipped point is always
+ * opened, so a point never feels its own mass.
+ */
+static bool is_far(quadtree_t *tree, quadtree_node_t *node, vector_t position,
+                   size_t skip) {
+  if (node_contains(node, position) ||
+      (skip < tree->num_points &&
+       node_contains(node, tree->positions[skip]))) {
+    return false;
+  }
+  vector_t displacement = vec_subtract(node->center_of_mass, position);
+  double width = 2 * node->half_width;
+  return width * width <
+         tree->theta * tree->theta * vec_dot(displacement, displacement);
+}
+
+vector_t quadtree_field(quadtree_t *tree, vector_t position, size_t skip,
+                        double min_distance) {
+  vector_t field = VEC_ZERO;
+  if (tree->num_nodes == 0) {
+    return field;
+  }
+  size_t size = 0;
+  push_node(tree, &size, 0);
+  while (size > 0) {
+    quadtree_node_t *node = &tree->nodes[tree->stack[--size]];
+    if (node->mass == 0) {
+      continue;
+    }
+    if (is_far(tree, node, position, skip)) {
+      field = vec_add(field, point_field(position, node->center_of_mass,
+                                         node->mass, min_distance));
+    } else if (node->children != QUADTREE_NULL_NODE) {
+      for (size_t i = 0; i < 4; i++) {
+        push_node(tree, &size, node->children + i);
+      }
+    } else {
+      for (size_t i = node->start; i < node->end; i++) {
+        size_t point = tree->order[i];
+        if (point != skip) {
+          field = vec_add(field, point_field(position, tree->positions[point],
+                                             tree->masses[point],
+                                             min_distance));
+        }
+      }
+    }
+  }
+  return field;
+}
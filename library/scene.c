@@ -1,20 +1,171 @@
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "body.h"
+#include "body_store.h"
+#include "bvh.h"
 #include "forces.h"
 #include "list.h"
+#include "pair_table.h"
 #include "scene.h"
+#include "slot_map.h"
+#include "spatial_hash.h"
+#include "sweep_and_prune.h"
 
 const size_t GUESS_NUM_BODIES = 5;
 const size_t GUESS_NUM_FORCES = 5;
+const double DEFAULT_CELL_SIZE = 100;
+const double STATIC_TREE_MARGIN = 10;
+const double DEFAULT_CORRECTION_FRACTION = 0.4;
+const double DEFAULT_CORRECTION_SLOP = 0.05;
+const size_t DEFAULT_SOLVER_ITERATIONS = 8;
+// contacts approaching slower than this do not bounce, so resting contacts
+// come to rest
+const double RESTITUTION_THRESHOLD = 1;
+// a body moving further than this fraction of its narrowest extent in one
+// tick could pass through a body as thin as itself
+const double CCD_MOTION_FRACTION = 0.5;
+// the most impacts a continuously collided body stops at in one tick
+const size_t CCD_MAX_IMPACTS = 4;
+// impacts this close together, as fractions of a tick, happen at once
+const double CCD_SIMULTANEOUS_FRACTION = 1e-9;
+const double DEFAULT_MIN_STEP = 1e-6;
+const double DEFAULT_MAX_STEP = 1.0 / 30;
+// scene_step_adaptive() aims a little under the tolerance, so the next tick
+// is rarely rejected, and changes the tick's length by at most these factors
+const double STEP_SAFETY = 0.9;
+const double MAX_STEP_GROWTH = 5;
+const double MAX_STEP_SHRINK = 0.2;
+const double DEFAULT_FIXED_STEP = 1.0 / 60;
+const size_t DEFAULT_MAX_CATCH_UP_STEPS = 5;
+
+/**
+ * A pair of overlapping bodies whose contact is solved at the end of the
+ * tick.
+ */
+typedef struct contact {
+  body_t *body1;
+  body_t *body2;
+  contact_manifold_t manifold;
+  double elasticity;
+  // the accumulated normal impulse at each contact point
+  double impulses[2];
+  // the normal velocity each contact point should separate with
+  double target_speeds[2];
+  // where to save the accumulated impulses for the next tick, or NULL
+  double *saved_impulses;
+} contact_t;
+
+/**
+ * A force field and the bodies it acts on, see scene_add_force_field().
+ */
+typedef struct scene_field {
+  force_field_t field;
+  body_filter_t filter;
+  void *aux;
+} scene_field_t;
+
+/**
+ * Makes pairs of bodies in two collision categories collide, see
+ * scene_add_collision_rule().
+ */
+typedef struct collision_rule {
+  uint32_t category1;
+  uint32_t category2;
+  collision_handler_t handler;
+  void *aux;
+  double force_const;
+  bool resolves_contact;
+} collision_rule_t;
 
 struct scene {
   size_t num_bodies;
   size_t num_forces;
   list_t *bodies;
+  // the bodies' velocities, forces, masses and flags, slot i belonging to
+  // body i
+  body_store_t *store;
   list_t *force_creators;
+  // map the handles returned for bodies and force entries to their indices
+  slot_map_t *body_handles;
+  slot_map_t *force_handles;
+  // the force entries marked by scene_remove_force(), not yet freed
+  list_t *removed_forces;
+  // bodies with infinite mass, which rarely move, are kept in a tree;
+  // the broad phase only handles the others
+  bvh_t *statics;
+  // collision entries registered between two bodies in the tree
+  size_t num_static_collisions;
+  broad_phase_t broad_phase;
+  narrow_phase_t narrow_phase;
+  // with BROAD_PHASE_GRID, bodies are re-bucketed into the grid every tick
+  spatial_hash_t *grid;
+  // with BROAD_PHASE_SWEEP, every body has a proxy in the sweep and prune
+  sweep_and_prune_t *sweep;
+  // maps each pair of bodies to the collision entries registered between them
+  pair_table_t *collision_pairs;
+  // collision entries run during the previous tick
+  list_t *active_collisions;
+  // collision entries found by the broad phase during the current tick
+  list_t *pending_collisions;
+  // the bodies a continuously collided body hits at its next impact, and
+  // those it has hit so far this tick
+  list_t *impact_hits;
+  list_t *impacted;
+  // rules that generate collision entries for pairs of categories
+  collision_rule_t *rules;
+  size_t num_rules;
+  size_t rule_capacity;
+  // the collision entries generated by rules for pairs whose bounding boxes
+  // overlap, which own them
+  pair_table_t *rule_pairs;
+  list_t *rule_entries;
+  // called when bodies start or stop overlapping sensors
+  sensor_handler_t sensor_handler;
+  void *sensor_aux;
+  integrator_t integrator;
+  // with INTEGRATOR_RK4, each body's state at the start of the tick and its
+  // weighted sums of the stages' accelerations
+  vector_t *stage_positions;
+  vector_t *stage_velocities;
+  vector_t *position_accelerations;
+  vector_t *velocity_accelerations;
+  // the forces applied to each body before scene_step_adaptive() runs the
+  // force creators to estimate a tick's error, and the forces and impulses
+  // on it once they have run
+  vector_t *stage_forces;
+  vector_t *start_forces;
+  vector_t *stage_impulses;
+  size_t stage_capacity;
+  // whether the force creators have already been run at the bodies' current
+  // state, so the next tick can use their forces rather than run them again
+  bool forces_current;
+  double min_step;
+  double max_step;
+  // the length of scene_step_adaptive()'s next tick, or 0 before the first
+  double next_step;
+  step_stats_t step_stats;
+  double fixed_step;
+  size_t max_catch_up_steps;
+  // the time scene_advance() has yet to simulate
+  double accumulator;
+  double interpolation_alpha;
+  // force fields applied to every body at the start of each tick
+  scene_field_t *fields;
+  size_t num_fields;
+  size_t field_capacity;
+  // contacts reported during the current tick, reused between ticks
+  contact_t *contacts;
+  size_t num_contacts;
+  size_t contact_capacity;
+  double correction_fraction;
+  double correction_slop;
+  size_t solver_iterations;
+  size_t tick;
+  // whether the tree and grid hold every body where it is now, for queries
+  bool index_current;
 };
 
 scene_t *scene_init(void) {
@@ -23,13 +174,95 @@ scene_t *scene_init(void) {
   scene->num_bodies = 0;
   scene->num_forces = 0;
   scene->bodies = list_init(GUESS_NUM_BODIES, (free_func_t)body_free);
+  scene->store = body_store_init(GUESS_NUM_BODIES);
   scene->force_creators = list_init(GUESS_NUM_FORCES, (free_func_t)force_free);
+  scene->body_handles = slot_map_init(GUESS_NUM_BODIES);
+  scene->force_handles = slot_map_init(GUESS_NUM_FORCES);
+  scene->removed_forces = list_init(GUESS_NUM_FORCES, NULL);
+  scene->statics = bvh_init(STATIC_TREE_MARGIN);
+  scene->num_static_collisions = 0;
+  scene->broad_phase = BROAD_PHASE_GRID;
+  scene->narrow_phase = NARROW_PHASE_SAT;
+  scene->grid = spatial_hash_init(DEFAULT_CELL_SIZE);
+  scene->sweep = NULL;
+  scene->collision_pairs = pair_table_init(GUESS_NUM_FORCES);
+  scene->active_collisions = list_init(GUESS_NUM_FORCES, NULL);
+  scene->pending_collisions = list_init(GUESS_NUM_FORCES, NULL);
+  scene->impact_hits = list_init(CCD_MAX_IMPACTS, NULL);
+  scene->impacted = list_init(CCD_MAX_IMPACTS, NULL);
+  scene->rule_capacity = GUESS_NUM_FORCES;
+  scene->rules = malloc(sizeof(collision_rule_t) * scene->rule_capacity);
+  assert(scene->rules);
+  scene->num_rules = 0;
+  scene->integrator = INTEGRATOR_SIMPSON;
+  scene->stage_positions = NULL;
+  scene->stage_velocities = NULL;
+  scene->position_accelerations = NULL;
+  scene->velocity_accelerations = NULL;
+  scene->stage_forces = NULL;
+  scene->start_forces = NULL;
+  scene->stage_impulses = NULL;
+  scene->forces_current = false;
+  scene->stage_capacity = 0;
+  scene->min_step = DEFAULT_MIN_STEP;
+  scene->max_step = DEFAULT_MAX_STEP;
+  scene->next_step = 0;
+  scene->step_stats = (step_stats_t){.accepted_steps = 0,
+                                     .rejected_steps = 0,
+                                     .shortest_step = INFINITY,
+                                     .longest_step = 0};
+  scene->fixed_step = DEFAULT_FIXED_STEP;
+  scene->max_catch_up_steps = DEFAULT_MAX_CATCH_UP_STEPS;
+  scene->accumulator = 0;
+  scene->interpolation_alpha = 1;
+  scene->fields = NULL;
+  scene->num_fields = 0;
+  scene->field_capacity = 0;
+  scene->rule_pairs = pair_table_init(GUESS_NUM_FORCES);
+  scene->rule_entries = list_init(GUESS_NUM_FORCES, (free_func_t)force_free);
+  scene->sensor_handler = NULL;
+  scene->sensor_aux = NULL;
+  scene->contact_capacity = GUESS_NUM_FORCES;
+  scene->contacts = malloc(sizeof(contact_t) * scene->contact_capacity);
+  assert(scene->contacts);
+  scene->num_contacts = 0;
+  scene->correction_fraction = DEFAULT_CORRECTION_FRACTION;
+  scene->correction_slop = DEFAULT_CORRECTION_SLOP;
+  scene->solver_iterations = DEFAULT_SOLVER_ITERATIONS;
+  scene->tick = 0;
+  scene->index_current = false;
   return scene;
 }
 
 void scene_free(scene_t *scene) {
   list_free(scene->bodies);
+  body_store_free(scene->store);
   list_free(scene->force_creators);
+  slot_map_free(scene->body_handles);
+  slot_map_free(scene->force_handles);
+  list_free(scene->removed_forces);
+  bvh_free(scene->statics);
+  spatial_hash_free(scene->grid);
+  if (scene->sweep != NULL) {
+    sweep_and_prune_free(scene->sweep);
+  }
+  pair_table_free(scene->collision_pairs);
+  list_free(scene->active_collisions);
+  list_free(scene->pending_collisions);
+  list_free(scene->impact_hits);
+  list_free(scene->impacted);
+  free(scene->rules);
+  free(scene->fields);
+  free(scene->stage_positions);
+  free(scene->stage_velocities);
+  free(scene->position_accelerations);
+  free(scene->velocity_accelerations);
+  free(scene->stage_forces);
+  free(scene->start_forces);
+  free(scene->stage_impulses);
+  pair_table_free(scene->rule_pairs);
+  list_free(scene->rule_entries);
+  free(scene->contacts);
   free(scene);
 }
 
@@ -40,9 +273,48 @@ body_t *scene_get_body(scene_t *scene, size_t index) {
   return list_get(scene->bodies, index);
 }
 
-void scene_add_body(scene_t *scene, body_t *body) {
+/**
+ * Returns whether a body is stored in the scene's tree rather than its
+ * broad phase.
+ */
+static bool is_static(body_t *body) { return body_get_mass(body) == INFINITY; }
+
+body_handle_t scene_add_body(scene_t *scene, body_t *body) {
   list_add(scene->bodies, body);
+  body_attach(body, scene->store);
   scene->num_bodies++;
+  scene->index_current = false;
+  body_save_transform(body);
+  if (is_static(body)) {
+    body_set_proxy(body,
+                   bvh_insert(scene->statics, body, body_get_aabb(body)));
+  } else if (scene->sweep != NULL) {
+    body_set_proxy(body,
+                   sweep_and_prune_add(scene->sweep, body, body_get_aabb(body)));
+  }
+  return slot_map_add(scene->body_handles);
+}
+
+body_handle_t scene_get_body_handle(scene_t *scene, size_t index) {
+  assert(index < scene->num_bodies);
+  return slot_map_get_handle(scene->body_handles, index);
+}
+
+body_t *scene_get_body_by_handle(scene_t *scene, body_handle_t handle) {
+  size_t index;
+  if (!slot_map_find(scene->body_handles, handle, &index)) {
+    return NULL;
+  }
+  return list_get(scene->bodies, index);
+}
+
+bool scene_remove_body_by_handle(scene_t *scene, body_handle_t handle) {
+  body_t *body = scene_get_body_by_handle(scene, handle);
+  if (body == NULL) {
+    return false;
+  }
+  body_remove(body);
+  return true;
 }
 
 void scene_remove_body(scene_t *scene, size_t index) {
@@ -55,58 +327,1429 @@ void scene_add_force_creator(scene_t *scene, force_creator_t force_creator,
   scene_add_bodies_force_creator(scene, force_creator, aux, list_init(0, free));
 }
 
-void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
-                                    void *aux, list_t *bodies) {
-  force_entry_t *entry = force_entry_init(forcer, aux, bodies);
+/**
+ * Records that a force entry depends on each of a list of bodies, unless it
+ * was just recorded for the body.
+ */
+static void link_force_entry(force_entry_t *entry, list_t *bodies) {
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    list_t *entries = body_get_force_entries(list_get(bodies, i));
+    size_t size = list_size(entries);
+    if (size == 0 || list_get(entries, size - 1) != entry) {
+      list_add(entries, entry);
+    }
+  }
+}
+
+/**
+ * Removes a force entry from the force entries of each of a list of bodies,
+ * except one that is being freed.
+ */
+static void unlink_force_entry(force_entry_t *entry, list_t *bodies,
+                               body_t *freed) {
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_t *body = list_get(bodies, i);
+    if (body == freed) {
+      continue;
+    }
+    list_t *entries = body_get_force_entries(body);
+    for (size_t j = 0; j < list_size(entries); j++) {
+      if (list_get(entries, j) == entry) {
+        list_swap_remove(entries, j);
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Adds a force entry to the end of a scene's force creators, and to the
+ * force entries of the bodies it depends on.
+ */
+static force_handle_t add_force_entry(scene_t *scene, force_entry_t *entry) {
   list_add(scene->force_creators, entry);
   scene->num_forces++;
+  entry->handle = slot_map_add(scene->force_handles);
+  link_force_entry(entry, entry->bodies);
+  return entry->handle;
+}
+
+force_handle_t scene_add_bodies_force_creator(scene_t *scene,
+                                              force_creator_t forcer, void *aux,
+                                              list_t *bodies) {
+  return add_force_entry(scene, force_entry_init(forcer, aux, bodies));
+}
+
+force_handle_t scene_add_force_creator_with_freer(scene_t *scene,
+                                                  force_creator_t forcer,
+                                                  void *aux, list_t *bodies,
+                                                  free_func_t freer) {
+  force_entry_t *entry = force_entry_init(forcer, aux, bodies);
+  entry->aux_freer = freer;
+  return add_force_entry(scene, entry);
+}
+
+force_handle_t scene_add_force_solver(scene_t *scene, force_solver_t solver,
+                                      void *aux, list_t *bodies,
+                                      free_func_t freer) {
+  force_entry_t *entry = force_entry_init(NULL, aux, bodies);
+  entry->aux_freer = freer;
+  entry->solver = solver;
+  return add_force_entry(scene, entry);
+}
+
+force_handle_t scene_add_field_force_creator(scene_t *scene,
+                                             force_creator_t forcer, void *aux,
+                                             free_func_t freer) {
+  return scene_add_force_creator_with_freer(scene, forcer, aux,
+                                            list_init(0, NULL), freer);
+}
+
+force_handle_t scene_add_collision_force_creator(scene_t *scene,
+                                                 force_creator_t forcer,
+                                                 void *aux, list_t *bodies,
+                                                 free_func_t freer) {
+  assert(list_size(bodies) == 2);
+  force_entry_t *entry = force_entry_init(forcer, aux, bodies);
+  entry->aux_freer = freer;
+  entry->is_collision = true;
+  pair_table_add(scene->collision_pairs, list_get(bodies, 0),
+                 list_get(bodies, 1), entry);
+  if (is_static(list_get(bodies, 0)) && is_static(list_get(bodies, 1))) {
+    scene->num_static_collisions++;
+  }
+  return add_force_entry(scene, entry);
 }
 
 /**
- * Return true if the force needs to be removed, false otherwise
- *
- * @param body the body to be removed
- * @param bodies a list of bodies
- * @return true if bodies contains body, false otherwise
- */
-static bool remove_force(body_t *body_remove, list_t *bodies) {
-  for (size_t k = 0; k < list_size(bodies); k++) {
-    body_t *body = list_get(bodies, k);
-    if (body_remove == body) {
+ * Finds the force entry a handle refers to, or returns NULL if it has been
+ * freed or marked for removal.
+ */
+static force_entry_t *find_force_entry(scene_t *scene, force_handle_t handle) {
+  size_t index;
+  if (!slot_map_find(scene->force_handles, handle, &index)) {
+    return NULL;
+  }
+  force_entry_t *entry = list_get(scene->force_creators, index);
+  return entry->removed ? NULL : entry;
+}
+
+bool scene_remove_force(scene_t *scene, force_handle_t handle) {
+  force_entry_t *entry = find_force_entry(scene, handle);
+  if (entry == NULL) {
+    return false;
+  }
+  entry->removed = true;
+  list_add(scene->removed_forces, entry);
+  return true;
+}
+
+bool scene_has_force(scene_t *scene, force_handle_t handle) {
+  return find_force_entry(scene, handle) != NULL;
+}
+
+void scene_add_collision_rule(scene_t *scene, uint32_t category1,
+                              uint32_t category2, collision_handler_t handler,
+                              void *aux, double force_const,
+                              bool resolves_contact) {
+  if (scene->num_rules == scene->rule_capacity) {
+    scene->rule_capacity *= 2;
+    scene->rules =
+        realloc(scene->rules, sizeof(collision_rule_t) * scene->rule_capacity);
+    assert(scene->rules);
+  }
+  scene->rules[scene->num_rules++] =
+      (collision_rule_t){.category1 = category1,
+                         .category2 = category2,
+                         .handler = handler,
+                         .aux = aux,
+                         .force_const = force_const,
+                         .resolves_contact = resolves_contact};
+}
+
+void scene_add_force_field(scene_t *scene, force_field_t field,
+                           body_filter_t filter, void *aux) {
+  if (scene->num_fields == scene->field_capacity) {
+    scene->field_capacity = 2 * scene->field_capacity + 1;
+    scene->fields = realloc(scene->fields,
+                            sizeof(scene_field_t) * scene->field_capacity);
+    assert(scene->fields);
+  }
+  scene->fields[scene->num_fields++] =
+      (scene_field_t){.field = field, .filter = filter, .aux = aux};
+}
+
+void scene_set_sensor_handler(scene_t *scene, sensor_handler_t handler,
+                              void *aux) {
+  scene->sensor_handler = handler;
+  scene->sensor_aux = aux;
+}
+
+void scene_set_broad_phase(scene_t *scene, broad_phase_t broad_phase) {
+  if (broad_phase == BROAD_PHASE_SWEEP && scene->sweep == NULL) {
+    scene->sweep = sweep_and_prune_init(NULL, NULL, NULL);
+    for (size_t i = 0; i < scene->num_bodies; i++) {
+      body_t *body = list_get(scene->bodies, i);
+      if (!is_static(body)) {
+        body_set_proxy(body, sweep_and_prune_add(scene->sweep, body,
+                                                 body_get_aabb(body)));
+      }
+    }
+  } else if (broad_phase != BROAD_PHASE_SWEEP && scene->sweep != NULL) {
+    sweep_and_prune_free(scene->sweep);
+    scene->sweep = NULL;
+  }
+  scene->broad_phase = broad_phase;
+}
+
+void scene_set_narrow_phase(scene_t *scene, narrow_phase_t narrow_phase) {
+  scene->narrow_phase = narrow_phase;
+}
+
+void scene_set_integrator(scene_t *scene, integrator_t integrator) {
+  scene->integrator = integrator;
+}
+
+integrator_t scene_get_integrator(scene_t *scene) {
+  return scene->integrator;
+}
+
+narrow_phase_t scene_get_narrow_phase(scene_t *scene) {
+  return scene->narrow_phase;
+}
+
+void scene_set_cell_size(scene_t *scene, double cell_size) {
+  spatial_hash_set_cell_size(scene->grid, cell_size);
+  scene->index_current = false;
+}
+
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       contact_manifold_t manifold, double elasticity,
+                       double *impulses) {
+  if (scene->num_contacts == scene->contact_capacity) {
+    scene->contact_capacity *= 2;
+    scene->contacts = realloc(scene->contacts,
+                              sizeof(contact_t) * scene->contact_capacity);
+    assert(scene->contacts);
+  }
+  contact_t *contact = &scene->contacts[scene->num_contacts++];
+  *contact = (contact_t){.body1 = body1,
+                         .body2 = body2,
+                         .manifold = manifold,
+                         .elasticity = elasticity,
+                         .saved_impulses = impulses};
+  for (size_t i = 0; i < 2; i++) {
+    bool has_point = impulses != NULL && i < manifold.num_points;
+    contact->impulses[i] = has_point ? impulses[i] : 0;
+  }
+}
+
+void scene_set_solver_iterations(scene_t *scene, size_t iterations) {
+  assert(iterations > 0);
+  scene->solver_iterations = iterations;
+}
+
+void scene_set_position_correction(scene_t *scene, double fraction,
+                                   double slop) {
+  assert(fraction >= 0 && fraction <= 1 && slop >= 0);
+  scene->correction_fraction = fraction;
+  scene->correction_slop = slop;
+}
+
+/**
+ * Empties a list that does not own its elements.
+ */
+static void clear_list(list_t *list) {
+  while (list_size(list) > 0) {
+    list_remove(list, list_size(list) - 1);
+  }
+}
+
+/**
+ * Queues a collision entry found by the broad phase to run this tick.
+ * Called on each entry registered between a pair of candidate bodies.
+ */
+static void queue_collision(void *body1, void *body2, void *entry, void *aux) {
+  scene_t *scene = aux;
+  force_entry_t *force = entry;
+  if (force->last_tick != scene->tick) {
+    force->last_tick = scene->tick;
+    // the pending collisions become the active ones at the end of the tick
+    force->active_index = list_size(scene->pending_collisions);
+    list_add(scene->pending_collisions, force);
+  }
+}
+
+/**
+ * Returns whether two bodies' categories and masks let rules and sensors
+ * pair them. Two bodies with infinite mass are never paired.
+ */
+static bool filters_allow(body_t *body1, body_t *body2) {
+  return (body_get_category(body1) & body_get_mask(body2)) &&
+         (body_get_category(body2) & body_get_mask(body1)) &&
+         !(is_static(body1) && is_static(body2));
+}
+
+/**
+ * Returns the first rule that makes two bodies collide, or NULL if there is
+ * none. Sets *swapped if body2 is the one in the rule's first category.
+ */
+static collision_rule_t *find_rule(scene_t *scene, body_t *body1,
+                                   body_t *body2, bool *swapped) {
+  if (!filters_allow(body1, body2)) {
+    return NULL;
+  }
+  uint32_t category1 = body_get_category(body1);
+  uint32_t category2 = body_get_category(body2);
+  for (size_t i = 0; i < scene->num_rules; i++) {
+    collision_rule_t *rule = &scene->rules[i];
+    if ((category1 & rule->category1) && (category2 & rule->category2)) {
+      *swapped = false;
+      return rule;
+    }
+    if ((category2 & rule->category1) && (category1 & rule->category2)) {
+      *swapped = true;
+      return rule;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Records the collision entry a rule generated for a pair of bodies.
+ */
+static void store_entry(void *body1, void *body2, void *entry, void *aux) {
+  *(force_entry_t **)aux = entry;
+}
+
+/**
+ * Adds an entry a rule or sensor generated to the scene's rule entries and
+ * pairs, and to the force entries of its bodies.
+ */
+static force_entry_t *add_rule_entry(scene_t *scene, force_entry_t *entry) {
+  entry->generated = true;
+  entry->rule_index = list_size(scene->rule_entries);
+  list_add(scene->rule_entries, entry);
+  pair_table_add(scene->rule_pairs, list_get(entry->bodies, 0),
+                 list_get(entry->bodies, 1), entry);
+  link_force_entry(entry, entry->bodies);
+  return entry;
+}
+
+/**
+ * Returns the entry generated for a sensor and a body overlapping it, or for
+ * a pair of bodies a rule applies to, generating it if the pair has none
+ * yet. Returns NULL if the pair needs no entry.
+ */
+static force_entry_t *rule_entry(scene_t *scene, body_t *body1,
+                                 body_t *body2) {
+  force_entry_t *entry = NULL;
+  pair_table_find(scene->rule_pairs, body1, body2, store_entry, &entry);
+  if (entry != NULL) {
+    return entry;
+  }
+  if (body_is_sensor(body1) || body_is_sensor(body2)) {
+    if (!filters_allow(body1, body2)) {
+      return NULL;
+    }
+    if (!body_is_sensor(body1)) {
+      body_t *temp = body1;
+      body1 = body2;
+      body2 = temp;
+    }
+    return add_rule_entry(scene,
+                          sensor_entry_init(scene, body1, body2,
+                                            scene->sensor_handler,
+                                            scene->sensor_aux));
+  }
+  bool swapped;
+  collision_rule_t *rule = find_rule(scene, body1, body2, &swapped);
+  if (rule == NULL) {
+    return NULL;
+  }
+  if (swapped) {
+    body_t *temp = body1;
+    body1 = body2;
+    body2 = temp;
+  }
+  return add_rule_entry(
+      scene, collision_entry_init(scene, body1, body2, rule->handler,
+                                  rule->aux, rule->force_const,
+                                  rule->resolves_contact));
+}
+
+/**
+ * Looks up the collision entries between a pair of bodies whose bounding
+ * boxes overlap, including the one generated by a rule.
+ */
+static void find_pair_collisions(void *body1, void *body2, void *aux) {
+  scene_t *scene = aux;
+  if (body_is_removed(body1) || body_is_removed(body2)) {
+    return;
+  }
+  pair_table_find(scene->collision_pairs, body1, body2, queue_collision, scene);
+  if (scene->num_rules > 0 || body_is_sensor(body1) || body_is_sensor(body2)) {
+    force_entry_t *entry = rule_entry(scene, body1, body2);
+    if (entry != NULL) {
+      queue_collision(body1, body2, entry, scene);
+    }
+  }
+}
+
+typedef struct static_query {
+  scene_t *scene;
+  body_t *body;
+  aabb_t box;
+} static_query_t;
+
+/**
+ * Called on each body in the tree whose fat box overlaps the queried body's
+ * box. Pairs of two bodies in the tree are only reported by the body with
+ * the smaller proxy id, so each is reported once.
+ */
+static void find_static_collisions(void *body, void *aux) {
+  static_query_t *query = aux;
+  if (body == query->body ||
+      (is_static(query->body) &&
+       body_get_proxy(body) < body_get_proxy(query->body)) ||
+      !aabb_overlap(body_get_aabb(body), query->box)) {
+    return;
+  }
+  find_pair_collisions(query->body, body, query->scene);
+}
+
+/**
+ * Updates the boxes of the bodies in the tree, which may have moved.
+ */
+static void move_statics(scene_t *scene) {
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (is_static(body)) {
+      bvh_move(scene->statics, body_get_proxy(body), body_get_aabb(body));
+    }
+  }
+}
+
+/**
+ * Buckets every moving body into the grid by its current bounding box.
+ */
+static void fill_grid(scene_t *scene) {
+  spatial_hash_clear(scene->grid);
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (!is_static(body) && !body_is_removed(body)) {
+      spatial_hash_insert(scene->grid, body, body_get_aabb(body));
+    }
+  }
+}
+
+/**
+ * Passes every pair of bodies whose bounding boxes overlap to
+ * find_pair_collisions(). Pairs of moving bodies come from the scene's broad
+ * phase; each moving body then looks up the bodies in the tree it overlaps.
+ */
+static void find_candidate_pairs(scene_t *scene) {
+  move_statics(scene);
+
+  switch (scene->broad_phase) {
+  case BROAD_PHASE_GRID:
+    fill_grid(scene);
+    spatial_hash_query_pairs(scene->grid, find_pair_collisions, scene);
+    break;
+  case BROAD_PHASE_SWEEP:
+    for (size_t i = 0; i < scene->num_bodies; i++) {
+      body_t *body = list_get(scene->bodies, i);
+      if (!is_static(body)) {
+        sweep_and_prune_move(scene->sweep, body_get_proxy(body),
+                             body_get_aabb(body));
+      }
+    }
+    sweep_and_prune_update(scene->sweep);
+    sweep_and_prune_query_pairs(scene->sweep, find_pair_collisions, scene);
+    break;
+  }
+
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    // bodies in the tree only need to query it if some of them can collide;
+    // rules never pair them
+    if (body_is_removed(body) ||
+        (is_static(body) && scene->num_static_collisions == 0)) {
+      continue;
+    }
+    static_query_t query = {
+        .scene = scene, .body = body, .box = body_get_aabb(body)};
+    bvh_query(scene->statics, query.box, find_static_collisions, &query);
+  }
+}
+
+/**
+ * Removes a collision entry from those run during the previous tick, if it
+ * is one of them, moving the last of them into its index.
+ */
+static void forget_active_collision(scene_t *scene, force_entry_t *entry) {
+  list_t *active = scene->active_collisions;
+  size_t index = entry->active_index;
+  if (index >= list_size(active) || list_get(active, index) != entry) {
+    return;
+  }
+  list_swap_remove(active, index);
+  if (index < list_size(active)) {
+    force_entry_t *moved = list_get(active, index);
+    moved->active_index = index;
+  }
+}
+
+/**
+ * Frees a collision entry a rule generated, moving the scene's last rule
+ * entry into its index, and forgets it in its bodies other than freed.
+ */
+static void free_rule_entry(scene_t *scene, force_entry_t *entry,
+                            body_t *freed) {
+  list_t *entries = scene->rule_entries;
+  size_t index = entry->rule_index;
+  list_swap_remove(entries, index);
+  if (index < list_size(entries)) {
+    force_entry_t *moved = list_get(entries, index);
+    moved->rule_index = index;
+  }
+  pair_table_remove(scene->rule_pairs, list_get(entry->bodies, 0),
+                    list_get(entry->bodies, 1), entry);
+  forget_active_collision(scene, entry);
+  unlink_force_entry(entry, entry->bodies, freed);
+  force_free(entry);
+}
+
+/**
+ * Runs the collision entries whose bodies' bounding boxes overlap.
+ * Entries are queued before any of them run, since a collision handler may
+ * register new collisions (and so modify the pair table) while it runs.
+ */
+static void run_collisions(scene_t *scene) {
+  find_candidate_pairs(scene);
+
+  for (size_t i = 0; i < list_size(scene->pending_collisions); i++) {
+    force_entry_t *entry = list_get(scene->pending_collisions, i);
+    forces_get_force_creator(entry)(forces_get_force_aux(entry));
+  }
+
+  // entries that stopped overlapping run one last time to observe that their
+  // bodies have separated
+  for (size_t i = 0; i < list_size(scene->active_collisions); i++) {
+    force_entry_t *entry = list_get(scene->active_collisions, i);
+    if (entry->last_tick != scene->tick) {
+      forces_get_force_creator(entry)(forces_get_force_aux(entry));
+    }
+  }
+
+  list_t *finished = scene->active_collisions;
+  scene->active_collisions = scene->pending_collisions;
+  scene->pending_collisions = finished;
+  clear_list(scene->pending_collisions);
+
+  // entries generated by rules are dropped once they have run their last
+  // time; the entry moved into a freed one's index has already been visited
+  for (ssize_t i = list_size(scene->rule_entries) - 1; i >= 0; i--) {
+    force_entry_t *entry = list_get(scene->rule_entries, i);
+    if (entry->last_tick != scene->tick) {
+      free_rule_entry(scene, entry, NULL);
+    }
+  }
+}
+
+/**
+ * Returns how readily a body moves when pushed, 0 if it has infinite mass.
+ */
+static double inverse_mass(scene_t *scene, body_t *body) {
+  return scene->store->inverse_masses[body_get_slot(body)];
+}
+
+/**
+ * Applies an impulse along a contact's normal, pushing body2 forwards and
+ * body1 back.
+ */
+static void apply_contact_impulse(contact_t *contact, double impulse) {
+  vector_t push = vec_multiply(impulse, contact->manifold.normal);
+  body_add_impulse(contact->body1, vec_negate(push));
+  body_add_impulse(contact->body2, push);
+}
+
+/**
+ * Returns how fast a contact's bodies will be separating along its normal
+ * after the tick, given the impulses applied so far.
+ */
+static double separating_speed(contact_t *contact, double dt) {
+  vector_t relative = vec_subtract(body_get_next_velocity(contact->body2, dt),
+                                   body_get_next_velocity(contact->body1, dt));
+  return vec_dot(relative, contact->manifold.normal);
+}
+
+/**
+ * Solves the contacts reported this tick with sequential impulses.
+ * Each pass gives every contact point the impulse that makes it separate at
+ * its target speed, given the impulses of all the others. The total impulse
+ * at a point is clamped rather than each increment, so a later pass can
+ * take back what an earlier one overshot, but never pull the bodies
+ * together. Contacts start from the previous tick's impulses, so resting
+ * contacts start out nearly solved.
+ */
+static void solve_contacts(scene_t *scene, double dt) {
+  // the bounce is decided by how fast the bodies approached before solving
+  for (size_t i = 0; i < scene->num_contacts; i++) {
+    contact_t *contact = &scene->contacts[i];
+    double approach = -separating_speed(contact, dt);
+    for (size_t j = 0; j < contact->manifold.num_points; j++) {
+      contact->target_speeds[j] =
+          approach > RESTITUTION_THRESHOLD ? contact->elasticity * approach
+                                           : 0;
+    }
+  }
+  for (size_t i = 0; i < scene->num_contacts; i++) {
+    contact_t *contact = &scene->contacts[i];
+    for (size_t j = 0; j < contact->manifold.num_points; j++) {
+      apply_contact_impulse(contact, contact->impulses[j]);
+    }
+  }
+
+  for (size_t iteration = 0; iteration < scene->solver_iterations;
+       iteration++) {
+    for (size_t i = 0; i < scene->num_contacts; i++) {
+      contact_t *contact = &scene->contacts[i];
+      double inverse_sum =
+          inverse_mass(scene, contact->body1) +
+          inverse_mass(scene, contact->body2);
+      if (inverse_sum == 0) {
+        continue;
+      }
+      for (size_t j = 0; j < contact->manifold.num_points; j++) {
+        double needed = (contact->target_speeds[j] -
+                         separating_speed(contact, dt)) / inverse_sum;
+        double total = fmax(contact->impulses[j] + needed, 0);
+        apply_contact_impulse(contact, total - contact->impulses[j]);
+        contact->impulses[j] = total;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < scene->num_contacts; i++) {
+    contact_t *contact = &scene->contacts[i];
+    if (contact->saved_impulses != NULL) {
+      contact->saved_impulses[0] = contact->impulses[0];
+      contact->saved_impulses[1] = contact->impulses[1];
+    }
+  }
+}
+
+/**
+ * Pushes apart the bodies of each contact reported this tick, which keeps
+ * resting bodies from sinking into each other.
+ */
+static void correct_positions(scene_t *scene) {
+  for (size_t i = 0; i < scene->num_contacts; i++) {
+    contact_t *contact = &scene->contacts[i];
+    if (body_is_removed(contact->body1) || body_is_removed(contact->body2)) {
+      continue;
+    }
+    double inverse1 = inverse_mass(scene, contact->body1);
+    double inverse2 = inverse_mass(scene, contact->body2);
+    double excess = contact->manifold.depth - scene->correction_slop;
+    if (inverse1 + inverse2 == 0 || excess <= 0) {
+      continue;
+    }
+    vector_t push = vec_multiply(
+        scene->correction_fraction * excess / (inverse1 + inverse2),
+        contact->manifold.normal);
+    body_set_centroid(contact->body1,
+                      vec_subtract(body_get_centroid(contact->body1),
+                                   vec_multiply(inverse1, push)));
+    body_set_centroid(contact->body2,
+                      vec_add(body_get_centroid(contact->body2),
+                              vec_multiply(inverse2, push)));
+  }
+  scene->num_contacts = 0;
+}
+
+typedef struct impact_query {
+  scene_t *scene;
+  body_t *body;
+  vector_t motion;
+  // the earliest impact found so far, and the bodies hit at it, which are
+  // collected in scene->impact_hits
+  double time;
+} impact_query_t;
+
+/**
+ * Records that a pair of bodies has a collision entry registered.
+ */
+static void mark_registered(void *body1, void *body2, void *entry,
+                            void *aux) {
+  *(bool *)aux = true;
+}
+
+/**
+ * Returns whether a list that does not own its elements holds an element.
+ */
+static bool list_contains(list_t *list, void *value) {
+  for (size_t i = 0; i < list_size(list); i++) {
+    if (list_get(list, i) == value) {
       return true;
     }
   }
   return false;
 }
 
-void scene_tick(scene_t *scene, double dt) {
+/**
+ * Called on each body whose bounding box the queried body sweeps through.
+ * Records when the queried body would hit it, if they can collide at all,
+ * keeping every body hit at the earliest impact.
+ */
+static void find_impact(void *body, void *aux) {
+  impact_query_t *query = aux;
+  // sensors do not stop bodies
+  if (body == query->body || body_is_removed(body) || body_is_sensor(body) ||
+      body_is_sensor(query->body)) {
+    return;
+  }
+  bool registered = false;
+  pair_table_find(query->scene->collision_pairs, query->body, body,
+                  mark_registered, &registered);
+  bool swapped;
+  if (!registered &&
+      find_rule(query->scene, query->body, body, &swapped) == NULL) {
+    return;
+  }
+  double time = find_time_of_impact(body, VEC_ZERO, query->body, query->motion);
+  list_t *hits = query->scene->impact_hits;
+  // a body still driven into one it has already been resolved against this
+  // tick was let through by the collision, so it is not stopped again
+  if (time == INFINITY ||
+      (time == 0 && list_contains(query->scene->impacted, body))) {
+    return;
+  }
+  if (time < query->time - CCD_SIMULTANEOUS_FRACTION) {
+    clear_list(hits);
+  }
+  if (time <= query->time + CCD_SIMULTANEOUS_FRACTION) {
+    list_add(hits, body);
+    query->time = fmin(query->time, time);
+  }
+}
+
+/**
+ * Collects a collision entry to run at the moment of an impact.
+ */
+static void queue_impact_collision(void *body1, void *body2, void *entry,
+                                   void *aux) {
+  list_add(aux, entry);
+}
+
+/**
+ * Changes a body's velocity by the impulse applied to it so far and clears
+ * the impulse, so it takes effect now rather than when the body next ticks.
+ */
+static void apply_impulse_now(scene_t *scene, body_t *body) {
+  body_store_t *store = scene->store;
+  size_t slot = body_get_slot(body);
+  store->velocities[slot] =
+      vec_add(store->velocities[slot],
+              vec_multiply(store->inverse_masses[slot], store->impulses[slot]));
+  store->impulses[slot] = VEC_ZERO;
+}
+
+/**
+ * Runs the collision entries between a body and each body it has just hit,
+ * and solves all their contacts together straight away, so every body
+ * leaves the impact with its new velocity.
+ */
+static void resolve_impact(scene_t *scene, body_t *body) {
+  list_t *entries = scene->pending_collisions;
+  list_t *hits = scene->impact_hits;
+  for (size_t i = 0; i < list_size(hits); i++) {
+    body_t *hit = list_get(hits, i);
+    pair_table_find(scene->collision_pairs, body, hit, queue_impact_collision,
+                    entries);
+    force_entry_t *rule = rule_entry(scene, body, hit);
+    if (rule != NULL) {
+      list_add(entries, rule);
+    }
+    if (!list_contains(scene->impacted, hit)) {
+      list_add(scene->impacted, hit);
+    }
+  }
+  for (size_t i = 0; i < list_size(entries); i++) {
+    force_entry_t *entry = list_get(entries, i);
+    forces_get_force_creator(entry)(forces_get_force_aux(entry));
+  }
+  clear_list(entries);
+  solve_contacts(scene, 0);
+  correct_positions(scene);
+
+  // every body has ticked already, so apply the solver's impulses now
+  apply_impulse_now(scene, body);
+  for (size_t i = 0; i < list_size(hits); i++) {
+    apply_impulse_now(scene, list_get(hits, i));
+  }
+}
+
+/**
+ * Sweeps a body that has just ticked from where it started the tick to
+ * where it ended up, stopping it at the first body it hits along the way.
+ * At each impact the collisions with every body it touches are resolved,
+ * and the body carries on with its new velocity for the rest of the tick.
+ * Other bodies are treated as still.
+ */
+static void advance_continuously(scene_t *scene, body_t *body, vector_t start,
+                                 double dt) {
+  vector_t motion = vec_subtract(body_get_centroid(body), start);
+  aabb_t box = body_get_aabb(body);
+  double size = fmin(box.max.x - box.min.x, box.max.y - box.min.y);
+  if (vec_get_length(motion) <= CCD_MOTION_FRACTION * size) {
+    return;
+  }
+
+  double time_left = dt;
+  clear_list(scene->impacted);
+  for (size_t i = 0; i < CCD_MAX_IMPACTS; i++) {
+    body_set_centroid(body, start);
+    box = body_get_aabb(body);
+    aabb_t swept = aabb_union(box, (aabb_t){.min = vec_add(box.min, motion),
+                                            .max = vec_add(box.max, motion)});
+    impact_query_t query = {.scene = scene,
+                            .body = body,
+                            .motion = motion,
+                            .time = INFINITY};
+    clear_list(scene->impact_hits);
+    bvh_query(scene->statics, swept, find_impact, &query);
+    for (size_t j = 0; j < scene->num_bodies; j++) {
+      body_t *other = list_get(scene->bodies, j);
+      if (!is_static(other) && aabb_overlap(body_get_aabb(other), swept)) {
+        find_impact(other, &query);
+      }
+    }
+    if (list_size(scene->impact_hits) == 0) {
+      body_set_centroid(body, vec_add(start, motion));
+      return;
+    }
+
+    start = vec_add(start, vec_multiply(query.time, motion));
+    body_set_centroid(body, start);
+    time_left *= 1 - query.time;
+    resolve_impact(scene, body);
+    motion = vec_multiply(time_left, body_get_velocity(body));
+  }
+}
+
+/**
+ * Brings the tree and grid up to date for queries, if bodies have moved
+ * since they were last updated.
+ */
+static void refresh_index(scene_t *scene) {
+  if (!scene->index_current) {
+    move_statics(scene);
+    fill_grid(scene);
+    scene->index_current = true;
+  }
+}
+
+typedef struct cast_query {
+  vector_t origin;
+  vector_t delta;
+  double radius;
+  body_filter_t filter;
+  void *aux;
+  // the closest hit so far, as a fraction of the query's full displacement
+  raycast_hit_t hit;
+  // the fraction of the full displacement that delta currently covers
+  double scale;
+} cast_query_t;
+
+/**
+ * Called on each body whose bounding box a cast passes near. Records where
+ * the cast hits the body if it is the closest hit so far, and shortens the
+ * cast to it.
+ */
+static double cast_at_body(void *body, void *aux) {
+  cast_query_t *query = aux;
+  if (body_is_removed(body) ||
+      (query->filter != NULL && !query->filter(body, query->aux))) {
+    return INFINITY;
+  }
+  cast_info_t info =
+      find_shapecast(body, query->origin, query->radius, query->delta);
+  double fraction = info.fraction * query->scale;
+  if (!info.hit || fraction >= query->hit.fraction) {
+    return INFINITY;
+  }
+  query->hit = (raycast_hit_t){.body = body,
+                               .point = info.point,
+                               .normal = info.normal,
+                               .fraction = fraction};
+  return info.fraction;
+}
+
+/**
+ * Casts a circle, or a ray if the radius is 0, through the scene's tree and
+ * then its grid, which are first brought up to date if bodies have moved.
+ */
+static raycast_hit_t cast_through_scene(scene_t *scene, vector_t origin,
+                                        double radius, vector_t direction,
+                                        double max_distance,
+                                        body_filter_t filter, void *aux) {
+  cast_query_t query = {.origin = origin,
+                        .radius = radius,
+                        .filter = filter,
+                        .aux = aux,
+                        .hit = {.body = NULL, .fraction = 1},
+                        .scale = 1};
+  double length = vec_get_length(direction);
+  if (length == 0 || max_distance <= 0) {
+    return query.hit;
+  }
+  query.delta = vec_multiply(max_distance / length, direction);
+  refresh_index(scene);
+
+  bvh_raycast(scene->statics, origin, query.delta, radius, cast_at_body,
+              &query);
+  // the grid only needs to be walked up to the closest hit in the tree
+  query.scale = query.hit.fraction;
+  query.delta = vec_multiply(query.scale, query.delta);
+  spatial_hash_raycast(scene->grid, origin, query.delta, radius, cast_at_body,
+                       &query);
+  return query.hit;
+}
+
+raycast_hit_t scene_raycast(scene_t *scene, vector_t origin, vector_t direction,
+                            double max_distance, body_filter_t filter,
+                            void *aux) {
+  return cast_through_scene(scene, origin, 0, direction, max_distance, filter,
+                            aux);
+}
+
+raycast_hit_t scene_shapecast(scene_t *scene, vector_t origin, double radius,
+                              vector_t direction, double max_distance,
+                              body_filter_t filter, void *aux) {
+  return cast_through_scene(scene, origin, radius, direction, max_distance,
+                            filter, aux);
+}
+
+typedef struct region_query {
+  aabb_t box;
+  // if true, only bodies containing box.min are reported
+  bool point;
+  body_handler_t handler;
+  void *aux;
+} region_query_t;
+
+/**
+ * Called on each body whose (fat) bounding box overlaps a queried region.
+ * Reports the body if it really overlaps the region.
+ */
+static void report_region_body(void *body, void *aux) {
+  region_query_t *query = aux;
+  if (body_is_removed(body) || !aabb_overlap(body_get_aabb(body), query->box) ||
+      (query->point && !body_contains_point(body, query->box.min))) {
+    return;
+  }
+  query->handler(body, query->aux);
+}
+
+/**
+ * Reports the bodies overlapping a region, looking them up in the scene's
+ * tree and grid.
+ */
+static void query_region(scene_t *scene, region_query_t *query) {
+  refresh_index(scene);
+  bvh_query(scene->statics, query->box, report_region_body, query);
+  spatial_hash_query(scene->grid, query->box, report_region_body, query);
+}
+
+void scene_query_point(scene_t *scene, vector_t point, body_handler_t handler,
+                       void *aux) {
+  region_query_t query = {.box = {.min = point, .max = point},
+                          .point = true,
+                          .handler = handler,
+                          .aux = aux};
+  query_region(scene, &query);
+}
+
+void scene_query_aabb(scene_t *scene, aabb_t box, body_handler_t handler,
+                      void *aux) {
+  region_query_t query = {
+      .box = box, .point = false, .handler = handler, .aux = aux};
+  query_region(scene, &query);
+}
+
+/**
+ * Forgets a collision entry that is about to be freed.
+ */
+static void unregister_collision(scene_t *scene, force_entry_t *entry) {
+  body_t *body1 = list_get(entry->bodies, 0);
+  body_t *body2 = list_get(entry->bodies, 1);
+  pair_table_remove(scene->collision_pairs, body1, body2, entry);
+  if (is_static(body1) && is_static(body2)) {
+    scene->num_static_collisions--;
+  }
+  forget_active_collision(scene, entry);
+}
+
+/**
+ * Frees a force entry, moving the scene's last force entry into its index,
+ * and forgets it in the bodies it depends on other than freed.
+ */
+static void free_force_entry(scene_t *scene, force_entry_t *entry,
+                             body_t *freed) {
+  size_t index;
+  bool found = slot_map_find(scene->force_handles, entry->handle, &index);
+  assert(found);
+  list_swap_remove(scene->force_creators, index);
+  slot_map_swap_remove(scene->force_handles, index);
+  scene->num_forces--;
+  if (entry->is_collision) {
+    unregister_collision(scene, entry);
+  }
+  unlink_force_entry(entry, entry->bodies, freed);
+  force_free(entry);
+}
+
+/**
+ * Frees the force entries marked by scene_remove_force().
+ */
+static void free_removed_forces(scene_t *scene) {
+  while (list_size(scene->removed_forces) > 0) {
+    size_t last = list_size(scene->removed_forces) - 1;
+    free_force_entry(scene, list_swap_remove(scene->removed_forces, last),
+                     NULL);
+  }
+}
+
+/**
+ * Frees a body marked for removal, and the force entries that depend on it,
+ * moving the scene's last body into its index.
+ */
+static void free_removed_body(scene_t *scene, size_t index) {
+  body_t *body = list_get(scene->bodies, index);
+  // an entry marked by scene_remove_force() may depend on the body, and
+  // would otherwise be freed after it
+  free_removed_forces(scene);
+  list_t *entries = body_get_force_entries(body);
+  while (list_size(entries) > 0) {
+    force_entry_t *entry = list_swap_remove(entries, list_size(entries) - 1);
+    if (entry->generated) {
+      free_rule_entry(scene, entry, body);
+    } else {
+      free_force_entry(scene, entry, body);
+    }
+  }
+  if (is_static(body)) {
+    bvh_remove(scene->statics, body_get_proxy(body));
+  } else if (scene->sweep != NULL) {
+    sweep_and_prune_remove(scene->sweep, body_get_proxy(body));
+  }
+  body_free(list_swap_remove(scene->bodies, index));
+  slot_map_swap_remove(scene->body_handles, index);
+  scene->num_bodies--;
+}
+
+/**
+ * Adds the force of each of the scene's fields to each body it acts on.
+ */
+static void apply_fields(scene_t *scene) {
+  if (scene->num_fields == 0) {
+    return;
+  }
+  body_store_t *store = scene->store;
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    if ((store->flags[i] & BODY_REMOVED) || store->inverse_masses[i] == 0) {
+      continue;
+    }
+    vector_t velocity = store->velocities[i];
+    vector_t force = VEC_ZERO;
+    for (size_t j = 0; j < scene->num_fields; j++) {
+      scene_field_t *entry = &scene->fields[j];
+      if (entry->filter &&
+          !entry->filter(list_get(scene->bodies, i), entry->aux)) {
+        continue;
+      }
+      force_field_t *field = &entry->field;
+      vector_t relative = vec_subtract(velocity, field->flow);
+      double drag = field->linear_drag +
+                    field->quadratic_drag * vec_get_length(relative);
+      vector_t weight = vec_multiply(store->masses[i], field->acceleration);
+      force = vec_add(force,
+                      vec_subtract(weight, vec_multiply(drag, relative)));
+    }
+    store->forces[i] = vec_add(store->forces[i], force);
+  }
+}
+
+/**
+ * Applies the scene's force fields and runs its force creators, other than
+ * collisions and force solvers.
+ */
+static void run_force_creators(scene_t *scene) {
+  apply_fields(scene);
   for (size_t i = 0; i < scene->num_forces; i++) {
     force_entry_t *entry = list_get(scene->force_creators, i);
+    if (entry->is_collision || entry->solver) {
+      continue;
+    }
     void *aux = forces_get_force_aux(entry);
     forces_get_force_creator(entry)(aux);
   }
+}
 
-  for (ssize_t i = 0; i < scene->num_bodies; i++) {
-    body_t *body = list_get(scene->bodies, i);
-    if (body_is_removed(body)) {
-      for (ssize_t j = 0; j < scene->num_forces; j++) {
-        force_entry_t *entry = list_get(scene->force_creators, j);
-        list_t *bodies = entry->bodies;
-        body_aux_t *aux = entry->aux;
-        list_t *aux_bodies = aux->bodies;
-        // check if body to be removed is in the force's bodies or force's aux's
-        // bodies
-        if (remove_force(body, bodies) || remove_force(body, aux_bodies)) {
-          force_free(list_remove(scene->force_creators, j));
-          scene->num_forces--;
-          j--;
-        }
+/**
+ * Grows the arrays holding the bodies' RK4 or error estimation stages to fit
+ * every body.
+ */
+static void reserve_stages(scene_t *scene) {
+  if (scene->stage_capacity >= scene->num_bodies) {
+    return;
+  }
+  size_t n = scene->stage_capacity = scene->num_bodies;
+  scene->stage_positions =
+      realloc(scene->stage_positions, sizeof(vector_t) * n);
+  scene->stage_velocities =
+      realloc(scene->stage_velocities, sizeof(vector_t) * n);
+  scene->position_accelerations =
+      realloc(scene->position_accelerations, sizeof(vector_t) * n);
+  scene->velocity_accelerations =
+      realloc(scene->velocity_accelerations, sizeof(vector_t) * n);
+  scene->stage_forces = realloc(scene->stage_forces, sizeof(vector_t) * n);
+  scene->start_forces = realloc(scene->start_forces, sizeof(vector_t) * n);
+  scene->stage_impulses = realloc(scene->stage_impulses, sizeof(vector_t) * n);
+  assert(scene->stage_positions && scene->stage_velocities &&
+         scene->position_accelerations && scene->velocity_accelerations &&
+         scene->stage_forces && scene->start_forces && scene->stage_impulses);
+}
+
+/**
+ * Returns the acceleration of the body in slot i of a store from the forces
+ * on it.
+ */
+static vector_t acceleration(body_store_t *store, size_t i) {
+  return vec_multiply(store->inverse_masses[i], store->forces[i]);
+}
+
+/**
+ * Evaluates the forces on the bodies at RK4's three later stages, moving
+ * each body to each stage, then puts the bodies back where they started,
+ * with their impulses folded into their velocities, and combines the
+ * stages' accelerations for tick_rk4():
+ * x += dt v + dt^2 (a1 + a2 + a3) / 6 and v += dt (a1 + 2 a2 + 2 a3 + a4) / 6.
+ */
+static void integrate_rk4_stages(scene_t *scene, double dt) {
+  // how far into the tick each later stage is, and how much the stage
+  // before it counts towards the position and velocity
+  const double fractions[3] = {0.5, 0.5, 1};
+  const double position_weights[3] = {1, 1, 0};
+  const double velocity_weights[3] = {2, 2, 1};
+
+  body_store_t *store = scene->store;
+  size_t n = store->size;
+  reserve_stages(scene);
+  for (size_t i = 0; i < n; i++) {
+    vector_t start = acceleration(store, i);
+    scene->stage_positions[i] = store->centroids[i];
+    scene->stage_velocities[i] = vec_add(
+        store->velocities[i],
+        vec_multiply(store->inverse_masses[i], store->impulses[i]));
+    scene->position_accelerations[i] = start;
+    scene->velocity_accelerations[i] = start;
+    store->velocities[i] = scene->stage_velocities[i];
+  }
+  for (size_t stage = 0; stage < 3; stage++) {
+    double step = fractions[stage] * dt;
+    for (size_t i = 0; i < n; i++) {
+      if (store->flags[i] & BODY_REMOVED) {
+        continue;
       }
-      body_free(list_remove(scene->bodies, i));
-      scene->num_bodies--;
+      vector_t velocity = store->velocities[i];
+      store->velocities[i] =
+          vec_add(scene->stage_velocities[i],
+                  vec_multiply(step, acceleration(store, i)));
+      store->centroids[i] =
+          vec_add(scene->stage_positions[i], vec_multiply(step, velocity));
+    }
+    body_store_reset(store);
+    run_force_creators(scene);
+    for (size_t i = 0; i < n; i++) {
+      vector_t reached = acceleration(store, i);
+      scene->position_accelerations[i] =
+          vec_add(scene->position_accelerations[i],
+                  vec_multiply(position_weights[stage], reached));
+      scene->velocity_accelerations[i] =
+          vec_add(scene->velocity_accelerations[i],
+                  vec_multiply(velocity_weights[stage], reached));
+    }
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (!(store->flags[i] & BODY_REMOVED)) {
+      store->centroids[i] = scene->stage_positions[i];
+      store->velocities[i] = scene->stage_velocities[i];
+    }
+    scene->position_accelerations[i] =
+        vec_multiply(1.0 / 3, scene->position_accelerations[i]);
+    scene->velocity_accelerations[i] =
+        vec_multiply(1.0 / 6, scene->velocity_accelerations[i]);
+  }
+  body_store_reset(store);
+}
+
+/**
+ * Advances every body in the scene's store over a tick with the scene's
+ * integrator, streaming through the store's arrays.
+ */
+typedef void (*integrator_kernel_t)(scene_t *scene, double dt);
+
+static void tick_simpson(scene_t *scene, double dt) {
+  body_store_tick(scene->store, 0, scene->store->size, dt);
+}
+
+static void tick_symplectic_euler(scene_t *scene, double dt) {
+  body_store_tick_symplectic_euler(scene->store, 0, scene->store->size, dt);
+}
+
+static void tick_velocity_verlet(scene_t *scene, double dt) {
+  body_store_tick_velocity_verlet(scene->store, 0, scene->store->size, dt);
+}
+
+/**
+ * Advances the bodies with the accelerations combined by
+ * integrate_rk4_stages().
+ */
+static void tick_rk4(scene_t *scene, double dt) {
+  body_store_advance(scene->store, 0, scene->store->size, dt,
+                     scene->position_accelerations,
+                     scene->velocity_accelerations);
+}
+
+// indexed by integrator_t
+static const integrator_kernel_t INTEGRATOR_KERNELS[] = {
+    tick_simpson, tick_symplectic_euler, tick_velocity_verlet, tick_rk4};
+
+/**
+ * Moves the state of the bodies left after removals down to fill the slots
+ * of the removed ones, so each body's slot is again its index.
+ */
+static void compact_store(scene_t *scene) {
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if (body_get_slot(body) != i) {
+      body_move_slot(body, i);
+    }
+  }
+  body_store_truncate(scene->store, scene->num_bodies);
+}
+
+void scene_tick(scene_t *scene, double dt) {
+  scene->tick++;
+  scene->interpolation_alpha = 1;
+  free_removed_forces(scene);
+
+  if (!scene->forces_current) {
+    run_force_creators(scene);
+  }
+  scene->forces_current = false;
+  for (size_t i = 0; i < scene->num_forces; i++) {
+    force_entry_t *entry = list_get(scene->force_creators, i);
+    if (entry->solver) {
+      entry->solver(forces_get_force_aux(entry), dt);
+    }
+  }
+
+  run_collisions(scene);
+  solve_contacts(scene, dt);
+  correct_positions(scene);
+  if (scene->integrator == INTEGRATOR_RK4) {
+    integrate_rk4_stages(scene, dt);
+  }
+
+  // each body's slot is its index until bodies are removed below; bodies
+  // added by the collisions at impacts wait for the next tick
+  body_store_t *store = scene->store;
+  size_t n = store->size;
+  reserve_stages(scene);
+  for (size_t i = 0; i < n; i++) {
+    if (store->flags[i] & BODY_CCD) {
+      scene->stage_positions[i] = store->centroids[i];
+    }
+  }
+  INTEGRATOR_KERNELS[scene->integrator](scene, dt);
+  for (size_t i = 0; i < n; i++) {
+    if ((store->flags[i] & (BODY_CCD | BODY_REMOVED)) == BODY_CCD) {
+      advance_continuously(scene, list_get(scene->bodies, i),
+                           scene->stage_positions[i], dt);
+    }
+  }
+
+  for (ssize_t i = 0; i < scene->num_bodies; i++) {
+    if (body_is_removed(list_get(scene->bodies, i))) {
+      free_removed_body(scene, i);
+      // the last body took this index, so it is visited next
       i--;
-    } else {
-      body_tick(body, dt);
     }
   }
-}
\ No newline at end of file
+  // a body moved into a removed body's index keeps its slot until now
+  compact_store(scene);
+  scene->index_current = false;
+}
+
+/**
+ * Puts the body in slot i back in the state saved by estimate_error(), with
+ * the forces the force creators gave it there.
+ */
+static void restore_slot(scene_t *scene, size_t i) {
+  body_store_t *store = scene->store;
+  store->centroids[i] = scene->stage_positions[i];
+  store->velocities[i] = scene->stage_velocities[i];
+  store->forces[i] = scene->start_forces[i];
+  store->impulses[i] = scene->stage_impulses[i];
+}
+
+/**
+ * Runs the force creators at the bodies' current state, unless they already
+ * have been, saving the forces the bodies had before and after.
+ */
+static void evaluate_start_forces(scene_t *scene) {
+  if (scene->forces_current) {
+    return;
+  }
+  free_removed_forces(scene);
+  body_store_t *store = scene->store;
+  for (size_t i = 0; i < store->size; i++) {
+    scene->stage_forces[i] = store->forces[i];
+  }
+  run_force_creators(scene);
+  for (size_t i = 0; i < store->size; i++) {
+    scene->start_forces[i] = store->forces[i];
+    scene->stage_impulses[i] = store->impulses[i];
+  }
+  scene->forces_current = true;
+}
+
+/**
+ * Estimates how far a tick of length dt would misplace a body, from an
+ * embedded pair of solutions that share two evaluations of the forces: one
+ * at the bodies' current state and one an Euler step ahead. The first
+ * solution holds each body's starting acceleration a0 over the tick; the
+ * second varies it linearly to the acceleration a1 found ahead. Their
+ * positions differ by dt^2 / 6 * |a1 - a0| and their velocities by
+ * dt / 2 * |a1 - a0|, which over another tick would misplace the body by dt
+ * times as much. The error is the largest of these distances over all
+ * bodies.
+ *
+ * The forces at the current state are kept on the bodies, and reused by the
+ * next tick and by the estimates for shorter ticks if this one is rejected.
+ * The bodies are otherwise left as they were.
+ */
+static double estimate_error(scene_t *scene, double dt) {
+  reserve_stages(scene);
+  evaluate_start_forces(scene);
+  body_store_t *store = scene->store;
+  for (size_t i = 0; i < store->size; i++) {
+    scene->stage_positions[i] = store->centroids[i];
+    scene->stage_velocities[i] = store->velocities[i];
+    if (store->flags[i] & BODY_REMOVED) {
+      continue;
+    }
+    vector_t start = acceleration(store, i);
+    vector_t velocity = vec_add(
+        store->velocities[i],
+        vec_multiply(store->inverse_masses[i], store->impulses[i]));
+    scene->position_accelerations[i] = start;
+    store->forces[i] = scene->stage_forces[i];
+    store->impulses[i] = VEC_ZERO;
+    store->centroids[i] =
+        vec_add(scene->stage_positions[i], vec_multiply(dt, velocity));
+    store->velocities[i] = vec_add(velocity, vec_multiply(dt, start));
+  }
+  run_force_creators(scene);
+
+  double error = 0;
+  for (size_t i = 0; i < store->size; i++) {
+    if (!(store->flags[i] & BODY_REMOVED)) {
+      double change = vec_get_length(vec_subtract(
+          acceleration(store, i), scene->position_accelerations[i]));
+      double position_error = dt * dt / 6 * change;
+      double velocity_error = dt / 2 * change;
+      error = fmax(error, fmax(position_error, dt * velocity_error));
+    }
+    restore_slot(scene, i);
+  }
+  return error;
+}
+
+void scene_step_adaptive(scene_t *scene, double dt, double tolerance) {
+  assert(tolerance > 0);
+  double step = scene->next_step > 0 ? scene->next_step : scene->max_step;
+  double remaining = dt;
+  while (remaining > 0) {
+    double length = fmin(fmax(step, scene->min_step), scene->max_step);
+    // split what little would be left after this tick with it, rather than
+    // leave a sliver of a tick for last
+    bool clipped = remaining < 2 * length;
+    if (clipped) {
+      length = remaining < length ? remaining : remaining / 2;
+    }
+    double error = estimate_error(scene, length);
+    double scale = error > 0 ? STEP_SAFETY * cbrt(tolerance / error)
+                             : MAX_STEP_GROWTH;
+    if (error > tolerance && length > scene->min_step) {
+      scene->step_stats.rejected_steps++;
+      step = length * fmax(scale, MAX_STEP_SHRINK);
+      continue;
+    }
+
+    scene_tick(scene, length);
+    remaining -= length;
+    step_stats_t *stats = &scene->step_stats;
+    stats->accepted_steps++;
+    stats->shortest_step = fmin(stats->shortest_step, length);
+    stats->longest_step = fmax(stats->longest_step, length);
+    // a tick cut short to end on time says little about the next one's
+    // length, unless it had to be even shorter
+    double next = length * fmin(scale, MAX_STEP_GROWTH);
+    step = clipped ? fmin(step, fmax(next, length)) : next;
+  }
+  scene->next_step = step;
+}
+
+void scene_set_step_limits(scene_t *scene, double min_step, double max_step) {
+  assert(min_step >= 0 && max_step >= min_step && max_step > 0);
+  scene->min_step = min_step;
+  scene->max_step = max_step;
+}
+
+step_stats_t scene_get_step_stats(scene_t *scene) { return scene->step_stats; }
+
+size_t scene_advance(scene_t *scene, double frame_dt) {
+  assert(frame_dt >= 0);
+  scene->accumulator += frame_dt;
+  size_t steps = 0;
+  while (scene->accumulator >= scene->fixed_step) {
+    if (steps == scene->max_catch_up_steps) {
+      // the scene has fallen too far behind to catch up without making the
+      // next frame even later, so it skips ahead
+      scene->accumulator = fmod(scene->accumulator, scene->fixed_step);
+      break;
+    }
+    body_store_save_transforms(scene->store);
+    scene_tick(scene, scene->fixed_step);
+    scene->accumulator -= scene->fixed_step;
+    steps++;
+  }
+  scene->interpolation_alpha = scene->accumulator / scene->fixed_step;
+  return steps;
+}
+
+void scene_set_fixed_step(scene_t *scene, double fixed_step,
+                          size_t max_steps) {
+  assert(fixed_step > 0 && max_steps > 0);
+  scene->fixed_step = fixed_step;
+  scene->max_catch_up_steps = max_steps;
+}
+
+double scene_get_interpolation_alpha(scene_t *scene) {
+  return scene->interpolation_alpha;
+}
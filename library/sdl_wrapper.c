@@ -189,10 +189,32 @@ void sdl_clear(void) {
   SDL_RenderClear(renderer);
 }
 
-void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
-  list_t *points = polygon_get_points(poly);
+/**
+ * Draws a circle, moved by offset, using SDL_gfx's circle primitive.
+ */
+static void draw_circle(polygon_t *circle, rgb_color_t color,
+                        vector_t offset) {
+  vector_t window_center = get_window_center();
+  vector_t pixel = get_window_position(
+      vec_add(polygon_get_center(circle), offset), window_center);
+  double radius = polygon_get_radius(circle) * get_scene_scale(window_center);
+  filledCircleRGBA(renderer, pixel.x, pixel.y, round(radius), color.r * 255,
+                   color.g * 255, color.b * 255, 255);
+}
+
+/**
+ * Draws a polygon rotated by angle about pivot, then moved by offset,
+ * without changing the polygon itself.
+ */
+static void draw_polygon_moved(polygon_t *poly, rgb_color_t color,
+                               vector_t offset, double angle, vector_t pivot) {
+  if (polygon_get_kind(poly) == SHAPE_CIRCLE) {
+    draw_circle(poly, color, offset);
+    return;
+  }
+
   // Check parameters
-  size_t n = list_size(points);
+  size_t n = polygon_num_vertices(poly);
   assert(n >= 3);
 
   vector_t window_center = get_window_center();
@@ -203,8 +225,12 @@ void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
   assert(x_points != NULL);
   assert(y_points != NULL);
   for (size_t i = 0; i < n; i++) {
-    vector_t *vertex = list_get(points, i);
-    vector_t pixel = get_window_position(*vertex, window_center);
+    vector_t vertex = polygon_get_vertex(poly, i);
+    if (angle != 0) {
+      vertex = vec_add(pivot, vec_rotate(vec_subtract(vertex, pivot), angle));
+    }
+    vector_t pixel =
+        get_window_position(vec_add(vertex, offset), window_center);
     x_points[i] = pixel.x;
     y_points[i] = pixel.y;
   }
@@ -216,6 +242,22 @@ void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
   free(y_points);
 }
 
+void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
+  draw_polygon_moved(poly, color, VEC_ZERO, 0, VEC_ZERO);
+}
+
+void sdl_draw_body(body_t *body, double alpha) {
+  // the body is drawn 1 - alpha of its last tick's motion back
+  double back = 1 - alpha;
+  vector_t centroid = body_get_centroid(body);
+  vector_t offset = vec_multiply(
+      -back, vec_subtract(centroid, body_get_previous_centroid(body)));
+  double angle =
+      -back * (body_get_rotation(body) - body_get_previous_rotation(body));
+  draw_polygon_moved(body_get_polygon(body), *body_get_color(body), offset,
+                     angle, centroid);
+}
+
 void sdl_show(void) {
   // Draw boundary lines
   vector_t window_center = get_window_center();
@@ -238,12 +280,9 @@ void sdl_show(void) {
 void sdl_render_scene(scene_t *scene, void *aux) {
   sdl_clear();
   size_t body_count = scene_bodies(scene);
+  double alpha = scene_get_interpolation_alpha(scene);
   for (size_t i = 0; i < body_count; i++) {
-    body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    polygon_t *poly = polygon_init(shape, (vector_t){0, 0}, 0, 0, 0, 0);
-    sdl_draw_polygon(poly, *body_get_color(body));
-    list_free(shape);
+    sdl_draw_body(scene_get_body(scene, i), alpha);
   }
   if (aux != NULL) {
     body_t *body = aux;
@@ -317,20 +356,13 @@ void sdl_render_text(const char *message, TTF_Font *font, const vector_t loc,
 }
 
 SDL_Rect sdl_get_bounding_box(body_t *body) {
-  vector_t min_vec = (vector_t){.x = __DBL_MAX__, .y = __DBL_MAX__};
-  vector_t max_vec = (vector_t){.x = -__DBL_MAX__, .y = -__DBL_MAX__};
-
-  list_t *vertices = body_get_shape(body);
-  for (size_t i = 0; i < list_size(vertices); i++) {
-    vector_t *vertex = list_get(vertices, i);
-    vector_t pixel = get_window_position(*vertex, get_window_center());
-    min_vec.x = fmin(min_vec.x, pixel.x);
-    min_vec.y = fmin(min_vec.y, pixel.y);
-    max_vec.x = fmax(max_vec.x, pixel.x);
-    max_vec.y = fmax(max_vec.y, pixel.y);
-  }
-
-  
+  // the y axis flips on screen, so the box's corners swap vertically
+  aabb_t box = body_get_aabb(body);
+  vector_t window_center = get_window_center();
+  vector_t min_vec = get_window_position(
+      (vector_t){.x = box.min.x, .y = box.max.y}, window_center);
+  vector_t max_vec = get_window_position(
+      (vector_t){.x = box.max.x, .y = box.min.y}, window_center);
 
   SDL_Rect rect = (SDL_Rect){.x = min_vec.x, .y = min_vec.y, 
                              .w = max_vec.x - min_vec.x, .h = max_vec.y - min_vec.y};
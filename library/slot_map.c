@@ -0,0 +1,118 @@
+#include "slot_map.h"
+#include <assert.h>
+#include <stdlib.h>
+
+const size_t MIN_SLOT_MAP_CAPACITY = 4;
+const size_t SLOT_MAP_NO_SLOT = SIZE_MAX;
+
+typedef struct slot {
+  // even while the slot holds an element and odd while it is free, so a
+  // handle to a removed element never matches again
+  uint32_t generation;
+  // the element's position, or the next free slot while the slot is free
+  size_t position;
+} slot_t;
+
+struct slot_map {
+  slot_t *slots;
+  size_t num_slots;
+  size_t slot_capacity;
+  // the slot of the element at each position
+  uint32_t *slot_of;
+  size_t size;
+  size_t capacity;
+  size_t free_slot;
+};
+
+slot_map_t *slot_map_init(size_t initial_capacity) {
+  slot_map_t *map = malloc(sizeof(slot_map_t));
+  assert(map);
+  size_t capacity = initial_capacity < MIN_SLOT_MAP_CAPACITY
+                        ? MIN_SLOT_MAP_CAPACITY
+                        : initial_capacity;
+  map->slots = malloc(sizeof(slot_t) * capacity);
+  map->slot_of = malloc(sizeof(uint32_t) * capacity);
+  assert(map->slots && map->slot_of);
+  map->num_slots = 0;
+  map->slot_capacity = capacity;
+  map->size = 0;
+  map->capacity = capacity;
+  map->free_slot = SLOT_MAP_NO_SLOT;
+  return map;
+}
+
+void slot_map_free(slot_map_t *map) {
+  free(map->slots);
+  free(map->slot_of);
+  free(map);
+}
+
+size_t slot_map_size(slot_map_t *map) { return map->size; }
+
+/**
+ * Takes a slot off the free list, or makes a new one if none is free.
+ */
+static size_t take_slot(slot_map_t *map) {
+  size_t index = map->free_slot;
+  if (index != SLOT_MAP_NO_SLOT) {
+    slot_t *slot = &map->slots[index];
+    map->free_slot = slot->position;
+    slot->generation++;
+    return index;
+  }
+  if (map->num_slots == map->slot_capacity) {
+    map->slot_capacity *= 2;
+    map->slots = realloc(map->slots, sizeof(slot_t) * map->slot_capacity);
+    assert(map->slots);
+  }
+  assert(map->num_slots < UINT32_MAX);
+  index = map->num_slots++;
+  map->slots[index].generation = 0;
+  return index;
+}
+
+slot_handle_t slot_map_add(slot_map_t *map) {
+  if (map->size == map->capacity) {
+    map->capacity *= 2;
+    map->slot_of = realloc(map->slot_of, sizeof(uint32_t) * map->capacity);
+    assert(map->slot_of);
+  }
+  size_t index = take_slot(map);
+  map->slots[index].position = map->size;
+  map->slot_of[map->size++] = index;
+  return (slot_handle_t){.index = index,
+                         .generation = map->slots[index].generation};
+}
+
+bool slot_map_find(slot_map_t *map, slot_handle_t handle, size_t *position) {
+  if (handle.index >= map->num_slots) {
+    return false;
+  }
+  slot_t *slot = &map->slots[handle.index];
+  // only live slots have even generations
+  if (slot->generation != handle.generation || slot->generation % 2) {
+    return false;
+  }
+  *position = slot->position;
+  return true;
+}
+
+slot_handle_t slot_map_get_handle(slot_map_t *map, size_t position) {
+  assert(position < map->size);
+  uint32_t index = map->slot_of[position];
+  return (slot_handle_t){.index = index,
+                         .generation = map->slots[index].generation};
+}
+
+void slot_map_swap_remove(slot_map_t *map, size_t position) {
+  assert(position < map->size);
+  uint32_t index = map->slot_of[position];
+  uint32_t last = map->slot_of[--map->size];
+  map->slot_of[position] = last;
+  map->slots[last].position = position;
+
+  slot_t *slot = &map->slots[index];
+  slot->generation++;
+  slot->position = map->free_slot;
+  map->free_slot = index;
+}
@@ -0,0 +1,467 @@
+#include "spatial_hash.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t GUESS_NUM_PROXIES = 16;
+// proxies covering more cells than this skip the grid and are tested against
+// every other proxy instead, so one huge body cannot flood the table
+const double MAX_CELLS_PER_PROXY = 64;
+// cell coordinates are clamped to this range before converting to integers
+const double MAX_CELL_COORD = 1e15;
+
+typedef struct proxy {
+  void *data;
+  aabb_t box;
+  int64_t min_x;
+  int64_t min_y;
+  int64_t max_x;
+  int64_t max_y;
+  bool oversized;
+} proxy_t;
+
+typedef struct cell_entry {
+  int64_t x;
+  int64_t y;
+  size_t proxy;
+} cell_entry_t;
+
+struct spatial_hash {
+  double cell_size;
+
+  proxy_t *proxies;
+  size_t num_proxies;
+  size_t proxy_capacity;
+
+  // indices of the proxies too large to bucket
+  size_t *oversized;
+  size_t num_oversized;
+  size_t oversized_capacity;
+
+  // cell entries grouped by bucket; bucket i occupies
+  // entries[bucket_start[i]] up to entries[bucket_start[i + 1]]
+  cell_entry_t *entries;
+  size_t num_entries;
+  size_t entry_capacity;
+  size_t *bucket_start;
+  size_t num_buckets;
+  size_t bucket_capacity;
+  // scratch space for the counting sort into buckets
+  cell_entry_t *scratch;
+  size_t scratch_capacity;
+
+  // whether the buckets reflect the current set of proxies
+  bool built;
+
+  // a box containing every proxy, which rays are clipped to
+  aabb_t bounds;
+  // the query each proxy was last reported to, so proxies spanning several
+  // cells are only reported once per query
+  size_t *stamps;
+  size_t stamp_capacity;
+  size_t stamp;
+};
+
+/**
+ * Grows an array to hold at least `needed` elements, doubling its capacity.
+ */
+static void *ensure_capacity(void *array, size_t *capacity, size_t needed,
+                             size_t elem_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  size_t new_capacity = *capacity > 0 ? *capacity : GUESS_NUM_PROXIES;
+  while (new_capacity < needed) {
+    new_capacity *= 2;
+  }
+  array = realloc(array, new_capacity * elem_size);
+  assert(array);
+  *capacity = new_capacity;
+  return array;
+}
+
+spatial_hash_t *spatial_hash_init(double cell_size) {
+  assert(cell_size > 0);
+  spatial_hash_t *grid = malloc(sizeof(spatial_hash_t));
+  assert(grid);
+
+  grid->cell_size = cell_size;
+  grid->proxies = NULL;
+  grid->num_proxies = 0;
+  grid->proxy_capacity = 0;
+  grid->oversized = NULL;
+  grid->num_oversized = 0;
+  grid->oversized_capacity = 0;
+  grid->entries = NULL;
+  grid->num_entries = 0;
+  grid->entry_capacity = 0;
+  grid->bucket_start = NULL;
+  grid->num_buckets = 0;
+  grid->bucket_capacity = 0;
+  grid->scratch = NULL;
+  grid->scratch_capacity = 0;
+  grid->built = true;
+  grid->stamps = NULL;
+  grid->stamp_capacity = 0;
+  grid->stamp = 0;
+  return grid;
+}
+
+void spatial_hash_free(spatial_hash_t *grid) {
+  free(grid->proxies);
+  free(grid->oversized);
+  free(grid->entries);
+  free(grid->bucket_start);
+  free(grid->scratch);
+  free(grid->stamps);
+  free(grid);
+}
+
+double spatial_hash_get_cell_size(spatial_hash_t *grid) {
+  return grid->cell_size;
+}
+
+void spatial_hash_set_cell_size(spatial_hash_t *grid, double cell_size) {
+  assert(cell_size > 0);
+  grid->cell_size = cell_size;
+  spatial_hash_clear(grid);
+}
+
+void spatial_hash_clear(spatial_hash_t *grid) {
+  grid->num_proxies = 0;
+  grid->num_oversized = 0;
+  grid->num_entries = 0;
+  grid->num_buckets = 0;
+  grid->built = true;
+}
+
+/**
+ * Returns the coordinate of the cell containing a scene coordinate.
+ */
+static int64_t cell_coord(spatial_hash_t *grid, double x) {
+  double cell = floor(x / grid->cell_size);
+  return (int64_t)fmax(-MAX_CELL_COORD, fmin(MAX_CELL_COORD, cell));
+}
+
+static size_t hash_cell(int64_t x, int64_t y, size_t num_buckets) {
+  uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ULL ^
+               (uint64_t)y * 0xC2B2AE3D27D4EB4FULL;
+  h ^= h >> 32;
+  return (size_t)h & (num_buckets - 1);
+}
+
+void spatial_hash_insert(spatial_hash_t *grid, void *data, aabb_t box) {
+  grid->proxies = ensure_capacity(grid->proxies, &grid->proxy_capacity,
+                                  grid->num_proxies + 1, sizeof(proxy_t));
+  proxy_t *proxy = &grid->proxies[grid->num_proxies];
+  proxy->data = data;
+  proxy->box = box;
+  proxy->min_x = cell_coord(grid, box.min.x);
+  proxy->min_y = cell_coord(grid, box.min.y);
+  proxy->max_x = cell_coord(grid, box.max.x);
+  proxy->max_y = cell_coord(grid, box.max.y);
+
+  double cells = ((double)proxy->max_x - proxy->min_x + 1) *
+                 ((double)proxy->max_y - proxy->min_y + 1);
+  proxy->oversized = !(cells <= MAX_CELLS_PER_PROXY);
+  if (proxy->oversized) {
+    grid->oversized =
+        ensure_capacity(grid->oversized, &grid->oversized_capacity,
+                        grid->num_oversized + 1, sizeof(size_t));
+    grid->oversized[grid->num_oversized++] = grid->num_proxies;
+  } else {
+    grid->num_entries += (size_t)cells;
+  }
+
+  grid->bounds =
+      grid->num_proxies == 0 ? box : aabb_union(grid->bounds, box);
+  grid->num_proxies++;
+  grid->built = false;
+}
+
+/**
+ * Buckets every cell entry by the hash of its cell with a counting sort,
+ * so each bucket is a contiguous run of the entries array.
+ */
+static void build(spatial_hash_t *grid) {
+  size_t num_buckets = 1;
+  while (num_buckets < 2 * grid->num_entries) {
+    num_buckets *= 2;
+  }
+  grid->num_buckets = num_buckets;
+  grid->bucket_start =
+      ensure_capacity(grid->bucket_start, &grid->bucket_capacity,
+                      num_buckets + 1, sizeof(size_t));
+  grid->entries = ensure_capacity(grid->entries, &grid->entry_capacity,
+                                  grid->num_entries, sizeof(cell_entry_t));
+  grid->scratch = ensure_capacity(grid->scratch, &grid->scratch_capacity,
+                                  grid->num_entries, sizeof(cell_entry_t));
+
+  size_t *start = grid->bucket_start;
+  for (size_t i = 0; i <= num_buckets; i++) {
+    start[i] = 0;
+  }
+
+  // list every (cell, proxy) entry and count the entries in each bucket
+  size_t n = 0;
+  for (size_t p = 0; p < grid->num_proxies; p++) {
+    proxy_t *proxy = &grid->proxies[p];
+    if (proxy->oversized) {
+      continue;
+    }
+    for (int64_t x = proxy->min_x; x <= proxy->max_x; x++) {
+      for (int64_t y = proxy->min_y; y <= proxy->max_y; y++) {
+        grid->scratch[n++] = (cell_entry_t){.x = x, .y = y, .proxy = p};
+        start[hash_cell(x, y, num_buckets) + 1]++;
+      }
+    }
+  }
+  for (size_t i = 0; i < num_buckets; i++) {
+    start[i + 1] += start[i];
+  }
+
+  // scatter the entries into place, using start[] as a cursor per bucket and
+  // then shifting it back to the bucket boundaries
+  for (size_t i = 0; i < n; i++) {
+    cell_entry_t entry = grid->scratch[i];
+    grid->entries[start[hash_cell(entry.x, entry.y, num_buckets)]++] = entry;
+  }
+  for (size_t i = num_buckets; i > 0; i--) {
+    start[i] = start[i - 1];
+  }
+  start[0] = 0;
+
+  grid->built = true;
+}
+
+void spatial_hash_query_pairs(spatial_hash_t *grid, pair_handler_t handler,
+                              void *aux) {
+  if (!grid->built) {
+    build(grid);
+  }
+
+  for (size_t bucket = 0; bucket < grid->num_buckets; bucket++) {
+    size_t end = grid->bucket_start[bucket + 1];
+    for (size_t i = grid->bucket_start[bucket]; i < end; i++) {
+      cell_entry_t *e1 = &grid->entries[i];
+      proxy_t *p1 = &grid->proxies[e1->proxy];
+      for (size_t j = i + 1; j < end; j++) {
+        cell_entry_t *e2 = &grid->entries[j];
+        // different cells can hash to the same bucket
+        if (e1->x != e2->x || e1->y != e2->y) {
+          continue;
+        }
+        proxy_t *p2 = &grid->proxies[e2->proxy];
+        if (!aabb_overlap(p1->box, p2->box)) {
+          continue;
+        }
+        // two proxies may share many cells; only report the pair from the
+        // cell containing the lower-left corner of their intersection
+        if (cell_coord(grid, fmax(p1->box.min.x, p2->box.min.x)) != e1->x ||
+            cell_coord(grid, fmax(p1->box.min.y, p2->box.min.y)) != e1->y) {
+          continue;
+        }
+        handler(p1->data, p2->data, aux);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < grid->num_oversized; i++) {
+    size_t o = grid->oversized[i];
+    proxy_t *big = &grid->proxies[o];
+    for (size_t p = 0; p < grid->num_proxies; p++) {
+      proxy_t *other = &grid->proxies[p];
+      // pairs of oversized proxies are reported by the lower index only
+      if (p == o || (other->oversized && p < o)) {
+        continue;
+      }
+      if (aabb_overlap(big->box, other->box)) {
+        handler(big->data, other->data, aux);
+      }
+    }
+  }
+}
+
+/**
+ * Builds the buckets if needed and starts a new query, so each proxy can be
+ * reported to it once.
+ */
+static void begin_query(spatial_hash_t *grid) {
+  if (!grid->built) {
+    build(grid);
+  }
+  size_t old_capacity = grid->stamp_capacity;
+  grid->stamps = ensure_capacity(grid->stamps, &grid->stamp_capacity,
+                                 grid->num_proxies, sizeof(size_t));
+  for (size_t i = old_capacity; i < grid->stamp_capacity; i++) {
+    grid->stamps[i] = 0;
+  }
+  grid->stamp++;
+}
+
+void spatial_hash_query(spatial_hash_t *grid, aabb_t box,
+                        proxy_handler_t handler, void *aux) {
+  if (grid->num_proxies == 0) {
+    return;
+  }
+  begin_query(grid);
+  for (size_t i = 0; i < grid->num_oversized; i++) {
+    proxy_t *proxy = &grid->proxies[grid->oversized[i]];
+    if (aabb_overlap(proxy->box, box)) {
+      handler(proxy->data, aux);
+    }
+  }
+  if (grid->num_entries == 0 || !aabb_overlap(grid->bounds, box)) {
+    return;
+  }
+
+  // only the cells that some proxy covers need to be looked up
+  int64_t min_x = cell_coord(grid, fmax(box.min.x, grid->bounds.min.x));
+  int64_t max_x = cell_coord(grid, fmin(box.max.x, grid->bounds.max.x));
+  int64_t min_y = cell_coord(grid, fmax(box.min.y, grid->bounds.min.y));
+  int64_t max_y = cell_coord(grid, fmin(box.max.y, grid->bounds.max.y));
+  for (int64_t x = min_x; x <= max_x; x++) {
+    for (int64_t y = min_y; y <= max_y; y++) {
+      size_t bucket = hash_cell(x, y, grid->num_buckets);
+      size_t end = grid->bucket_start[bucket + 1];
+      for (size_t i = grid->bucket_start[bucket]; i < end; i++) {
+        cell_entry_t *entry = &grid->entries[i];
+        proxy_t *proxy = &grid->proxies[entry->proxy];
+        if (entry->x != x || entry->y != y ||
+            grid->stamps[entry->proxy] == grid->stamp ||
+            !aabb_overlap(proxy->box, box)) {
+          continue;
+        }
+        grid->stamps[entry->proxy] = grid->stamp;
+        handler(proxy->data, aux);
+      }
+    }
+  }
+}
+
+typedef struct ray_query {
+  vector_t origin;
+  vector_t delta;
+  double radius;
+  ray_handler_t handler;
+  void *aux;
+  // the fraction of delta beyond which proxies are no longer reported
+  double max_fraction;
+} ray_query_t;
+
+/**
+ * Reports a proxy to a ray query, unless it has been reported already or
+ * the ray only reaches it beyond the query's current fraction.
+ */
+static void report_ray_proxy(spatial_hash_t *grid, ray_query_t *query,
+                             size_t index) {
+  if (grid->stamps[index] == grid->stamp) {
+    return;
+  }
+  grid->stamps[index] = grid->stamp;
+  proxy_t *proxy = &grid->proxies[index];
+  aabb_t box = aabb_fatten(proxy->box, query->radius);
+  if (aabb_ray_fraction(box, query->origin, query->delta) <=
+      query->max_fraction) {
+    query->max_fraction =
+        fmin(query->max_fraction, query->handler(proxy->data, query->aux));
+  }
+}
+
+/**
+ * Reports the proxies with an entry in a cell to a ray query.
+ */
+static void report_ray_cell(spatial_hash_t *grid, ray_query_t *query,
+                            int64_t x, int64_t y) {
+  size_t bucket = hash_cell(x, y, grid->num_buckets);
+  size_t end = grid->bucket_start[bucket + 1];
+  for (size_t i = grid->bucket_start[bucket]; i < end; i++) {
+    cell_entry_t *entry = &grid->entries[i];
+    if (entry->x == x && entry->y == y) {
+      report_ray_proxy(grid, query, entry->proxy);
+    }
+  }
+}
+
+/**
+ * Returns the step a ray takes between cells along one axis, and sets
+ * *next to the fraction of delta at which it first crosses into the next
+ * cell and *step to the fraction between crossings.
+ */
+static int64_t ray_cell_step(spatial_hash_t *grid, double origin, double delta,
+                             int64_t cell, double *next, double *step) {
+  if (delta == 0) {
+    *next = INFINITY;
+    *step = INFINITY;
+    return 0;
+  }
+  int64_t direction = delta > 0 ? 1 : -1;
+  double boundary = (cell + (direction > 0)) * grid->cell_size;
+  *next = (boundary - origin) / delta;
+  *step = grid->cell_size / fabs(delta);
+  return direction;
+}
+
+void spatial_hash_raycast(spatial_hash_t *grid, vector_t origin,
+                          vector_t delta, double radius, ray_handler_t handler,
+                          void *aux) {
+  if (grid->num_proxies == 0) {
+    return;
+  }
+  begin_query(grid);
+
+  ray_query_t query = {.origin = origin,
+                       .delta = delta,
+                       .radius = radius,
+                       .handler = handler,
+                       .aux = aux,
+                       .max_fraction = 1};
+  for (size_t i = 0; i < grid->num_oversized; i++) {
+    report_ray_proxy(grid, &query, grid->oversized[i]);
+  }
+  if (grid->num_entries == 0) {
+    return;
+  }
+
+  // only walk the part of the ray that passes near some proxy
+  aabb_t bounds = aabb_fatten(grid->bounds, radius);
+  double start = aabb_ray_fraction(bounds, origin, delta);
+  if (start > query.max_fraction) {
+    return;
+  }
+  vector_t start_point = vec_add(origin, vec_multiply(start, delta));
+  int64_t x = cell_coord(grid, start_point.x);
+  int64_t y = cell_coord(grid, start_point.y);
+  double next_x, next_y, step_x, step_y;
+  int64_t direction_x =
+      ray_cell_step(grid, origin.x, delta.x, x, &next_x, &step_x);
+  int64_t direction_y =
+      ray_cell_step(grid, origin.y, delta.y, y, &next_y, &step_y);
+  // a proxy within the radius of the ray has an entry within this many
+  // cells of a cell the ray passes through
+  int64_t reach = (int64_t)ceil(radius / grid->cell_size);
+  int64_t min_x = cell_coord(grid, bounds.min.x) - reach;
+  int64_t max_x = cell_coord(grid, bounds.max.x) + reach;
+  int64_t min_y = cell_coord(grid, bounds.min.y) - reach;
+  int64_t max_y = cell_coord(grid, bounds.max.y) + reach;
+
+  while (x >= min_x && x <= max_x && y >= min_y && y <= max_y) {
+    for (int64_t dx = -reach; dx <= reach; dx++) {
+      for (int64_t dy = -reach; dy <= reach; dy++) {
+        report_ray_cell(grid, &query, x + dx, y + dy);
+      }
+    }
+    // stop once the next cell starts beyond the end of the ray
+    if (fmin(next_x, next_y) > query.max_fraction) {
+      return;
+    }
+    if (next_x < next_y) {
+      x += direction_x;
+      next_x += step_x;
+    } else {
+      y += direction_y;
+      next_y += step_y;
+    }
+  }
+}
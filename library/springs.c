@@ -0,0 +1,455 @@
+#include "springs.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t GUESS_NUM_NETWORK_BODIES = 16;
+const size_t GUESS_NUM_NETWORK_SPRINGS = 16;
+// the implicit solver stops once its residual shrinks by this factor
+const double SPRING_SOLVER_TOLERANCE = 1e-10;
+
+struct spring_network {
+  body_t **bodies;
+  size_t num_bodies;
+  size_t body_capacity;
+  // each body's centroid, velocity and net spring force, gathered from the
+  // bodies each time the springs are evaluated
+  vector_t *positions;
+  vector_t *velocities;
+  vector_t *forces;
+  // the springs, with firsts[i] <= ends[i]; once sorted, the springs from
+  // body b are offsets[b] up to offsets[b + 1]
+  size_t *firsts;
+  size_t *ends;
+  double *stiffness;
+  double *rest_lengths;
+  double *damping;
+  size_t num_springs;
+  size_t spring_capacity;
+  size_t *offsets;
+  bool sorted;
+  // where each spring moves when sorting, and room to move an array into
+  size_t *destinations;
+  void *scratch;
+  double drag;
+  // the implicit solver's vectors over the bodies and each spring's 2x2
+  // symmetric block (xx, xy, yy) of the system matrix, allocated on first use
+  double *masses;
+  vector_t *solution;
+  vector_t *residual;
+  vector_t *preconditioner;
+  vector_t *search;
+  vector_t *product;
+  size_t solver_bodies;
+  double *blocks;
+  size_t solver_springs;
+};
+
+spring_network_t *spring_network_init(void) {
+  spring_network_t *network = malloc(sizeof(spring_network_t));
+  assert(network);
+  network->num_bodies = 0;
+  network->body_capacity = GUESS_NUM_NETWORK_BODIES;
+  network->bodies = malloc(sizeof(body_t *) * network->body_capacity);
+  network->positions = malloc(sizeof(vector_t) * network->body_capacity);
+  network->velocities = malloc(sizeof(vector_t) * network->body_capacity);
+  network->forces = malloc(sizeof(vector_t) * network->body_capacity);
+  network->offsets = malloc(sizeof(size_t) * (network->body_capacity + 1));
+  assert(network->bodies && network->positions && network->velocities &&
+         network->forces && network->offsets);
+  network->num_springs = 0;
+  network->spring_capacity = GUESS_NUM_NETWORK_SPRINGS;
+  size_t capacity = network->spring_capacity;
+  network->firsts = malloc(sizeof(size_t) * capacity);
+  network->ends = malloc(sizeof(size_t) * capacity);
+  network->stiffness = malloc(sizeof(double) * capacity);
+  network->rest_lengths = malloc(sizeof(double) * capacity);
+  network->damping = malloc(sizeof(double) * capacity);
+  network->destinations = malloc(sizeof(size_t) * capacity);
+  network->scratch = malloc(sizeof(double) * capacity);
+  assert(network->firsts && network->ends && network->stiffness &&
+         network->rest_lengths && network->damping && network->destinations &&
+         network->scratch);
+  network->sorted = false;
+  network->drag = 0;
+  network->masses = NULL;
+  network->solution = NULL;
+  network->residual = NULL;
+  network->preconditioner = NULL;
+  network->search = NULL;
+  network->product = NULL;
+  network->solver_bodies = 0;
+  network->blocks = NULL;
+  network->solver_springs = 0;
+  return network;
+}
+
+void spring_network_free(spring_network_t *network) {
+  free(network->bodies);
+  free(network->positions);
+  free(network->velocities);
+  free(network->forces);
+  free(network->offsets);
+  free(network->firsts);
+  free(network->ends);
+  free(network->stiffness);
+  free(network->rest_lengths);
+  free(network->damping);
+  free(network->destinations);
+  free(network->scratch);
+  free(network->masses);
+  free(network->solution);
+  free(network->residual);
+  free(network->preconditioner);
+  free(network->search);
+  free(network->product);
+  free(network->blocks);
+  free(network);
+}
+
+size_t spring_network_add_body(spring_network_t *network, body_t *body) {
+  if (network->num_bodies == network->body_capacity) {
+    network->body_capacity *= 2;
+    size_t capacity = network->body_capacity;
+    network->bodies = realloc(network->bodies, sizeof(body_t *) * capacity);
+    network->positions =
+        realloc(network->positions, sizeof(vector_t) * capacity);
+    network->velocities =
+        realloc(network->velocities, sizeof(vector_t) * capacity);
+    network->forces = realloc(network->forces, sizeof(vector_t) * capacity);
+    network->offsets =
+        realloc(network->offsets, sizeof(size_t) * (capacity + 1));
+    assert(network->bodies && network->positions && network->velocities &&
+           network->forces && network->offsets);
+  }
+  network->bodies[network->num_bodies] = body;
+  network->sorted = false;
+  return network->num_bodies++;
+}
+
+void spring_network_add_spring(spring_network_t *network, size_t body1,
+                               size_t body2, double stiffness,
+                               double rest_length, double damping) {
+  assert(body1 < network->num_bodies && body2 < network->num_bodies);
+  assert(body1 != body2);
+  if (network->num_springs == network->spring_capacity) {
+    network->spring_capacity *= 2;
+    size_t capacity = network->spring_capacity;
+    network->firsts = realloc(network->firsts, sizeof(size_t) * capacity);
+    network->ends = realloc(network->ends, sizeof(size_t) * capacity);
+    network->stiffness =
+        realloc(network->stiffness, sizeof(double) * capacity);
+    network->rest_lengths =
+        realloc(network->rest_lengths, sizeof(double) * capacity);
+    network->damping = realloc(network->damping, sizeof(double) * capacity);
+    network->destinations =
+        realloc(network->destinations, sizeof(size_t) * capacity);
+    network->scratch = realloc(network->scratch, sizeof(double) * capacity);
+    assert(network->firsts && network->ends && network->stiffness &&
+           network->rest_lengths && network->damping &&
+           network->destinations && network->scratch);
+  }
+  size_t spring = network->num_springs++;
+  network->firsts[spring] = body1 < body2 ? body1 : body2;
+  network->ends[spring] = body1 < body2 ? body2 : body1;
+  network->stiffness[spring] = stiffness;
+  network->rest_lengths[spring] = rest_length;
+  network->damping[spring] = damping;
+  network->sorted = false;
+}
+
+void spring_network_set_drag(spring_network_t *network, double gamma) {
+  network->drag = gamma;
+}
+
+size_t spring_network_bodies(spring_network_t *network) {
+  return network->num_bodies;
+}
+
+body_t *spring_network_get_body(spring_network_t *network, size_t index) {
+  assert(index < network->num_bodies);
+  return network->bodies[index];
+}
+
+size_t spring_network_springs(spring_network_t *network) {
+  return network->num_springs;
+}
+
+/**
+ * Moves each element of an array of springs' values to its destination.
+ */
+static void permute(spring_network_t *network, void *array, size_t size) {
+  char *from = array, *to = network->scratch;
+  for (size_t i = 0; i < network->num_springs; i++) {
+    memcpy(to + network->destinations[i] * size, from + i * size, size);
+  }
+  memcpy(array, network->scratch, network->num_springs * size);
+}
+
+/**
+ * Counting sorts the springs by their first body and fills in the offsets.
+ */
+static void sort_springs(spring_network_t *network) {
+  size_t *offsets = network->offsets;
+  memset(offsets, 0, sizeof(size_t) * (network->num_bodies + 1));
+  for (size_t i = 0; i < network->num_springs; i++) {
+    offsets[network->firsts[i] + 1]++;
+  }
+  for (size_t b = 0; b < network->num_bodies; b++) {
+    offsets[b + 1] += offsets[b];
+  }
+  // place each spring after the ones before it from the same body, then
+  // shift the offsets back to where each body's springs start
+  for (size_t i = 0; i < network->num_springs; i++) {
+    network->destinations[i] = offsets[network->firsts[i]]++;
+  }
+  for (size_t b = network->num_bodies; b > 0; b--) {
+    offsets[b] = offsets[b - 1];
+  }
+  offsets[0] = 0;
+
+  permute(network, network->firsts, sizeof(size_t));
+  permute(network, network->ends, sizeof(size_t));
+  permute(network, network->stiffness, sizeof(double));
+  permute(network, network->rest_lengths, sizeof(double));
+  permute(network, network->damping, sizeof(double));
+  network->sorted = true;
+}
+
+/**
+ * Gathers the bodies' positions and velocities, and sums up the spring and
+ * drag forces on each body.
+ */
+static void evaluate_forces(spring_network_t *network) {
+  if (!network->sorted) {
+    sort_springs(network);
+  }
+  for (size_t b = 0; b < network->num_bodies; b++) {
+    network->positions[b] = body_get_centroid(network->bodies[b]);
+    network->velocities[b] = body_get_velocity(network->bodies[b]);
+    network->forces[b] = vec_multiply(-network->drag, network->velocities[b]);
+  }
+
+  vector_t *positions = network->positions, *velocities = network->velocities;
+  vector_t *forces = network->forces;
+  for (size_t i = 0; i < network->num_springs; i++) {
+    size_t first = network->firsts[i], end = network->ends[i];
+    double dx = positions[end].x - positions[first].x;
+    double dy = positions[end].y - positions[first].y;
+    double length = sqrt(dx * dx + dy * dy);
+    // the force per unit of displacement, so a zero rest length needs no
+    // direction
+    double scale = network->stiffness[i];
+    if (network->rest_lengths[i] != 0) {
+      scale = length > 0
+                  ? scale * (length - network->rest_lengths[i]) / length
+                  : 0;
+    }
+    if (network->damping[i] != 0 && length > 0) {
+      double dvx = velocities[end].x - velocities[first].x;
+      double dvy = velocities[end].y - velocities[first].y;
+      scale += network->damping[i] * (dvx * dx + dvy * dy) / (length * length);
+    }
+    forces[first].x += scale * dx;
+    forces[first].y += scale * dy;
+    forces[end].x -= scale * dx;
+    forces[end].y -= scale * dy;
+  }
+}
+
+void spring_network_apply(spring_network_t *network) {
+  evaluate_forces(network);
+  for (size_t b = 0; b < network->num_bodies; b++) {
+    body_add_force(network->bodies[b], network->forces[b]);
+  }
+}
+
+/**
+ * Grows the implicit solver's arrays to fit the network.
+ */
+static void reserve_solver(spring_network_t *network) {
+  if (network->solver_bodies < network->num_bodies) {
+    size_t n = network->solver_bodies = network->body_capacity;
+    network->masses = realloc(network->masses, sizeof(double) * n);
+    network->solution = realloc(network->solution, sizeof(vector_t) * n);
+    network->residual = realloc(network->residual, sizeof(vector_t) * n);
+    network->preconditioner =
+        realloc(network->preconditioner, sizeof(vector_t) * n);
+    network->search = realloc(network->search, sizeof(vector_t) * n);
+    network->product = realloc(network->product, sizeof(vector_t) * n);
+    assert(network->masses && network->solution && network->residual &&
+           network->preconditioner && network->search && network->product);
+  }
+  if (network->solver_springs < network->num_springs) {
+    network->solver_springs = network->spring_capacity;
+    network->blocks =
+        realloc(network->blocks, sizeof(double) * 3 * network->solver_springs);
+    assert(network->blocks);
+  }
+}
+
+/**
+ * Computes each spring's stiffness matrix (the derivative of the force on
+ * its first body with respect to its second body's position), returning the
+ * matrices' product with the bodies' velocities in network->product, and
+ * stores dt times the damping matrix plus dt^2 times the stiffness matrix as
+ * the spring's block of the system matrix.
+ */
+static void linearize_springs(spring_network_t *network, double dt) {
+  vector_t *positions = network->positions, *velocities = network->velocities;
+  vector_t *stiff_velocities = network->product;
+  for (size_t b = 0; b < network->num_bodies; b++) {
+    stiff_velocities[b] = VEC_ZERO;
+  }
+  for (size_t i = 0; i < network->num_springs; i++) {
+    size_t first = network->firsts[i], end = network->ends[i];
+    double k = network->stiffness[i];
+    double dx = positions[end].x - positions[first].x;
+    double dy = positions[end].y - positions[first].y;
+    double length = sqrt(dx * dx + dy * dy);
+    // k (n n^T + s (I - n n^T)) for the unit direction n, where s is the
+    // spring's stretch relative to its length, clamped so compressed springs
+    // keep the system positive definite
+    double kxx = k, kxy = 0, kyy = k, cxx = 0, cxy = 0, cyy = 0;
+    if (length > 0) {
+      double nx = dx / length, ny = dy / length;
+      double s = fmax(0, 1 - network->rest_lengths[i] / length);
+      kxx = k * (nx * nx + s * (1 - nx * nx));
+      kxy = k * (nx * ny - s * nx * ny);
+      kyy = k * (ny * ny + s * (1 - ny * ny));
+      double c = network->damping[i];
+      cxx = c * nx * nx;
+      cxy = c * nx * ny;
+      cyy = c * ny * ny;
+    }
+    double dvx = velocities[end].x - velocities[first].x;
+    double dvy = velocities[end].y - velocities[first].y;
+    vector_t stiff_velocity = {kxx * dvx + kxy * dvy, kxy * dvx + kyy * dvy};
+    stiff_velocities[first] = vec_add(stiff_velocities[first], stiff_velocity);
+    stiff_velocities[end] = vec_subtract(stiff_velocities[end], stiff_velocity);
+
+    double *block = &network->blocks[3 * i];
+    block[0] = dt * cxx + dt * dt * kxx;
+    block[1] = dt * cxy + dt * dt * kxy;
+    block[2] = dt * cyy + dt * dt * kyy;
+  }
+}
+
+/**
+ * Multiplies the system matrix, M + dt * drag - dt * D - dt^2 * K, by the
+ * search direction, leaving bodies with infinite mass fixed.
+ */
+static void multiply_system(spring_network_t *network, double dt) {
+  vector_t *search = network->search, *product = network->product;
+  for (size_t b = 0; b < network->num_bodies; b++) {
+    product[b] = isinf(network->masses[b])
+                     ? VEC_ZERO
+                     : vec_multiply(network->masses[b] + dt * network->drag,
+                                    search[b]);
+  }
+  for (size_t i = 0; i < network->num_springs; i++) {
+    size_t first = network->firsts[i], end = network->ends[i];
+    double *block = &network->blocks[3 * i];
+    double dx = search[first].x - search[end].x;
+    double dy = search[first].y - search[end].y;
+    product[first].x += block[0] * dx + block[1] * dy;
+    product[first].y += block[1] * dx + block[2] * dy;
+    product[end].x -= block[0] * dx + block[1] * dy;
+    product[end].y -= block[1] * dx + block[2] * dy;
+  }
+  for (size_t b = 0; b < network->num_bodies; b++) {
+    if (isinf(network->masses[b])) {
+      product[b] = VEC_ZERO;
+    }
+  }
+}
+
+/**
+ * Sums the dot products of two vectors over the bodies.
+ */
+static double dot_all(vector_t *v1, vector_t *v2, size_t n) {
+  double dot = 0;
+  for (size_t b = 0; b < n; b++) {
+    dot += v1[b].x * v2[b].x + v1[b].y * v2[b].y;
+  }
+  return dot;
+}
+
+void spring_network_solve_implicit(spring_network_t *network, double dt) {
+  evaluate_forces(network);
+  reserve_solver(network);
+  linearize_springs(network, dt);
+  size_t n = network->num_bodies;
+  vector_t *solution = network->solution, *residual = network->residual;
+  vector_t *preconditioner = network->preconditioner;
+  vector_t *search = network->search, *product = network->product;
+
+  // the right-hand side, dt * f + dt^2 * K v, starts off as the residual of
+  // a zero change in velocity; the diagonal of the system matrix gives the
+  // Jacobi preconditioner
+  for (size_t b = 0; b < n; b++) {
+    body_t *body = network->bodies[b];
+    network->masses[b] = body_get_mass(body);
+    solution[b] = VEC_ZERO;
+    vector_t force = vec_add(network->forces[b], body_get_force(body));
+    residual[b] = vec_add(vec_multiply(dt, force),
+                          vec_multiply(dt * dt, product[b]));
+    double diagonal = network->masses[b] + dt * network->drag;
+    preconditioner[b] = (vector_t){diagonal, diagonal};
+  }
+  for (size_t i = 0; i < network->num_springs; i++) {
+    double *block = &network->blocks[3 * i];
+    size_t ends[2] = {network->firsts[i], network->ends[i]};
+    for (size_t e = 0; e < 2; e++) {
+      preconditioner[ends[e]].x += block[0];
+      preconditioner[ends[e]].y += block[2];
+    }
+  }
+  for (size_t b = 0; b < n; b++) {
+    if (isinf(network->masses[b])) {
+      residual[b] = preconditioner[b] = VEC_ZERO;
+    } else {
+      preconditioner[b] = (vector_t){1 / preconditioner[b].x,
+                                     1 / preconditioner[b].y};
+    }
+    search[b] = (vector_t){preconditioner[b].x * residual[b].x,
+                           preconditioner[b].y * residual[b].y};
+  }
+
+  double tolerance = SPRING_SOLVER_TOLERANCE * SPRING_SOLVER_TOLERANCE *
+                     dot_all(residual, residual, n);
+  double rz = dot_all(residual, search, n);
+  for (size_t iteration = 0; iteration < 2 * n && rz > 0; iteration++) {
+    multiply_system(network, dt);
+    double alpha = rz / dot_all(search, product, n);
+    for (size_t b = 0; b < n; b++) {
+      solution[b] = vec_add(solution[b], vec_multiply(alpha, search[b]));
+      residual[b] = vec_subtract(residual[b], vec_multiply(alpha, product[b]));
+    }
+    if (dot_all(residual, residual, n) <= tolerance) {
+      break;
+    }
+    // product is free again, so it holds the preconditioned residual
+    for (size_t b = 0; b < n; b++) {
+      product[b] = (vector_t){preconditioner[b].x * residual[b].x,
+                              preconditioner[b].y * residual[b].y};
+    }
+    double next_rz = dot_all(residual, product, n);
+    for (size_t b = 0; b < n; b++) {
+      search[b] = vec_add(product[b], vec_multiply(next_rz / rz, search[b]));
+    }
+    rz = next_rz;
+  }
+
+  // body_tick() adds the forces already on the bodies itself
+  for (size_t b = 0; b < n; b++) {
+    body_t *body = network->bodies[b];
+    if (!isinf(network->masses[b])) {
+      vector_t momentum = vec_multiply(network->masses[b], solution[b]);
+      vector_t pushed = vec_multiply(dt, body_get_force(body));
+      body_add_impulse(body, vec_subtract(momentum, pushed));
+    }
+  }
+}
@@ -0,0 +1,278 @@
+#include "sweep_and_prune.h"
+#include "pair_table.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t GUESS_NUM_SAP_PROXIES = 16;
+const size_t NUM_AXES = 2;
+
+typedef struct endpoint {
+  double value;
+  size_t proxy;
+  bool is_max;
+} endpoint_t;
+
+typedef struct sap_proxy {
+  void *data;
+  aabb_t box;
+  // index of the proxy's min and max endpoints in each axis' array
+  size_t min_index[2];
+  size_t max_index[2];
+  bool active;
+} sap_proxy_t;
+
+struct sweep_and_prune {
+  sap_proxy_t *proxies;
+  size_t num_proxies; // including inactive proxies awaiting reuse
+  size_t proxy_capacity;
+  // ids of inactive proxies
+  size_t *free_ids;
+  size_t num_free;
+
+  // endpoints along x (axis 0) and y (axis 1), sorted as of the last update
+  endpoint_t *endpoints[2];
+  size_t num_endpoints;
+
+  // pairs keyed by (id + 1, id + 1), so no key is ever NULL
+  pair_table_t *pairs;
+  pair_handler_t on_add;
+  pair_handler_t on_remove;
+  void *aux;
+};
+
+static void *pair_key(size_t proxy) { return (void *)(uintptr_t)(proxy + 1); }
+
+static size_t key_proxy(void *key) { return (size_t)(uintptr_t)key - 1; }
+
+static double axis_min(aabb_t box, size_t axis) {
+  return axis == 0 ? box.min.x : box.min.y;
+}
+
+static double axis_max(aabb_t box, size_t axis) {
+  return axis == 0 ? box.max.x : box.max.y;
+}
+
+sweep_and_prune_t *sweep_and_prune_init(pair_handler_t on_add,
+                                        pair_handler_t on_remove, void *aux) {
+  sweep_and_prune_t *sap = malloc(sizeof(sweep_and_prune_t));
+  assert(sap);
+
+  sap->proxy_capacity = GUESS_NUM_SAP_PROXIES;
+  sap->proxies = malloc(sizeof(sap_proxy_t) * sap->proxy_capacity);
+  assert(sap->proxies);
+  sap->free_ids = malloc(sizeof(size_t) * sap->proxy_capacity);
+  assert(sap->free_ids);
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    sap->endpoints[axis] =
+        malloc(sizeof(endpoint_t) * 2 * sap->proxy_capacity);
+    assert(sap->endpoints[axis]);
+  }
+  sap->num_proxies = 0;
+  sap->num_free = 0;
+  sap->num_endpoints = 0;
+
+  sap->pairs = pair_table_init(GUESS_NUM_SAP_PROXIES);
+  sap->on_add = on_add;
+  sap->on_remove = on_remove;
+  sap->aux = aux;
+  return sap;
+}
+
+void sweep_and_prune_free(sweep_and_prune_t *sap) {
+  free(sap->proxies);
+  free(sap->free_ids);
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    free(sap->endpoints[axis]);
+  }
+  pair_table_free(sap->pairs);
+  free(sap);
+}
+
+/**
+ * Doubles the storage for proxies and endpoints.
+ */
+static void grow(sweep_and_prune_t *sap) {
+  sap->proxy_capacity *= 2;
+  sap->proxies =
+      realloc(sap->proxies, sizeof(sap_proxy_t) * sap->proxy_capacity);
+  assert(sap->proxies);
+  sap->free_ids = realloc(sap->free_ids, sizeof(size_t) * sap->proxy_capacity);
+  assert(sap->free_ids);
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    sap->endpoints[axis] = realloc(
+        sap->endpoints[axis], sizeof(endpoint_t) * 2 * sap->proxy_capacity);
+    assert(sap->endpoints[axis]);
+  }
+}
+
+size_t sweep_and_prune_add(sweep_and_prune_t *sap, void *data, aabb_t box) {
+  size_t id;
+  if (sap->num_free > 0) {
+    id = sap->free_ids[--sap->num_free];
+  } else {
+    if (sap->num_proxies == sap->proxy_capacity) {
+      grow(sap);
+    }
+    id = sap->num_proxies++;
+  }
+
+  sap_proxy_t *proxy = &sap->proxies[id];
+  proxy->data = data;
+  proxy->box = box;
+  proxy->active = true;
+
+  // The new endpoints go at the end of each array, which is consistent with
+  // the proxy overlapping nothing. The next update sorts them into place and
+  // discovers its overlaps as they pass the other endpoints.
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    endpoint_t *endpoints = sap->endpoints[axis];
+    proxy->min_index[axis] = sap->num_endpoints;
+    endpoints[sap->num_endpoints] = (endpoint_t){
+        .value = axis_min(box, axis), .proxy = id, .is_max = false};
+    proxy->max_index[axis] = sap->num_endpoints + 1;
+    endpoints[sap->num_endpoints + 1] = (endpoint_t){
+        .value = axis_max(box, axis), .proxy = id, .is_max = true};
+  }
+  sap->num_endpoints += 2;
+  return id;
+}
+
+void sweep_and_prune_move(sweep_and_prune_t *sap, size_t proxy, aabb_t box) {
+  assert(proxy < sap->num_proxies && sap->proxies[proxy].active);
+  sap->proxies[proxy].box = box;
+}
+
+/**
+ * Records where an endpoint now sits in its axis' array.
+ */
+static void set_index(sweep_and_prune_t *sap, size_t axis, size_t index) {
+  endpoint_t *endpoint = &sap->endpoints[axis][index];
+  sap_proxy_t *proxy = &sap->proxies[endpoint->proxy];
+  if (endpoint->is_max) {
+    proxy->max_index[axis] = index;
+  } else {
+    proxy->min_index[axis] = index;
+  }
+}
+
+static void remove_pair(sweep_and_prune_t *sap, size_t p1, size_t p2) {
+  if (pair_table_remove(sap->pairs, pair_key(p1), pair_key(p2), NULL) &&
+      sap->on_remove != NULL) {
+    sap->on_remove(sap->proxies[p1].data, sap->proxies[p2].data, sap->aux);
+  }
+}
+
+void sweep_and_prune_remove(sweep_and_prune_t *sap, size_t proxy) {
+  assert(proxy < sap->num_proxies && sap->proxies[proxy].active);
+
+  for (size_t other = 0; other < sap->num_proxies; other++) {
+    if (other != proxy && sap->proxies[other].active) {
+      remove_pair(sap, proxy, other);
+    }
+  }
+
+  // close the gaps left by the proxy's endpoints, keeping the arrays sorted
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    endpoint_t *endpoints = sap->endpoints[axis];
+    size_t kept = 0;
+    for (size_t i = 0; i < sap->num_endpoints; i++) {
+      if (endpoints[i].proxy != proxy) {
+        endpoints[kept] = endpoints[i];
+        set_index(sap, axis, kept);
+        kept++;
+      }
+    }
+  }
+  sap->num_endpoints -= 2;
+
+  sap->proxies[proxy].active = false;
+  sap->free_ids[sap->num_free++] = proxy;
+}
+
+/**
+ * Returns whether endpoint a belongs before endpoint b.
+ * On ties min endpoints come first, so touching boxes count as overlapping,
+ * matching aabb_overlap().
+ */
+static bool endpoint_less(endpoint_t a, endpoint_t b) {
+  return a.value < b.value || (a.value == b.value && !a.is_max && b.is_max);
+}
+
+/**
+ * Insertion sorts one axis. Each swap changes whether two proxies overlap
+ * along the axis: a min moving left past a max may start an overlap,
+ * and a max moving left past a min ends one.
+ */
+static void sort_axis(sweep_and_prune_t *sap, size_t axis) {
+  endpoint_t *endpoints = sap->endpoints[axis];
+
+  for (size_t i = 1; i < sap->num_endpoints; i++) {
+    endpoint_t moving = endpoints[i];
+    size_t j = i;
+    while (j > 0 && endpoint_less(moving, endpoints[j - 1])) {
+      endpoint_t passed = endpoints[j - 1];
+      if (passed.proxy != moving.proxy) {
+        if (!moving.is_max && passed.is_max) {
+          sap_proxy_t *p1 = &sap->proxies[moving.proxy];
+          sap_proxy_t *p2 = &sap->proxies[passed.proxy];
+          void *k1 = pair_key(moving.proxy), *k2 = pair_key(passed.proxy);
+          if (aabb_overlap(p1->box, p2->box) &&
+              !pair_table_contains(sap->pairs, k1, k2)) {
+            pair_table_add(sap->pairs, k1, k2, NULL);
+            if (sap->on_add != NULL) {
+              sap->on_add(p1->data, p2->data, sap->aux);
+            }
+          }
+        } else if (moving.is_max && !passed.is_max) {
+          remove_pair(sap, moving.proxy, passed.proxy);
+        }
+      }
+      endpoints[j] = passed;
+      set_index(sap, axis, j);
+      j--;
+    }
+    endpoints[j] = moving;
+    set_index(sap, axis, j);
+  }
+}
+
+void sweep_and_prune_update(sweep_and_prune_t *sap) {
+  // refresh every endpoint from its proxy's box before sorting, so overlap
+  // tests during the sort see where every proxy is now
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    endpoint_t *endpoints = sap->endpoints[axis];
+    for (size_t i = 0; i < sap->num_endpoints; i++) {
+      aabb_t box = sap->proxies[endpoints[i].proxy].box;
+      endpoints[i].value =
+          endpoints[i].is_max ? axis_max(box, axis) : axis_min(box, axis);
+    }
+  }
+
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    sort_axis(sap, axis);
+  }
+}
+
+size_t sweep_and_prune_num_pairs(sweep_and_prune_t *sap) {
+  return pair_table_size(sap->pairs);
+}
+
+typedef struct pair_query {
+  sweep_and_prune_t *sap;
+  pair_handler_t handler;
+  void *aux;
+} pair_query_t;
+
+static void report_pair(void *key1, void *key2, void *value, void *aux) {
+  pair_query_t *query = aux;
+  sap_proxy_t *proxies = query->sap->proxies;
+  query->handler(proxies[key_proxy(key1)].data, proxies[key_proxy(key2)].data,
+                 query->aux);
+}
+
+void sweep_and_prune_query_pairs(sweep_and_prune_t *sap,
+                                 pair_handler_t handler, void *aux) {
+  pair_query_t query = {.sap = sap, .handler = handler, .aux = aux};
+  pair_table_foreach(sap->pairs, report_pair, &query);
+}
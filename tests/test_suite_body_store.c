@@ -0,0 +1,272 @@
+#include "body.h"
+#include "body_store.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t NUM_STORED_BODIES = 50;
+
+void test_store_slots() {
+  body_store_t *store = body_store_init(0);
+  for (size_t i = 0; i < NUM_STORED_BODIES; i++) {
+    assert(body_store_add(store) == i);
+    store->velocities[i] = (vector_t){i, 0};
+    store->forces[i] = (vector_t){0, i};
+    store->masses[i] = i + 1;
+    store->flags[i] = i % 2 ? BODY_CCD : 0;
+  }
+  assert(store->size == NUM_STORED_BODIES);
+  assert(vec_isclose(store->velocities[7], (vector_t){7, 0}));
+
+  body_store_move(store, 9, 4);
+  assert(vec_isclose(store->velocities[4], (vector_t){9, 0}));
+  assert(store->masses[4] == 10);
+  assert(store->flags[4] == BODY_CCD);
+  body_store_truncate(store, 10);
+  assert(store->size == 10);
+  body_store_reset(store);
+  for (size_t i = 0; i < store->size; i++) {
+    assert(vec_isclose(store->forces[i], VEC_ZERO));
+  }
+  assert(body_store_add(store) == 10);
+  assert(vec_isclose(store->velocities[10], VEC_ZERO));
+  body_store_free(store);
+}
+
+// Tests that the kernels tick only their range of slots, through the arrays
+void test_store_kernels() {
+  body_store_t *store = body_store_init(0);
+  for (size_t i = 0; i < 3; i++) {
+    body_store_add(store);
+    store->centroids[i] = (vector_t){i, 0};
+    store->velocities[i] = (vector_t){1, 0};
+    store->forces[i] = (vector_t){0, 2};
+    store->masses[i] = 2;
+    store->inverse_masses[i] = 0.5;
+  }
+  body_store_tick_symplectic_euler(store, 1, 3, 0.5);
+  assert(vec_isclose(store->centroids[0], (vector_t){0, 0}));
+  assert(vec_isclose(store->forces[0], (vector_t){0, 2}));
+  for (size_t i = 1; i < 3; i++) {
+    assert(vec_isclose(store->velocities[i], (vector_t){1, 0.5}));
+    assert(vec_isclose(store->centroids[i], (vector_t){i + 0.5, 0.25}));
+    assert(vec_isclose(store->forces[i], VEC_ZERO));
+    assert(vec_isclose(store->prev_velocities[i], (vector_t){1, 0}));
+  }
+  body_store_save_transforms(store);
+  assert(vec_isclose(store->prev_centroids[2], (vector_t){2.5, 0.25}));
+  body_store_free(store);
+}
+
+// Tests that a body's accessors read the same state before and after it is
+// added to a scene, and after the scene compacts its store around removals
+void test_body_handles() {
+  scene_t *scene = scene_init();
+  for (size_t i = 0; i < NUM_STORED_BODIES; i++) {
+    double mass = i % 5 == 0 ? INFINITY : i + 1;
+    body_t *body = body_init_circle((vector_t){i, 0}, 1, mass,
+                                    (rgb_color_t){0, 0, 0});
+    body_set_velocity(body, (vector_t){0, i});
+    body_set_ccd(body, i % 3 == 0);
+    body_add_force(body, (vector_t){i, i});
+    assert(vec_isclose(body_get_force(body), (vector_t){i, i}));
+    scene_add_body(scene, body);
+    assert(body_get_slot(body) == i);
+    assert(vec_isclose(body_get_velocity(body), (vector_t){0, i}));
+    assert(vec_isclose(body_get_force(body), (vector_t){i, i}));
+    assert(body_get_mass(body) == mass);
+    assert(body_get_ccd(body) == (i % 3 == 0));
+    body_reset(body);
+  }
+  for (size_t i = 0; i < NUM_STORED_BODIES; i += 4) {
+    scene_remove_body(scene, i);
+  }
+  scene_tick(scene, 0);
+
+  // removed bodies' indices are refilled from the end, so find each body by
+  // its centroid
+  assert(scene_bodies(scene) == NUM_STORED_BODIES - 13);
+  for (size_t index = 0; index < scene_bodies(scene); index++) {
+    body_t *body = scene_get_body(scene, index);
+    size_t i = round(body_get_centroid(body).x);
+    assert(i % 4 != 0);
+    assert(body_get_slot(body) == index);
+    assert(!body_is_removed(body));
+    assert(vec_isclose(body_get_velocity(body), (vector_t){0, i}));
+    assert(body_get_mass(body) == (i % 5 == 0 ? INFINITY : i + 1));
+    assert(body_get_ccd(body) == (i % 3 == 0));
+  }
+  scene_free(scene);
+}
+
+// Counts the ticks a force creator runs on
+void count_calls(void *aux) { (*(size_t *)aux)++; }
+
+// Tests that handles keep finding bodies and forces as removals reorder them,
+// and stop once they are freed
+void test_scene_handles() {
+  scene_t *scene = scene_init();
+  body_handle_t handles[NUM_STORED_BODIES];
+  for (size_t i = 0; i < NUM_STORED_BODIES; i++) {
+    body_t *body = body_init_circle((vector_t){i, 0}, 1, 1,
+                                    (rgb_color_t){0, 0, 0});
+    handles[i] = scene_add_body(scene, body);
+    assert(scene_get_body_by_handle(scene, handles[i]) == body);
+  }
+  size_t body_calls = 0, removed_calls = 0;
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, scene_get_body(scene, 0));
+  force_handle_t body_force =
+      scene_add_bodies_force_creator(scene, count_calls, &body_calls, bodies);
+  force_handle_t removed_force = scene_add_bodies_force_creator(
+      scene, count_calls, &removed_calls, list_init(0, NULL));
+
+  assert(scene_remove_force(scene, removed_force));
+  assert(!scene_remove_force(scene, removed_force));
+  assert(!scene_has_force(scene, removed_force));
+  assert(scene_has_force(scene, body_force));
+  for (size_t i = 0; i < NUM_STORED_BODIES; i += 3) {
+    assert(scene_remove_body_by_handle(scene, handles[i]));
+  }
+  scene_tick(scene, 0);
+  assert(removed_calls == 0);
+  assert(body_calls == 1);
+  // the force creator on the removed body 0 is freed with it
+  assert(!scene_has_force(scene, body_force));
+
+  for (size_t i = 0; i < NUM_STORED_BODIES; i++) {
+    body_t *body = scene_get_body_by_handle(scene, handles[i]);
+    if (i % 3 == 0) {
+      assert(body == NULL);
+      assert(!scene_remove_body_by_handle(scene, handles[i]));
+    } else {
+      assert(vec_isclose(body_get_centroid(body), (vector_t){i, 0}));
+      size_t index = body_get_slot(body);
+      assert(scene_get_body(scene, index) == body);
+      body_handle_t handle = scene_get_body_handle(scene, index);
+      assert(handle.index == handles[i].index);
+      assert(handle.generation == handles[i].generation);
+    }
+  }
+  scene_tick(scene, 0);
+  assert(body_calls == 1);
+  scene_free(scene);
+}
+
+// Tests that removing bodies frees exactly the force creators that depend on
+// them, including ones removed with scene_remove_force() in the same tick
+void test_force_index() {
+  scene_t *scene = scene_init();
+  body_t *bodies[NUM_STORED_BODIES];
+  for (size_t i = 0; i < NUM_STORED_BODIES; i++) {
+    bodies[i] = body_init_circle((vector_t){i, 0}, 1, 1,
+                                 (rgb_color_t){0, 0, 0});
+    scene_add_body(scene, bodies[i]);
+  }
+  // a force between each pair of neighbours, and one on all the bodies
+  size_t calls[NUM_STORED_BODIES];
+  force_handle_t pair_forces[NUM_STORED_BODIES - 1];
+  for (size_t i = 0; i + 1 < NUM_STORED_BODIES; i++) {
+    calls[i] = 0;
+    list_t *pair = list_init(2, NULL);
+    list_add(pair, bodies[i]);
+    list_add(pair, bodies[i + 1]);
+    pair_forces[i] =
+        scene_add_bodies_force_creator(scene, count_calls, &calls[i], pair);
+  }
+  size_t all_calls = 0;
+  list_t *all = list_init(NUM_STORED_BODIES, NULL);
+  for (size_t i = 0; i < NUM_STORED_BODIES; i++) {
+    list_add(all, bodies[i]);
+  }
+  force_handle_t all_force =
+      scene_add_bodies_force_creator(scene, count_calls, &all_calls, all);
+  scene_tick(scene, 0);
+  assert(all_calls == 1);
+
+  // removes both bodies of the pair forces 20 and 30, and one body of 19,
+  // 21, 29 and 31
+  body_remove(bodies[20]);
+  body_remove(bodies[21]);
+  body_remove(bodies[31]);
+  body_remove(bodies[30]);
+  assert(scene_remove_force(scene, pair_forces[21]));
+  assert(scene_remove_force(scene, pair_forces[5]));
+  scene_tick(scene, 0);
+  assert(scene_bodies(scene) == NUM_STORED_BODIES - 4);
+  assert(!scene_has_force(scene, all_force));
+  for (size_t i = 0; i + 1 < NUM_STORED_BODIES; i++) {
+    bool removed = (i >= 19 && i <= 21) || (i >= 29 && i <= 31) || i == 5;
+    assert(scene_has_force(scene, pair_forces[i]) == !removed);
+  }
+  scene_tick(scene, 0);
+  for (size_t i = 0; i + 1 < NUM_STORED_BODIES; i++) {
+    size_t expected = 3;
+    if (i == 5 || i == 21) {
+      expected = 1;
+    } else if ((i >= 19 && i <= 21) || (i >= 29 && i <= 31)) {
+      expected = 2;
+    }
+    assert(calls[i] == expected);
+  }
+  scene_free(scene);
+}
+
+// Counts the first collisions of a rule's pairs
+void count_collisions(body_t *body1, body_t *body2, vector_t axis, void *aux,
+                      double force_const) {
+  (*(size_t *)aux)++;
+}
+
+// Tests that removing bodies frees just the entries rules generated for
+// them, so the other pairs' entries carry on without colliding anew
+void test_rule_index() {
+  scene_t *scene = scene_init();
+  body_t *bodies[NUM_STORED_BODIES];
+  for (size_t i = 0; i < NUM_STORED_BODIES; i++) {
+    // each body overlaps only its neighbours
+    bodies[i] = body_init_circle((vector_t){1.5 * i, 0}, 1, 1,
+                                 (rgb_color_t){0, 0, 0});
+    body_set_collision_filter(bodies[i], 1, UINT32_MAX);
+    scene_add_body(scene, bodies[i]);
+  }
+  size_t collisions = 0;
+  scene_add_collision_rule(scene, 1, 1, count_collisions, &collisions, 0,
+                           false);
+  scene_tick(scene, 0);
+  assert(collisions == NUM_STORED_BODIES - 1);
+
+  body_remove(bodies[10]);
+  body_remove(bodies[11]);
+  body_remove(bodies[30]);
+  scene_tick(scene, 0);
+  // the last pairs' entries were moved into the freed ones' indices
+  body_remove(bodies[NUM_STORED_BODIES - 1]);
+  body_remove(bodies[0]);
+  scene_tick(scene, 0);
+  scene_tick(scene, 0);
+  assert(scene_bodies(scene) == NUM_STORED_BODIES - 5);
+  assert(collisions == NUM_STORED_BODIES - 1);
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_store_slots)
+  DO_TEST(test_store_kernels)
+  DO_TEST(test_body_handles)
+  DO_TEST(test_scene_handles)
+  DO_TEST(test_force_index)
+  DO_TEST(test_rule_index)
+
+  puts("body_store_test PASS");
+}
@@ -0,0 +1,203 @@
+#include "bvh.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t NUM_TREE_BOXES = 300;
+const size_t NUM_LINE_BOXES = 1024;
+const size_t NUM_TREE_STEPS = 100;
+const double TREE_MARGIN = 2;
+
+aabb_t make_box(double x, double y, double w, double h) {
+  return (aabb_t){.min = {x, y}, .max = {x + w, y + h}};
+}
+
+void mark_found(void *data, void *aux) {
+  bool *found = aux;
+  size_t index = (size_t)data - 1;
+  assert(!found[index]);
+  found[index] = true;
+}
+
+// Checks that a query finds every live box overlapping the region, and only
+// boxes whose fat boxes overlap it
+void check_query(bvh_t *tree, aabb_t region, aabb_t *boxes, size_t *ids,
+                 bool *alive, size_t n) {
+  bool *found = calloc(n, sizeof(bool));
+  assert(found);
+  bvh_query(tree, region, mark_found, found);
+  for (size_t i = 0; i < n; i++) {
+    if (alive[i] && aabb_overlap(boxes[i], region)) {
+      assert(found[i]);
+    }
+    if (found[i]) {
+      assert(alive[i]);
+      aabb_t fat_box = bvh_get_fat_aabb(tree, ids[i]);
+      assert(aabb_contains(fat_box, boxes[i]));
+      assert(aabb_overlap(fat_box, region));
+    }
+  }
+  free(found);
+}
+
+void test_bvh_empty() {
+  bvh_t *tree = bvh_init(TREE_MARGIN);
+  assert(bvh_size(tree) == 0);
+  assert(bvh_height(tree) == 0);
+  bool found[1] = {false};
+  bvh_query(tree, make_box(0, 0, 100, 100), mark_found, found);
+  assert(!found[0]);
+  size_t id = bvh_insert(tree, (void *)1, make_box(0, 0, 1, 1));
+  assert(bvh_height(tree) == 1);
+  bvh_remove(tree, id);
+  assert(bvh_size(tree) == 0);
+  assert(bvh_height(tree) == 0);
+  bvh_free(tree);
+}
+
+void test_bvh_fat_boxes() {
+  bvh_t *tree = bvh_init(TREE_MARGIN);
+  size_t id = bvh_insert(tree, (void *)1, make_box(0, 0, 10, 10));
+  assert(vec_isclose(bvh_get_fat_aabb(tree, id).min, (vector_t){-2, -2}));
+  assert(vec_isclose(bvh_get_fat_aabb(tree, id).max, (vector_t){12, 12}));
+  // small moves stay inside the fat box
+  assert(!bvh_move(tree, id, make_box(1, 1, 10, 10)));
+  assert(vec_isclose(bvh_get_fat_aabb(tree, id).min, (vector_t){-2, -2}));
+  // leaving the fat box reinserts the proxy
+  assert(bvh_move(tree, id, make_box(5, 0, 10, 10)));
+  assert(vec_isclose(bvh_get_fat_aabb(tree, id).min, (vector_t){3, -2}));
+  // shrinking far inside the fat box also refreshes it
+  assert(bvh_move(tree, id, make_box(12, 4, 1, 1)));
+  assert(vec_isclose(bvh_get_fat_aabb(tree, id).max, (vector_t){15, 7}));
+  bvh_free(tree);
+}
+
+void test_bvh_balanced() {
+  // inserting boxes in sorted order would build a list without rebalancing
+  bvh_t *tree = bvh_init(0);
+  for (size_t i = 0; i < NUM_LINE_BOXES; i++) {
+    bvh_insert(tree, (void *)(i + 1), make_box(i * 10, 0, 5, 5));
+  }
+  assert(bvh_size(tree) == NUM_LINE_BOXES);
+  assert(bvh_height(tree) <= 2 * log2(NUM_LINE_BOXES) + 2);
+
+  bool *found = calloc(NUM_LINE_BOXES, sizeof(bool));
+  assert(found);
+  bvh_query(tree, make_box(102, 1, 15, 1), mark_found, found);
+  for (size_t i = 0; i < NUM_LINE_BOXES; i++) {
+    assert(found[i] == (i == 10 || i == 11));
+  }
+  free(found);
+  bvh_free(tree);
+}
+
+void test_bvh_random() {
+  srand(5);
+  size_t n = NUM_TREE_BOXES;
+  bvh_t *tree = bvh_init(TREE_MARGIN);
+  aabb_t boxes[NUM_TREE_BOXES];
+  size_t ids[NUM_TREE_BOXES];
+  bool alive[NUM_TREE_BOXES];
+  for (size_t i = 0; i < n; i++) {
+    boxes[i] = make_box(rand() % 500, rand() % 500, rand() % 30 + 1,
+                        rand() % 30 + 1);
+    ids[i] = bvh_insert(tree, (void *)(i + 1), boxes[i]);
+    alive[i] = true;
+  }
+
+  for (size_t t = 0; t < NUM_TREE_STEPS; t++) {
+    for (size_t i = 0; i < n; i++) {
+      vector_t step = {rand() % 5 - 2, rand() % 5 - 2};
+      boxes[i].min = vec_add(boxes[i].min, step);
+      boxes[i].max = vec_add(boxes[i].max, step);
+      if (alive[i]) {
+        bvh_move(tree, ids[i], boxes[i]);
+      }
+    }
+    // toggle a few proxies in and out of the tree
+    for (size_t k = 0; k < 5; k++) {
+      size_t i = rand() % n;
+      if (alive[i]) {
+        bvh_remove(tree, ids[i]);
+      } else {
+        ids[i] = bvh_insert(tree, (void *)(i + 1), boxes[i]);
+      }
+      alive[i] = !alive[i];
+    }
+    aabb_t region = make_box(rand() % 500, rand() % 500, rand() % 100,
+                             rand() % 100);
+    check_query(tree, region, boxes, ids, alive, n);
+  }
+
+  size_t num_alive = 0;
+  for (size_t i = 0; i < n; i++) {
+    num_alive += alive[i];
+  }
+  assert(bvh_size(tree) == num_alive);
+  assert(bvh_height(tree) <= 2 * log2(num_alive) + 2);
+  bvh_free(tree);
+}
+
+typedef struct ray_query {
+  aabb_t *boxes;
+  vector_t origin;
+  vector_t delta;
+  double radius;
+  double closest;
+} ray_query_t;
+
+double clip_ray(void *data, void *aux) {
+  ray_query_t *query = aux;
+  aabb_t box = aabb_fatten(query->boxes[(size_t)data - 1], query->radius);
+  double fraction = aabb_ray_fraction(box, query->origin, query->delta);
+  query->closest = fmin(query->closest, fraction);
+  return fraction;
+}
+
+// Checks that rays shortened to each box they report find the closest box
+void test_bvh_raycast() {
+  srand(9);
+  bvh_t *tree = bvh_init(TREE_MARGIN);
+  aabb_t boxes[NUM_TREE_BOXES];
+  for (size_t i = 0; i < NUM_TREE_BOXES; i++) {
+    boxes[i] = make_box(rand() % 500, rand() % 500, rand() % 30 + 1,
+                        rand() % 30 + 1);
+    bvh_insert(tree, (void *)(i + 1), boxes[i]);
+  }
+  for (size_t ray = 0; ray < 200; ray++) {
+    ray_query_t query = {.boxes = boxes,
+                         .origin = {rand() % 700 - 100, rand() % 700 - 100},
+                         .delta = {rand() % 700 - 350, rand() % 700 - 350},
+                         .radius = ray % 2 == 0 ? 0 : rand() % 20,
+                         .closest = INFINITY};
+    bvh_raycast(tree, query.origin, query.delta, query.radius, clip_ray,
+                &query);
+    double closest = INFINITY;
+    for (size_t i = 0; i < NUM_TREE_BOXES; i++) {
+      closest = fmin(closest,
+                     aabb_ray_fraction(aabb_fatten(boxes[i], query.radius),
+                                       query.origin, query.delta));
+    }
+    assert(query.closest == closest);
+  }
+  bvh_free(tree);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_bvh_empty)
+  DO_TEST(test_bvh_fat_boxes)
+  DO_TEST(test_bvh_balanced)
+  DO_TEST(test_bvh_random)
+  DO_TEST(test_bvh_raycast)
+
+  puts("bvh_test PASS");
+}
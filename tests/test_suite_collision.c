@@ -1 +1,488 @@
-int main() { return 0; }
\ No newline at end of file
+#include "collision.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t NUM_RANDOM_PAIRS = 2000;
+
+// A regular polygon with the given number of sides, counterclockwise
+body_t *make_regular(size_t sides, double radius, vector_t center,
+                     double rotation) {
+  list_t *shape = list_init(sides, free);
+  for (size_t i = 0; i < sides; i++) {
+    double angle = 2 * M_PI * i / sides + rotation;
+    vector_t *v = malloc(sizeof(vector_t));
+    assert(v);
+    *v = vec_add(center, (vector_t){radius * cos(angle), radius * sin(angle)});
+    list_add(shape, v);
+  }
+  return body_init(shape, 1, (rgb_color_t){0, 0, 0});
+}
+
+body_t *make_box(double x, double y, double w, double h) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *v = malloc(sizeof(vector_t));
+    assert(v);
+    *v = corners[i];
+    list_add(shape, v);
+  }
+  return body_init(shape, 1, (rgb_color_t){0, 0, 0});
+}
+
+void test_sat_depth() {
+  body_t *box1 = make_box(0, 0, 2, 2);
+  body_t *box2 = make_box(1.5, 0.5, 2, 2);
+  collision_info_t info = find_collision(box1, box2);
+  assert(info.collided);
+  assert(isclose(info.depth, 0.5));
+  assert(isclose(fabs(info.axis.x), 1) && isclose(info.axis.y, 0));
+
+  body_t *box3 = make_box(3, 0, 2, 2);
+  assert(!find_collision(box1, box3).collided);
+  body_free(box1);
+  body_free(box2);
+  body_free(box3);
+}
+
+void test_sat_cached_axis() {
+  body_t *box = make_box(0, 0, 10, 10);
+  body_t *other = make_regular(6, 5, (vector_t){40, 3}, 0);
+  sat_cache_t cache = {0};
+  vector_t step = {-0.5, 0};
+  for (size_t i = 0; i < 80; i++) {
+    body_set_centroid(other, vec_add(body_get_centroid(other), step));
+    body_set_rotation(other, i * 0.05);
+    collision_info_t fresh = find_collision(box, other);
+    collision_info_t cached = find_collision_sat(box, other, &cache);
+    assert(fresh.collided == cached.collided);
+    assert(cache.separated == !fresh.collided);
+    if (fresh.collided) {
+      assert(isclose(fresh.depth, cached.depth));
+      assert(vec_isclose(fresh.axis, cached.axis));
+    }
+  }
+  body_free(box);
+  body_free(other);
+}
+
+void test_circle_circle() {
+  body_t *circle1 = body_init_circle((vector_t){0, 0}, 2, 1,
+                                     (rgb_color_t){0, 0, 0});
+  body_t *circle2 = body_init_circle((vector_t){3, 4}, 4, 1,
+                                     (rgb_color_t){0, 0, 0});
+  collision_info_t info = find_collision(circle1, circle2);
+  assert(info.collided);
+  assert(isclose(info.depth, 1));
+  assert(vec_isclose(info.axis, (vector_t){0.6, 0.8}));
+
+  body_set_centroid(circle2, (vector_t){3, 5.5});
+  assert(!find_collision(circle1, circle2).collided);
+  assert(vec_isclose(body_get_aabb(circle2).min, (vector_t){-1, 1.5}));
+  body_free(circle1);
+  body_free(circle2);
+}
+
+void test_circle_polygon() {
+  body_t *box = make_box(0, 0, 4, 2);
+  body_t *circle = body_init_circle((vector_t){2, 2.5}, 1, 1,
+                                    (rgb_color_t){0, 0, 0});
+  // against the top edge
+  collision_info_t info = find_collision(box, circle);
+  assert(info.collided);
+  assert(isclose(info.depth, 0.5));
+  assert(vec_isclose(info.axis, (vector_t){0, 1}));
+  info = find_collision(circle, box);
+  assert(vec_isclose(info.axis, (vector_t){0, -1}));
+
+  // near a corner, but outside its radius
+  body_set_centroid(circle, (vector_t){4.8, 2.8});
+  assert(!find_collision(box, circle).collided);
+  // overlapping the corner
+  body_set_centroid(circle, (vector_t){4.6, 2.8});
+  info = find_collision(box, circle);
+  assert(info.collided);
+  assert(isclose(info.depth, 0));
+  assert(vec_isclose(info.axis, (vector_t){0.6, 0.8}));
+
+  // center inside the box
+  body_set_centroid(circle, (vector_t){3.5, 1});
+  info = find_collision(circle, box);
+  assert(info.collided);
+  assert(isclose(info.depth, 1.5));
+  assert(vec_isclose(info.axis, (vector_t){-1, 0}));
+
+  // the cached separating edge is reused
+  sat_cache_t cache = {0};
+  body_set_centroid(circle, (vector_t){2, 5});
+  assert(!find_collision_sat(box, circle, &cache).collided);
+  assert(cache.separated && cache.axis_body == 0);
+  body_set_centroid(circle, (vector_t){2, 3});
+  assert(find_collision_sat(box, circle, &cache).collided);
+  assert(!cache.separated);
+  body_free(box);
+  body_free(circle);
+}
+
+// A random box, and a polygon body with the same vertices
+body_t *make_random_box(body_t **as_polygon) {
+  body_t *box = body_init_box((vector_t){rand() % 60, rand() % 60},
+                              rand() % 30 + 1, rand() % 30 + 1, 1,
+                              (rgb_color_t){0, 0, 0});
+  body_set_rotation(box, rand() % 628 / 100.0);
+  *as_polygon = body_init(body_get_shape(box), 1, (rgb_color_t){0, 0, 0});
+  return box;
+}
+
+void test_box_shape() {
+  body_t *box = body_init_box((vector_t){1, 2}, 4, 2, 1,
+                              (rgb_color_t){0, 0, 0});
+  polygon_t *poly = body_get_polygon(box);
+  assert(polygon_get_kind(poly) == SHAPE_BOX);
+  assert(list_size(polygon_get_points(poly)) == 0);
+  assert(isclose(polygon_area(poly), 8));
+  assert(vec_isclose(polygon_get_vertex(poly, 0), (vector_t){-1, 1}));
+  assert(vec_isclose(polygon_get_vertex(poly, 2), (vector_t){3, 3}));
+
+  body_set_rotation(box, M_PI / 2);
+  assert(vec_isclose(body_get_centroid(box), (vector_t){1, 2}));
+  // the polygon is only turned when it is asked for again
+  poly = body_get_polygon(box);
+  assert(vec_isclose(polygon_get_vertex(poly, 0), (vector_t){2, 0}));
+  aabb_t aabb = body_get_aabb(box);
+  assert(vec_isclose(aabb.min, (vector_t){0, 0}));
+  assert(vec_isclose(aabb.max, (vector_t){2, 4}));
+  body_set_centroid(box, (vector_t){5, 5});
+  assert(vec_isclose(body_get_aabb(box).min, (vector_t){4, 3}));
+  body_free(box);
+}
+
+// Boxes must collide exactly like polygons with the same vertices
+void test_box_matches_polygon() {
+  srand(11);
+  for (size_t i = 0; i < NUM_RANDOM_PAIRS; i++) {
+    body_t *poly1;
+    body_t *poly2;
+    body_t *box1 = make_random_box(&poly1);
+    body_t *box2 = make_random_box(&poly2);
+    body_t *other = make_regular(rand() % 18 + 3, rand() % 20 + 5,
+                                 (vector_t){rand() % 60, rand() % 60},
+                                 rand() % 628 / 100.0);
+    body_t *circle = body_init_circle((vector_t){rand() % 60, rand() % 60},
+                                      rand() % 20 + 1, 1,
+                                      (rgb_color_t){0, 0, 0});
+    body_t *pairs[][4] = {{box1, box2, poly1, poly2},
+                          {box1, other, poly1, other},
+                          {other, box2, other, poly2},
+                          {box1, circle, poly1, circle},
+                          {circle, box2, circle, poly2}};
+    for (size_t j = 0; j < sizeof(pairs) / sizeof(pairs[0]); j++) {
+      collision_info_t box = find_collision(pairs[j][0], pairs[j][1]);
+      collision_info_t poly = find_collision(pairs[j][2], pairs[j][3]);
+      assert(box.collided == poly.collided);
+      if (box.collided) {
+        assert(within(1e-6, box.depth, poly.depth));
+      }
+      collision_info_t gjk = find_collision_gjk(pairs[j][0], pairs[j][1],
+                                                NULL);
+      assert(gjk.collided == box.collided);
+      if (box.collided) {
+        assert(within(1e-4, box.depth, gjk.depth));
+      }
+    }
+    body_free(box1);
+    body_free(box2);
+    body_free(poly1);
+    body_free(poly2);
+    body_free(other);
+    body_free(circle);
+  }
+}
+
+void test_box_cached_axis() {
+  body_t *box = body_init_box((vector_t){0, 0}, 10, 10, 1,
+                              (rgb_color_t){0, 0, 0});
+  body_t *other = body_init_box((vector_t){40, 3}, 6, 4, 1,
+                                (rgb_color_t){0, 0, 0});
+  sat_cache_t cache = {0};
+  vector_t step = {-0.5, 0};
+  for (size_t i = 0; i < 80; i++) {
+    body_set_centroid(other, vec_add(body_get_centroid(other), step));
+    body_set_rotation(other, i * 0.05);
+    collision_info_t fresh = find_collision(box, other);
+    collision_info_t cached = find_collision_sat(box, other, &cache);
+    assert(fresh.collided == cached.collided);
+    assert(cache.separated == !fresh.collided);
+    if (fresh.collided) {
+      assert(isclose(fresh.depth, cached.depth));
+      // the axis points from the first box towards the second
+      assert(vec_isclose(fresh.axis, cached.axis));
+      vector_t between = vec_subtract(body_get_centroid(other),
+                                      body_get_centroid(box));
+      assert(vec_dot(fresh.axis, between) >= 0);
+    }
+  }
+  body_free(box);
+  body_free(other);
+}
+
+void test_manifold_resting_box() {
+  body_t *floor = make_box(0, 0, 10, 2);
+  body_t *box = make_box(3, 1.75, 2, 2);
+  collision_info_t info = find_collision(floor, box);
+  assert(info.collided);
+  assert(vec_isclose(info.axis, (vector_t){0, 1}));
+  contact_manifold_t manifold = find_contact_manifold(floor, box, info);
+  assert(manifold.num_points == 2);
+  assert(isclose(manifold.depth, 0.25));
+  for (size_t i = 0; i < 2; i++) {
+    assert(isclose(manifold.points[i].y, 1.75));
+    assert(isclose(manifold.depths[i], 0.25));
+  }
+  assert(isclose(fabs(manifold.points[0].x - manifold.points[1].x), 2));
+
+  // the same contact with the bodies swapped, and the box overhanging
+  body_set_centroid(box, (vector_t){10, 2.75});
+  info = find_collision(box, floor);
+  assert(vec_isclose(info.axis, (vector_t){0, -1}));
+  manifold = find_contact_manifold(box, floor, info);
+  assert(manifold.num_points == 2);
+  double min_x = fmin(manifold.points[0].x, manifold.points[1].x);
+  double max_x = fmax(manifold.points[0].x, manifold.points[1].x);
+  assert(isclose(min_x, 9) && isclose(max_x, 10));
+  body_free(floor);
+  body_free(box);
+}
+
+void test_manifold_corner() {
+  body_t *floor = body_init_box((vector_t){0, -1}, 10, 2, 1,
+                                (rgb_color_t){0, 0, 0});
+  body_t *box = body_init_box((vector_t){1, sqrt(2) - 0.1}, 2, 2, 1,
+                              (rgb_color_t){0, 0, 0});
+  body_set_rotation(box, M_PI / 4);
+  collision_info_t info = find_collision(floor, box);
+  assert(info.collided);
+  assert(isclose(info.depth, 0.1));
+  contact_manifold_t manifold = find_contact_manifold(floor, box, info);
+  assert(manifold.num_points == 1);
+  assert(vec_isclose(manifold.points[0], (vector_t){1, -0.1}));
+  assert(isclose(manifold.depths[0], 0.1));
+
+  body_t *circle = body_init_circle((vector_t){2, 0.5}, 1, 1,
+                                    (rgb_color_t){0, 0, 0});
+  info = find_collision(circle, floor);
+  manifold = find_contact_manifold(circle, floor, info);
+  assert(manifold.num_points == 1);
+  assert(vec_isclose(manifold.normal, (vector_t){0, -1}));
+  assert(vec_isclose(manifold.points[0], (vector_t){2, -0.5}));
+  body_free(floor);
+  body_free(box);
+  body_free(circle);
+}
+
+void test_time_of_impact() {
+  body_t *wall = make_box(10, -5, 1, 10);
+  body_t *box = make_box(0, 0, 2, 2);
+  // the box's right side reaches the wall after moving 8
+  assert(isclose(find_time_of_impact(wall, VEC_ZERO, box, (vector_t){16, 0}),
+                 0.5));
+  assert(isclose(find_time_of_impact(box, (vector_t){16, 0}, wall, VEC_ZERO),
+                 0.5));
+  // both bodies moving towards each other
+  assert(isclose(find_time_of_impact(box, (vector_t){4, 0}, wall,
+                                     (vector_t){-4, 0}),
+                 1));
+  // moving away, passing above, or falling short
+  assert(find_time_of_impact(wall, VEC_ZERO, box, (vector_t){-16, 0}) ==
+         INFINITY);
+  assert(find_time_of_impact(wall, VEC_ZERO, box, (vector_t){16, 40}) ==
+         INFINITY);
+  assert(find_time_of_impact(wall, VEC_ZERO, box, (vector_t){7, 0}) ==
+         INFINITY);
+  // already overlapping: touching at once unless moving apart
+  body_set_centroid(box, (vector_t){10, 0});
+  assert(find_time_of_impact(wall, VEC_ZERO, box, (vector_t){16, 0}) == 0);
+  assert(find_time_of_impact(wall, VEC_ZERO, box, (vector_t){-16, 0}) ==
+         INFINITY);
+
+  body_t *circle1 = body_init_circle((vector_t){0, 0}, 1, 1,
+                                     (rgb_color_t){0, 0, 0});
+  body_t *circle2 = body_init_circle((vector_t){10, 0}, 2, 1,
+                                     (rgb_color_t){0, 0, 0});
+  assert(isclose(find_time_of_impact(circle1, (vector_t){14, 0}, circle2,
+                                     VEC_ZERO),
+                 0.5));
+  assert(find_time_of_impact(circle1, (vector_t){14, 8}, circle2,
+                             VEC_ZERO) == INFINITY);
+  // a circle against a box's face
+  assert(isclose(find_time_of_impact(wall, VEC_ZERO, circle1,
+                                     (vector_t){18, 0}),
+                 0.5));
+  // a circle against a box's corner touches it only once the corner is a
+  // radius away, later than the circle's bounding square would
+  body_set_centroid(circle1, (vector_t){6, 9});
+  assert(isclose(find_time_of_impact(wall, VEC_ZERO, circle1,
+                                     (vector_t){10, -10}),
+                 (4 - sqrt(0.5)) / 10));
+  body_free(wall);
+  body_free(box);
+  body_free(circle1);
+  body_free(circle2);
+}
+
+void test_raycast() {
+  body_t *box = make_box(0, 0, 2, 2);
+  body_t *obb = body_init_box((vector_t){1, 1}, 2, 2, 1,
+                              (rgb_color_t){0, 0, 0});
+  body_t *circle = body_init_circle((vector_t){1, 1}, 1, 1,
+                                    (rgb_color_t){0, 0, 0});
+  body_t *shapes[] = {box, obb};
+  for (size_t i = 0; i < 2; i++) {
+    cast_info_t info =
+        find_raycast(shapes[i], (vector_t){-4, 1.5}, (vector_t){8, 0});
+    assert(info.hit);
+    assert(isclose(info.fraction, 0.5));
+    assert(vec_isclose(info.point, (vector_t){0, 1.5}));
+    assert(vec_isclose(info.normal, (vector_t){-1, 0}));
+    // too short, passing above, or starting inside
+    assert(!find_raycast(shapes[i], (vector_t){-4, 1.5}, (vector_t){3, 0}).hit);
+    assert(!find_raycast(shapes[i], (vector_t){-4, 3}, (vector_t){8, 0}).hit);
+    assert(!find_raycast(shapes[i], (vector_t){1, 1}, (vector_t){8, 0}).hit);
+  }
+  cast_info_t info =
+      find_raycast(circle, (vector_t){1, -4}, (vector_t){0, 10});
+  assert(info.hit);
+  assert(isclose(info.fraction, 0.4));
+  assert(vec_isclose(info.point, (vector_t){1, 0}));
+  assert(vec_isclose(info.normal, (vector_t){0, -1}));
+
+  // a circle of radius 1 reaches the box's face a unit early
+  info = find_shapecast(box, (vector_t){-4, 1}, 1, (vector_t){6, 0});
+  assert(info.hit);
+  assert(isclose(info.fraction, 0.5));
+  assert(vec_isclose(info.point, (vector_t){0, 1}));
+  // passing just above the box, it grazes the corner
+  info = find_shapecast(box, (vector_t){-4, 2.6}, 1, (vector_t){8, 0});
+  assert(info.hit);
+  assert(vec_isclose(info.point, (vector_t){0, 2}));
+  assert(isclose(info.normal.y, 0.6));
+  assert(isclose(info.fraction, (4 - 0.8) / 8));
+  assert(!find_shapecast(box, (vector_t){-4, 3.1}, 1, (vector_t){8, 0}).hit);
+  // circles add their radii
+  info = find_shapecast(circle, (vector_t){-4, 1}, 1, (vector_t){8, 0});
+  assert(info.hit);
+  assert(isclose(info.fraction, 3.0 / 8));
+  assert(vec_isclose(info.point, (vector_t){0, 1}));
+  body_free(box);
+  body_free(obb);
+  body_free(circle);
+}
+
+void test_gjk_boxes() {
+  body_t *box1 = make_box(0, 0, 2, 2);
+  body_t *box2 = make_box(1.5, 0.5, 2, 2);
+  collision_info_t info = find_collision_gjk(box1, box2, NULL);
+  assert(info.collided);
+  assert(isclose(info.depth, 0.5));
+  // the axis points from box1 towards box2
+  assert(vec_isclose(info.axis, (vector_t){1, 0}));
+  info = find_collision_gjk(box2, box1, NULL);
+  assert(vec_isclose(info.axis, (vector_t){-1, 0}));
+
+  body_t *box3 = make_box(0.5, -1.75, 1, 2);
+  info = find_collision_gjk(box1, box3, NULL);
+  assert(info.collided);
+  assert(isclose(info.depth, 0.25));
+  assert(vec_isclose(info.axis, (vector_t){0, -1}));
+
+  body_t *box4 = make_box(3, 3, 1, 1);
+  assert(!find_collision_gjk(box1, box4, NULL).collided);
+  body_free(box1);
+  body_free(box2);
+  body_free(box3);
+  body_free(box4);
+}
+
+// GJK and SAT must agree on whether random polygons collide, and on how deep
+// the overlap is when they do
+void test_gjk_matches_sat() {
+  srand(7);
+  for (size_t i = 0; i < NUM_RANDOM_PAIRS; i++) {
+    body_t *body1 = make_regular(rand() % 18 + 3, rand() % 20 + 5,
+                                 (vector_t){rand() % 60, rand() % 60},
+                                 rand() % 628 / 100.0);
+    body_t *body2 = make_regular(rand() % 18 + 3, rand() % 20 + 5,
+                                 (vector_t){rand() % 60, rand() % 60},
+                                 rand() % 628 / 100.0);
+    collision_info_t sat = find_collision(body1, body2);
+    collision_info_t gjk = find_collision_gjk(body1, body2, NULL);
+    assert(sat.collided == gjk.collided);
+    if (sat.collided) {
+      assert(within(1e-4, sat.depth, gjk.depth));
+      assert(within(1e-6, vec_get_length(gjk.axis), 1));
+      // both axes point from body1 towards body2
+      vector_t between =
+          vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
+      assert(vec_dot(gjk.axis, between) >= -1e-9);
+      assert(vec_dot(sat.axis, between) >= -1e-9);
+
+      contact_manifold_t manifold = find_contact_manifold(body1, body2, sat);
+      assert(manifold.num_points >= 1 && manifold.num_points <= 2);
+      for (size_t j = 0; j < manifold.num_points; j++) {
+        assert(manifold.depths[j] >= 0);
+        assert(manifold.depths[j] <= sat.depth + 1e-6);
+      }
+    }
+    body_free(body1);
+    body_free(body2);
+  }
+}
+
+void test_gjk_warm_start() {
+  body_t *circle = make_regular(20, 10, (vector_t){0, 0}, 0);
+  body_t *other = make_regular(20, 10, (vector_t){30, 5}, 0.1);
+  gjk_cache_t cache = {0};
+  vector_t step = {-0.5, 0};
+  for (size_t i = 0; i < 60; i++) {
+    body_set_centroid(other, vec_add(body_get_centroid(other), step));
+    collision_info_t cold = find_collision_gjk(circle, other, NULL);
+    collision_info_t warm = find_collision_gjk(circle, other, &cache);
+    assert(cold.collided == warm.collided);
+    if (cold.collided) {
+      assert(within(1e-6, cold.depth, warm.depth));
+      assert(vec_within(1e-6, cold.axis, warm.axis));
+    }
+    assert(cache.num_points > 0 && cache.num_points <= 3);
+  }
+  body_free(circle);
+  body_free(other);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_sat_depth)
+  DO_TEST(test_sat_cached_axis)
+  DO_TEST(test_circle_circle)
+  DO_TEST(test_circle_polygon)
+  DO_TEST(test_box_shape)
+  DO_TEST(test_box_matches_polygon)
+  DO_TEST(test_box_cached_axis)
+  DO_TEST(test_manifold_resting_box)
+  DO_TEST(test_manifold_corner)
+  DO_TEST(test_time_of_impact)
+  DO_TEST(test_raycast)
+  DO_TEST(test_gjk_boxes)
+  DO_TEST(test_gjk_matches_sat)
+  DO_TEST(test_gjk_warm_start)
+
+  puts("collision_test PASS");
+}
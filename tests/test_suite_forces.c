@@ -151,6 +151,731 @@ void test_forces_removed() {
   scene_free(scene);
 }
 
+// Tests that a body sunk into a wall is pushed back out, and only along the
+// contact normal
+void test_contact_correction() {
+  scene_t *scene = scene_init();
+  body_t *floor = body_init_box((vector_t){0, -10}, 100, 20, INFINITY,
+                                (rgb_color_t){0, 0, 0});
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(body, (vector_t){3, 0.5});
+  scene_add_body(scene, floor);
+  scene_add_body(scene, body);
+  create_physics_collision(scene, body, floor, 0);
+  for (int i = 0; i < 100; i++) {
+    scene_tick(scene, 0.01);
+  }
+  vector_t centroid = body_get_centroid(body);
+  assert(isclose(centroid.x, 3));
+  assert(centroid.y > 0.9 && centroid.y <= 1);
+  assert(isclose(body_get_centroid(floor).y, -10));
+  scene_free(scene);
+}
+
+const double STACK_GRAVITY = 10;
+const size_t STACK_HEIGHT = 3;
+body_t *stack[3];
+
+void stack_gravity(void *aux) {
+  for (size_t i = 0; i < STACK_HEIGHT; i++) {
+    body_add_force(stack[i], (vector_t){0, -STACK_GRAVITY});
+  }
+}
+
+// Tests that a stack of boxes resting under gravity stays put
+void test_resting_stack() {
+  scene_t *scene = scene_init();
+  body_t *floor = body_init_box((vector_t){0, -10}, 100, 20, INFINITY,
+                                (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, floor);
+  for (size_t i = 0; i < STACK_HEIGHT; i++) {
+    stack[i] = body_init_box((vector_t){0, 1 + 2 * i}, 2, 2, 1,
+                             (rgb_color_t){0, 0, 0});
+    scene_add_body(scene, stack[i]);
+    create_physics_collision(scene, i == 0 ? floor : stack[i - 1], stack[i],
+                             0);
+  }
+  scene_add_force_creator(scene, stack_gravity, NULL);
+  for (int i = 0; i < 500; i++) {
+    scene_tick(scene, 0.02);
+  }
+  for (size_t i = 0; i < STACK_HEIGHT; i++) {
+    assert(within(0.2, body_get_centroid(stack[i]).y, 1 + 2 * i));
+    assert(isclose(body_get_centroid(stack[i]).x, 0));
+    assert(within(0.05, body_get_velocity(stack[i]).y, 0));
+  }
+  scene_free(scene);
+}
+
+// Tests that an elastic body bounces off a wall with its speed reversed
+void test_contact_bounce() {
+  scene_t *scene = scene_init();
+  body_t *wall = body_init_box((vector_t){10, 0}, 2, 100, INFINITY,
+                               (rgb_color_t){0, 0, 0});
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(body, (vector_t){5, 0});
+  scene_add_body(scene, wall);
+  scene_add_body(scene, body);
+  create_physics_collision(scene, body, wall, 1);
+  for (int i = 0; i < 400; i++) {
+    scene_tick(scene, 0.01);
+  }
+  assert(vec_isclose(body_get_velocity(body), (vector_t){-5, 0}));
+  assert(body_get_centroid(body).x < 0);
+  scene_free(scene);
+}
+
+// Tests that the one-shot breakout handler still works with create_collision()
+void test_breakout_collision_handler() {
+  scene_t *scene = scene_init();
+  body_t *brick = body_init_box((vector_t){10, 0}, 2, 100, INFINITY,
+                                (rgb_color_t){0, 0, 0});
+  body_t *ball = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(ball, (vector_t){5, 0});
+  scene_add_body(scene, brick);
+  scene_add_body(scene, ball);
+  create_collision(scene, ball, brick, breakout_collision_handler, NULL, 1);
+  for (int i = 0; i < 400; i++) {
+    scene_tick(scene, 0.01);
+  }
+  assert(scene_bodies(scene) == 1);
+  assert(vec_isclose(body_get_velocity(ball), (vector_t){-5, 0}));
+  assert(body_get_centroid(ball).x < 0);
+  scene_free(scene);
+}
+
+// Tests that a fast body only bounces off a thin wall with CCD enabled
+void test_ccd_thin_wall() {
+  for (int ccd = 0; ccd < 2; ccd++) {
+    scene_t *scene = scene_init();
+    body_t *wall = body_init_box((vector_t){10, 0}, 1, 100, INFINITY,
+                                 (rgb_color_t){0, 0, 0});
+    body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    body_set_velocity(body, (vector_t){1000, 0});
+    body_set_ccd(body, ccd);
+    scene_add_body(scene, wall);
+    scene_add_body(scene, body);
+    create_physics_collision(scene, body, wall, 1);
+    for (int i = 0; i < 5; i++) {
+      scene_tick(scene, 0.01);
+      assert(!ccd || body_get_centroid(body).x <= 8.5);
+    }
+    if (ccd) {
+      assert(vec_isclose(body_get_velocity(body), (vector_t){-1000, 0}));
+    } else {
+      // without it, the body passes straight through
+      assert(body_get_centroid(body).x > 11);
+    }
+    scene_free(scene);
+  }
+}
+
+// Tests that a fast circle aimed at a box's corner bounces off the corner,
+// rather than touching it late and passing through
+void test_ccd_corner() {
+  scene_t *scene = scene_init();
+  // the box's top-left corner is at the origin
+  body_t *box = body_init_box((vector_t){0.5, -10}, 1, 20, INFINITY,
+                              (rgb_color_t){0, 0, 0});
+  body_t *ball = body_init_circle((vector_t){-5, 5}, 1, 1,
+                                  (rgb_color_t){0, 0, 0});
+  body_set_velocity(ball, (vector_t){1000, -1000});
+  body_set_ccd(ball, true);
+  scene_add_body(scene, box);
+  scene_add_body(scene, ball);
+  create_physics_collision(scene, ball, box, 1);
+  scene_tick(scene, 0.01);
+  vector_t velocity = body_get_velocity(ball);
+  assert(within(1e-3, velocity.x, -1000) && within(1e-3, velocity.y, 1000));
+  assert(body_get_centroid(ball).x < 0 && body_get_centroid(ball).y > 0);
+  scene_free(scene);
+}
+
+// Tests that a fast circle reaching a floor and a wall at the same instant
+// bounces off both
+void test_ccd_two_walls() {
+  scene_t *scene = scene_init();
+  body_t *floor = body_init_box((vector_t){-9.5, -0.5}, 21, 1, INFINITY,
+                                (rgb_color_t){0, 0, 0});
+  body_t *wall = body_init_box((vector_t){0.5, 10}, 1, 20, INFINITY,
+                               (rgb_color_t){0, 0, 0});
+  body_t *ball = body_init_circle((vector_t){-6, 6}, 1, 1,
+                                  (rgb_color_t){0, 0, 0});
+  body_set_velocity(ball, (vector_t){1000, -1000});
+  body_set_ccd(ball, true);
+  scene_add_body(scene, floor);
+  scene_add_body(scene, wall);
+  scene_add_body(scene, ball);
+  create_physics_collision(scene, ball, floor, 1);
+  create_physics_collision(scene, ball, wall, 1);
+  for (int i = 0; i < 3; i++) {
+    scene_tick(scene, 0.01);
+    assert(body_get_centroid(ball).x <= -1 + 1e-6);
+    assert(body_get_centroid(ball).y >= 1 - 1e-6);
+  }
+  assert(vec_isclose(body_get_velocity(ball), (vector_t){-1000, 1000}));
+  scene_free(scene);
+}
+
+// Tests that a body hit by a continuously collided one moves off at once,
+// even if it ticked earlier in the same tick
+void test_ccd_momentum() {
+  scene_t *scene = scene_init();
+  body_t *target = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(target, (vector_t){10, 0});
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(body, (vector_t){1000, 0});
+  body_set_ccd(body, true);
+  scene_add_body(scene, target);
+  scene_add_body(scene, body);
+  create_physics_collision(scene, body, target, 1);
+  scene_tick(scene, 0.01);
+  vector_t momentum =
+      vec_add(body_get_velocity(body), body_get_velocity(target));
+  assert(vec_isclose(momentum, (vector_t){1000, 0}));
+  assert(body_get_velocity(target).x > 500);
+  scene_free(scene);
+}
+
+// Counts the collisions between a body and the rule's second category
+void count_hits(body_t *body1, body_t *body2, vector_t axis, void *aux,
+                double force_const) {
+  assert(body_get_category(body1) == 1);
+  (*(int *)aux)++;
+}
+
+// Tests that collision rules pair bodies by category, respecting their masks
+void test_collision_rules() {
+  scene_t *scene = scene_init();
+  body_t *wall = body_init_box((vector_t){10, 0}, 2, 100, INFINITY,
+                               (rgb_color_t){0, 0, 0});
+  body_t *bouncer = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_t *ghost = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(bouncer, (vector_t){5, 0});
+  body_set_velocity(ghost, (vector_t){5, 0});
+  body_set_centroid(ghost, (vector_t){0, 20});
+  body_set_collision_filter(wall, 2, UINT32_MAX);
+  body_set_collision_filter(bouncer, 1, UINT32_MAX);
+  body_set_collision_filter(ghost, 1, 1);
+  scene_add_body(scene, wall);
+  scene_add_body(scene, bouncer);
+  scene_add_body(scene, ghost);
+  int hits = 0;
+  create_collision_rule(scene, 1, 2, count_hits, &hits, 0);
+  create_physics_rule(scene, 2, 1, 1);
+  for (int i = 0; i < 400; i++) {
+    scene_tick(scene, 0.01);
+  }
+  // only the first matching rule applies, so nothing bounces
+  assert(hits == 1);
+  assert(body_get_centroid(bouncer).x > 11);
+  assert(body_get_centroid(ghost).x > 11);
+  scene_free(scene);
+
+  scene = scene_init();
+  wall = body_init_box((vector_t){10, 0}, 2, 100, INFINITY,
+                       (rgb_color_t){0, 0, 0});
+  bouncer = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  ghost = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(bouncer, (vector_t){5, 0});
+  body_set_velocity(ghost, (vector_t){5, 0});
+  body_set_centroid(ghost, (vector_t){0, 20});
+  body_set_collision_filter(wall, 2, UINT32_MAX);
+  body_set_collision_filter(bouncer, 1, UINT32_MAX);
+  body_set_collision_filter(ghost, 1, 1);
+  scene_add_body(scene, wall);
+  scene_add_body(scene, bouncer);
+  scene_add_body(scene, ghost);
+  create_physics_rule(scene, 2, 1, 1);
+  for (int i = 0; i < 400; i++) {
+    scene_tick(scene, 0.01);
+  }
+  // the ghost's mask excludes the wall, so only the bouncer bounces
+  assert(vec_isclose(body_get_velocity(bouncer), (vector_t){-5, 0}));
+  assert(body_get_centroid(bouncer).x < 0);
+  assert(body_get_centroid(ghost).x > 11);
+  scene_free(scene);
+}
+
+// Lets casts hit every body but the one passed as aux
+bool skip_body(body_t *body, void *aux) { return body != aux; }
+
+// Tests that casts through the scene find the same first hit as testing
+// every body, for both broad phases
+void test_scene_raycast() {
+  srand(3);
+  for (int sweep = 0; sweep < 2; sweep++) {
+    scene_t *scene = scene_init();
+    if (sweep) {
+      scene_set_broad_phase(scene, BROAD_PHASE_SWEEP);
+    }
+    for (size_t i = 0; i < 100; i++) {
+      vector_t center = {rand() % 1000, rand() % 1000};
+      double mass = i % 4 == 0 ? INFINITY : 1;
+      body_t *body =
+          i % 2 == 0
+              ? body_init_circle(center, rand() % 20 + 1, mass,
+                                 (rgb_color_t){0, 0, 0})
+              : body_init_box(center, rand() % 40 + 1, rand() % 40 + 1, mass,
+                              (rgb_color_t){0, 0, 0});
+      body_set_velocity(body, (vector_t){rand() % 100 - 50, 0});
+      scene_add_body(scene, body);
+    }
+    scene_tick(scene, 0.1);
+    body_t *skipped = scene_get_body(scene, 0);
+    for (size_t ray = 0; ray < 100; ray++) {
+      vector_t origin = {rand() % 1000, rand() % 1000};
+      vector_t direction = {rand() % 200 - 100, rand() % 200 - 100};
+      double radius = ray % 2 == 0 ? 0 : rand() % 10;
+      double distance = rand() % 800;
+      raycast_hit_t hit =
+          scene_shapecast(scene, origin, radius, direction, distance,
+                          skip_body, skipped);
+      vector_t delta = vec_multiply(distance / vec_get_length(direction),
+                                    direction);
+      body_t *closest = NULL;
+      double fraction = 1;
+      for (size_t i = 0; i < scene_bodies(scene); i++) {
+        body_t *body = scene_get_body(scene, i);
+        cast_info_t info = find_shapecast(body, origin, radius, delta);
+        if (body != skipped && info.hit && info.fraction < fraction) {
+          closest = body;
+          fraction = info.fraction;
+        }
+      }
+      assert(hit.body == closest);
+      if (closest != NULL) {
+        assert(isclose(hit.fraction, fraction));
+      }
+    }
+    scene_free(scene);
+  }
+}
+
+// Counts each kind of sensor event
+void count_sensor_event(body_t *sensor, body_t *body, sensor_event_t event,
+                        void *aux) {
+  assert(body_is_sensor(sensor) && !body_is_sensor(body));
+  ((int *)aux)[event]++;
+}
+
+// Tests that a body passing through a sensor is reported entering and
+// leaving it once, and is not pushed by it
+void test_sensor_events() {
+  scene_t *scene = scene_init();
+  body_t *sensor = body_init_box((vector_t){10, 0}, 4, 4, INFINITY,
+                                 (rgb_color_t){0, 0, 0});
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(body, (vector_t){5, 0});
+  body_set_sensor(sensor, true);
+  body_set_collision_filter(sensor, 2, UINT32_MAX);
+  body_set_collision_filter(body, 1, UINT32_MAX);
+  scene_add_body(scene, sensor);
+  scene_add_body(scene, body);
+  create_physics_rule(scene, 1, 2, 1);
+  int events[2] = {0, 0};
+  scene_set_sensor_handler(scene, count_sensor_event, events);
+  for (int i = 0; i < 200; i++) {
+    // events are reported before the bodies move
+    bool inside = fabs(body_get_centroid(body).x - 10) < 3;
+    scene_tick(scene, 0.01);
+    assert(events[SENSOR_ENTER] - events[SENSOR_EXIT] == inside);
+  }
+  for (int i = 0; i < 200; i++) {
+    scene_tick(scene, 0.01);
+  }
+  assert(events[SENSOR_ENTER] == 1);
+  assert(events[SENSOR_EXIT] == 1);
+  assert(vec_isclose(body_get_velocity(body), (vector_t){5, 0}));
+  scene_free(scene);
+}
+
+typedef struct found_bodies {
+  body_t **bodies;
+  size_t num_bodies;
+} found_bodies_t;
+
+void add_found_body(body_t *body, void *aux) {
+  found_bodies_t *found = aux;
+  for (size_t i = 0; i < found->num_bodies; i++) {
+    assert(found->bodies[i] != body);
+  }
+  found->bodies[found->num_bodies++] = body;
+}
+
+// Tests that point and box queries find the same bodies as testing every
+// body
+void test_scene_queries() {
+  srand(4);
+  scene_t *scene = scene_init();
+  for (size_t i = 0; i < 100; i++) {
+    vector_t center = {rand() % 500, rand() % 500};
+    double mass = i % 4 == 0 ? INFINITY : 1;
+    body_t *body =
+        i % 2 == 0 ? body_init_circle(center, rand() % 30 + 1, mass,
+                                      (rgb_color_t){0, 0, 0})
+                   : body_init_box(center, rand() % 60 + 1, rand() % 60 + 1,
+                                   mass, (rgb_color_t){0, 0, 0});
+    body_set_velocity(body, (vector_t){rand() % 100 - 50, 0});
+    scene_add_body(scene, body);
+  }
+  scene_tick(scene, 0.1);
+  body_t *bodies[100];
+  for (size_t query = 0; query < 200; query++) {
+    found_bodies_t found = {.bodies = bodies, .num_bodies = 0};
+    vector_t point = {rand() % 500, rand() % 500};
+    aabb_t box = {.min = point,
+                  .max = vec_add(point, (vector_t){rand() % 80, rand() % 80})};
+    if (query % 2 == 0) {
+      scene_query_point(scene, point, add_found_body, &found);
+    } else {
+      scene_query_aabb(scene, box, add_found_body, &found);
+    }
+    size_t expected = 0;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+      body_t *body = scene_get_body(scene, i);
+      expected += query % 2 == 0 ? body_contains_point(body, point)
+                                 : aabb_overlap(body_get_aabb(body), box);
+    }
+    assert(found.num_bodies == expected);
+    for (size_t i = 0; i < found.num_bodies; i++) {
+      assert(query % 2 == 0
+                 ? body_contains_point(found.bodies[i], point)
+                 : aabb_overlap(body_get_aabb(found.bodies[i]), box));
+    }
+  }
+  scene_free(scene);
+}
+
+bool is_light(body_t *body, void *aux) {
+  return body_get_mass(body) < *(double *)aux;
+}
+
+// Tests that Barnes-Hut gravity with a zero opening angle pulls bodies like
+// pairwise Newtonian gravity, skips filtered bodies and survives removals
+void test_barnes_hut_gravity() {
+  const size_t NUM_ORBITERS = 40;
+  const double G = 1e3, DT = 1e-3, MAX_MASS = 100;
+  srand(3);
+  scene_t *pairwise = scene_init();
+  scene_t *tree = scene_init();
+  for (size_t i = 0; i < NUM_ORBITERS; i++) {
+    vector_t centroid = {rand() % 1000, rand() % 1000};
+    double mass = rand() % 10 + 1;
+    body_t *body = body_init(make_shape(), mass, (rgb_color_t){0, 0, 0});
+    body_set_centroid(body, centroid);
+    scene_add_body(pairwise, body);
+    for (size_t j = 0; j < i; j++) {
+      create_newtonian_gravity(pairwise, G, body, scene_get_body(pairwise, j));
+    }
+    body = body_init(make_shape(), mass, (rgb_color_t){0, 0, 0});
+    body_set_centroid(body, centroid);
+    scene_add_body(tree, body);
+  }
+  double max_mass = MAX_MASS;
+  create_barnes_hut_gravity(tree, G, 0, is_light, &max_mass);
+  body_t *heavy = body_init(make_shape(), MAX_MASS, (rgb_color_t){0, 0, 0});
+  scene_add_body(tree, heavy);
+
+  for (size_t tick = 0; tick < 100; tick++) {
+    scene_tick(pairwise, DT);
+    scene_tick(tree, DT);
+  }
+  for (size_t i = 0; i < NUM_ORBITERS; i++) {
+    body_t *expected = scene_get_body(pairwise, i);
+    body_t *body = scene_get_body(tree, i);
+    assert(vec_isclose(body_get_velocity(body), body_get_velocity(expected)));
+    assert(vec_isclose(body_get_centroid(body), body_get_centroid(expected)));
+  }
+  assert(vec_isclose(body_get_velocity(heavy), VEC_ZERO));
+
+  while (scene_bodies(tree) > 0) {
+    scene_remove_body(tree, 0);
+    scene_tick(tree, DT);
+  }
+  scene_free(pairwise);
+  scene_free(tree);
+}
+
+bool is_even_mass(body_t *body, void *aux) {
+  return (int)body_get_mass(body) % 2 == 0;
+}
+
+// Tests that force fields act like the equivalent per-body forces on the
+// bodies their filters allow, and leave infinite masses alone
+void test_force_fields() {
+  const vector_t GRAVITY = {0, -10}, WIND = {30, 0};
+  const double GAMMA = 0.5, DT = 1e-2;
+  scene_t *fields = scene_init();
+  scene_t *entries = scene_init();
+  for (size_t i = 1; i <= 6; i++) {
+    for (size_t j = 0; j < 2; j++) {
+      scene_t *scene = j == 0 ? fields : entries;
+      body_t *body = body_init(make_shape(), i, (rgb_color_t){0, 0, 0});
+      body_set_centroid(body, (vector_t){100 * i, 0});
+      body_set_velocity(body, (vector_t){i, -2.0 * i});
+      scene_add_body(scene, body);
+    }
+    create_drag(entries, GAMMA, scene_get_body(entries, i - 1));
+  }
+  body_t *wall = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  scene_add_body(fields, wall);
+  create_uniform_gravity(fields, GRAVITY, is_even_mass, NULL);
+  create_drag_field(fields, GAMMA, 0, NULL, NULL);
+
+  for (size_t tick = 0; tick < 100; tick++) {
+    for (size_t i = 0; i < scene_bodies(entries); i++) {
+      body_t *body = scene_get_body(entries, i);
+      if (is_even_mass(body, NULL)) {
+        body_add_force(body, vec_multiply(body_get_mass(body), GRAVITY));
+      }
+    }
+    scene_tick(fields, DT);
+    scene_tick(entries, DT);
+  }
+  for (size_t i = 0; i < scene_bodies(entries); i++) {
+    body_t *expected = scene_get_body(entries, i);
+    body_t *body = scene_get_body(fields, i);
+    assert(vec_isclose(body_get_velocity(body), body_get_velocity(expected)));
+  }
+  assert(vec_isclose(body_get_velocity(wall), VEC_ZERO));
+  scene_free(fields);
+  scene_free(entries);
+
+  // quadratic drag relative to the wind carries a body along with it
+  scene_t *scene = scene_init();
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, body);
+  create_wind(scene, WIND, 0, GAMMA, NULL, NULL);
+  for (size_t tick = 0; tick < 10000; tick++) {
+    scene_tick(scene, DT);
+  }
+  assert(vec_get_length(vec_subtract(body_get_velocity(body), WIND)) < 0.5);
+  scene_free(scene);
+}
+
+// Tests that RK4 follows a spring's oscillation closely at a long tick
+void test_rk4_sinusoid() {
+  const double M = 10, K = 2, A = 3, DT = 1e-2;
+  const size_t STEPS = 1000;
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_RK4);
+  assert(scene_get_integrator(scene) == INTEGRATOR_RK4);
+  body_t *mass = body_init(make_shape(), M, (rgb_color_t){0, 0, 0});
+  body_set_centroid(mass, (vector_t){A, 0});
+  scene_add_body(scene, mass);
+  body_t *anchor = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  body_set_centroid(anchor, VEC_ZERO);
+  scene_add_body(scene, anchor);
+  create_spring(scene, K, mass, anchor);
+  for (size_t i = 0; i < STEPS; i++) {
+    scene_tick(scene, DT);
+  }
+  double expected = A * cos(sqrt(K / M) * STEPS * DT);
+  assert(fabs(body_get_centroid(mass).x - expected) < 1e-8);
+  assert(vec_equal(body_get_centroid(anchor), VEC_ZERO));
+  scene_free(scene);
+}
+
+// Tests that a planet stays in a circular orbit for ten orbits at 200 ticks
+// per orbit with each integrator that is meant to allow long ticks
+void test_orbit_integrators() {
+  const double G = 1, SUN_MASS = 1e6, RADIUS = 100;
+  const integrator_t integrators[] = {
+      INTEGRATOR_SYMPLECTIC_EULER, INTEGRATOR_VELOCITY_VERLET, INTEGRATOR_RK4};
+  const double max_errors[] = {0.05, 0.01, 0.01};
+  double speed = sqrt(G * SUN_MASS / RADIUS);
+  double dt = 2 * M_PI * RADIUS / speed / 200;
+  for (size_t i = 0; i < 3; i++) {
+    scene_t *scene = scene_init();
+    scene_set_integrator(scene, integrators[i]);
+    body_t *sun = body_init(make_shape(), SUN_MASS, (rgb_color_t){0, 0, 0});
+    body_set_centroid(sun, VEC_ZERO);
+    body_t *planet = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    body_set_centroid(planet, (vector_t){RADIUS, 0});
+    body_set_velocity(planet, (vector_t){0, speed});
+    scene_add_body(scene, sun);
+    scene_add_body(scene, planet);
+    create_newtonian_gravity(scene, G, sun, planet);
+    double energy = kinetic_energy(planet) + gravity_potential(G, sun, planet);
+    for (size_t tick = 0; tick < 2000; tick++) {
+      scene_tick(scene, dt);
+      vector_t r =
+          vec_subtract(body_get_centroid(planet), body_get_centroid(sun));
+      assert(fabs(vec_get_length(r) / RADIUS - 1) < max_errors[i]);
+    }
+    double final_energy =
+        kinetic_energy(planet) + gravity_potential(G, sun, planet);
+    assert(fabs(final_energy / energy - 1) < max_errors[i]);
+    scene_free(scene);
+  }
+}
+
+// Tests that a body falling under constant gravity, which any tick length
+// integrates exactly, is stepped with the longest ticks allowed
+void test_adaptive_free_fall() {
+  const double GRAVITY = 10, MAX_STEP = 0.1, TOLERANCE = 1e-6;
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_RK4);
+  scene_set_step_limits(scene, 1e-6, MAX_STEP);
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(body, VEC_ZERO);
+  scene_add_body(scene, body);
+  create_uniform_gravity(scene, (vector_t){0, -GRAVITY}, NULL, NULL);
+  scene_step_adaptive(scene, 1, TOLERANCE);
+  step_stats_t stats = scene_get_step_stats(scene);
+  assert(stats.rejected_steps == 0);
+  assert(stats.accepted_steps <= 11);
+  assert(isclose(stats.longest_step, MAX_STEP));
+  assert(fabs(body_get_centroid(body).y + GRAVITY / 2) < TOLERANCE);
+  scene_free(scene);
+}
+
+// Tests that an eccentric orbit is stepped finely near the sun and coarsely
+// far from it, and follows fine fixed ticks within the tolerance
+void test_adaptive_eccentric_orbit() {
+  const double G = 1, SUN_MASS = 1e6, RADIUS = 100;
+  const double FRAME = 1.0 / 60;
+  const size_t FINE_TICKS = 1000;
+  const double tolerances[] = {1e-3, 1e-5};
+  // 0.4 times the circular orbit's speed at its apocenter gives an orbit that
+  // swings in to under a tenth of RADIUS after 1.25 seconds
+  double speed = 0.4 * sqrt(G * SUN_MASS / RADIUS);
+  scene_t *scenes[3];
+  body_t *planets[3];
+  for (size_t i = 0; i < 3; i++) {
+    scenes[i] = scene_init();
+    scene_set_integrator(scenes[i], INTEGRATOR_RK4);
+    body_t *sun = body_init(make_shape(), SUN_MASS, (rgb_color_t){0, 0, 0});
+    body_set_centroid(sun, VEC_ZERO);
+    planets[i] = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    body_set_centroid(planets[i], (vector_t){RADIUS, 0});
+    body_set_velocity(planets[i], (vector_t){0, speed});
+    scene_add_body(scenes[i], sun);
+    scene_add_body(scenes[i], planets[i]);
+    create_newtonian_gravity(scenes[i], G, sun, planets[i]);
+  }
+  for (size_t frame = 0; frame < 120; frame++) {
+    for (size_t i = 0; i < 2; i++) {
+      scene_step_adaptive(scenes[i], FRAME, tolerances[i]);
+    }
+    for (size_t tick = 0; tick < FINE_TICKS; tick++) {
+      scene_tick(scenes[2], FRAME / FINE_TICKS);
+    }
+  }
+  size_t steps = 0;
+  for (size_t i = 0; i < 2; i++) {
+    step_stats_t stats = scene_get_step_stats(scenes[i]);
+    assert(stats.accepted_steps > steps);
+    assert(stats.shortest_step < stats.longest_step / 5);
+    assert(stats.longest_step <= FRAME);
+    vector_t error = vec_subtract(body_get_centroid(planets[i]),
+                                  body_get_centroid(planets[2]));
+    assert(vec_get_length(error) < tolerances[i]);
+    steps = stats.accepted_steps;
+  }
+  for (size_t i = 0; i < 3; i++) {
+    scene_free(scenes[i]);
+  }
+}
+
+// Tests that ticks too long for a stiff spring are rejected and retried
+// shorter, so the mass still follows the spring's exact oscillation
+void test_adaptive_stiff_spring() {
+  const double M = 1, K = 1e4, SPEED = 100, TOLERANCE = 1e-4;
+  const double FRAME = 1.0 / 60;
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_RK4);
+  body_t *mass = body_init(make_shape(), M, (rgb_color_t){0, 0, 0});
+  body_set_centroid(mass, VEC_ZERO);
+  body_set_velocity(mass, (vector_t){SPEED, 0});
+  scene_add_body(scene, mass);
+  body_t *anchor = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  body_set_centroid(anchor, VEC_ZERO);
+  scene_add_body(scene, anchor);
+  create_spring(scene, K, mass, anchor);
+  for (size_t frame = 0; frame < 60; frame++) {
+    scene_step_adaptive(scene, FRAME, TOLERANCE);
+  }
+  step_stats_t stats = scene_get_step_stats(scene);
+  assert(stats.rejected_steps > 0);
+  assert(stats.longest_step < FRAME);
+  double omega = sqrt(K / M);
+  double expected = SPEED / omega * sin(omega);
+  assert(fabs(body_get_centroid(mass).x - expected) <
+         stats.accepted_steps * TOLERANCE);
+  scene_free(scene);
+}
+
+// Counts the times a scene runs its force creators
+void count_evaluations(void *aux) { (*(size_t *)aux)++; }
+
+// Tests that each accepted adaptive tick runs the force creators twice,
+// reusing the forces its error estimate found, and each rejected one once
+void test_adaptive_force_evaluations() {
+  const double M = 1, K = 1e4, SPEED = 100, TOLERANCE = 1e-4;
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_VELOCITY_VERLET);
+  body_t *mass = body_init(make_shape(), M, (rgb_color_t){0, 0, 0});
+  body_set_velocity(mass, (vector_t){SPEED, 0});
+  scene_add_body(scene, mass);
+  body_t *anchor = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, anchor);
+  create_spring(scene, K, mass, anchor);
+  size_t evaluations = 0;
+  scene_add_field_force_creator(scene, count_evaluations, &evaluations, NULL);
+  for (size_t frame = 0; frame < 10; frame++) {
+    scene_step_adaptive(scene, 1.0 / 60, TOLERANCE);
+  }
+  step_stats_t stats = scene_get_step_stats(scene);
+  assert(stats.rejected_steps > 0);
+  assert(evaluations == 2 * stats.accepted_steps + stats.rejected_steps);
+  scene_free(scene);
+}
+
+typedef struct push_log {
+  body_t *body;
+  size_t calls;
+  vector_t centroids[2];
+  vector_t velocities[2];
+} push_log_t;
+
+// Pushes a body with a constant force, logging the state it is called at
+void logged_push(void *aux) {
+  push_log_t *log = aux;
+  if (log->calls < 2) {
+    log->centroids[log->calls] = body_get_centroid(log->body);
+    log->velocities[log->calls] = body_get_velocity(log->body);
+  }
+  log->calls++;
+  body_add_force(log->body, (vector_t){1, 0});
+}
+
+// Tests that an adaptive tick runs a force creator with side effects twice,
+// the second time at an Euler step ahead that the body never reaches
+void test_adaptive_side_effects() {
+  const double STEP = 0.5;
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_VELOCITY_VERLET);
+  // a longer tick is allowed so the whole step is taken in one
+  scene_set_step_limits(scene, STEP, 2 * STEP);
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, body);
+  push_log_t log = {.body = body, .calls = 0};
+  scene_add_field_force_creator(scene, logged_push, &log, NULL);
+  scene_step_adaptive(scene, STEP, 1e-6);
+  assert(log.calls == 2);
+  assert(vec_isclose(log.centroids[0], VEC_ZERO));
+  assert(vec_isclose(log.velocities[0], VEC_ZERO));
+  // the Euler step ahead moves the body at its starting velocity, zero
+  assert(vec_isclose(log.centroids[1], VEC_ZERO));
+  assert(vec_isclose(log.velocities[1], (vector_t){STEP, 0}));
+  // while the tick itself accelerates it along the way
+  assert(vec_isclose(body_get_centroid(body), (vector_t){STEP * STEP / 2, 0}));
+  assert(vec_isclose(body_get_velocity(body), (vector_t){STEP, 0}));
+  scene_free(scene);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -164,6 +889,27 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_energy_conservation)
   DO_TEST(test_collisions)
   DO_TEST(test_forces_removed)
+  DO_TEST(test_contact_correction)
+  DO_TEST(test_resting_stack)
+  DO_TEST(test_contact_bounce)
+  DO_TEST(test_breakout_collision_handler)
+  DO_TEST(test_ccd_thin_wall)
+  DO_TEST(test_ccd_corner)
+  DO_TEST(test_ccd_two_walls)
+  DO_TEST(test_ccd_momentum)
+  DO_TEST(test_collision_rules)
+  DO_TEST(test_scene_raycast)
+  DO_TEST(test_sensor_events)
+  DO_TEST(test_scene_queries)
+  DO_TEST(test_barnes_hut_gravity)
+  DO_TEST(test_force_fields)
+  DO_TEST(test_rk4_sinusoid)
+  DO_TEST(test_orbit_integrators)
+  DO_TEST(test_adaptive_free_fall)
+  DO_TEST(test_adaptive_eccentric_orbit)
+  DO_TEST(test_adaptive_stiff_spring)
+  DO_TEST(test_adaptive_force_evaluations)
+  DO_TEST(test_adaptive_side_effects)
 
   puts("forces_test PASS");
 }
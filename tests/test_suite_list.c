@@ -245,6 +245,30 @@ void test_null_values() {
   list_free(l);
 }
 
+void test_swap_remove() {
+  const size_t size = 10;
+  list_t *l = list_init(size, free);
+  for (size_t i = 0; i < size; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = (vector_t){i, 0};
+    list_add(l, v);
+  }
+  // the last element fills the hole
+  vector_t *v = list_swap_remove(l, 2);
+  assert(vec_equal(*v, (vector_t){2, 0}));
+  free(v);
+  assert(list_size(l) == size - 1);
+  assert(vec_equal(*((vector_t *)list_get(l, 2)), (vector_t){9, 0}));
+  assert(vec_equal(*((vector_t *)list_get(l, 8)), (vector_t){8, 0}));
+  // removing the last element leaves the rest in place
+  v = list_swap_remove(l, list_size(l) - 1);
+  assert(vec_equal(*v, (vector_t){8, 0}));
+  free(v);
+  assert(list_size(l) == size - 2);
+  assert(vec_equal(*((vector_t *)list_get(l, 7)), (vector_t){7, 0}));
+  list_free(l);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -263,6 +287,7 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_full_add)
   DO_TEST(test_empty_remove)
   DO_TEST(test_null_values)
+  DO_TEST(test_swap_remove)
 
   puts("list_test PASS");
 }
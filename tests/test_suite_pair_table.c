@@ -0,0 +1,85 @@
+#include "pair_table.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t NUM_PAIRS = 1000;
+
+void sum_values(void *a, void *b, void *value, void *aux) {
+  *(size_t *)aux += (size_t)value;
+}
+
+void test_pair_table_unordered() {
+  pair_table_t *table = pair_table_init(0);
+  void *a = (void *)0x10, *b = (void *)0x20;
+  assert(!pair_table_contains(table, a, b));
+  pair_table_add(table, a, b, (void *)1);
+  assert(pair_table_size(table) == 1);
+  assert(pair_table_contains(table, a, b));
+  assert(pair_table_contains(table, b, a));
+  assert(!pair_table_remove(table, b, a, (void *)2));
+  assert(pair_table_remove(table, b, a, (void *)1));
+  assert(!pair_table_contains(table, a, b));
+  assert(pair_table_size(table) == 0);
+  pair_table_free(table);
+}
+
+void test_pair_table_multiple_values() {
+  pair_table_t *table = pair_table_init(1);
+  void *a = (void *)0x10, *b = (void *)0x20, *c = (void *)0x30;
+  pair_table_add(table, a, b, (void *)1);
+  pair_table_add(table, b, a, (void *)2);
+  pair_table_add(table, a, c, (void *)4);
+  size_t sum = 0;
+  pair_table_find(table, a, b, sum_values, &sum);
+  assert(sum == 3);
+  sum = 0;
+  pair_table_foreach(table, sum_values, &sum);
+  assert(sum == 7);
+  assert(pair_table_remove(table, a, b, (void *)1));
+  sum = 0;
+  pair_table_find(table, b, a, sum_values, &sum);
+  assert(sum == 2);
+  pair_table_free(table);
+}
+
+void test_pair_table_many() {
+  pair_table_t *table = pair_table_init(0);
+  for (size_t i = 1; i <= NUM_PAIRS; i++) {
+    pair_table_add(table, (void *)(i * 8), (void *)((i + 1) * 8), (void *)i);
+  }
+  assert(pair_table_size(table) == NUM_PAIRS);
+  // remove every other pair, then check the rest survived the tombstones
+  for (size_t i = 1; i <= NUM_PAIRS; i += 2) {
+    assert(pair_table_remove(table, (void *)((i + 1) * 8), (void *)(i * 8),
+                             (void *)i));
+  }
+  for (size_t i = 1; i <= NUM_PAIRS; i++) {
+    assert(pair_table_contains(table, (void *)(i * 8), (void *)((i + 1) * 8)) ==
+           (i % 2 == 0));
+  }
+  // churn through many adds and removes without growing unboundedly
+  for (size_t i = 0; i < 10 * NUM_PAIRS; i++) {
+    pair_table_add(table, (void *)8, (void *)16, (void *)i);
+    assert(pair_table_remove(table, (void *)8, (void *)16, (void *)i));
+  }
+  assert(pair_table_size(table) == NUM_PAIRS / 2);
+  pair_table_free(table);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_pair_table_unordered)
+  DO_TEST(test_pair_table_multiple_values)
+  DO_TEST(test_pair_table_many)
+
+  puts("pair_table_test PASS");
+}
@@ -0,0 +1,105 @@
+#include "quadtree.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t NUM_QUADTREE_POINTS = 500;
+const double QUADTREE_MIN_DISTANCE = 1;
+
+double random_coordinate() { return (rand() % 100000) / 100.0 - 500; }
+
+// Sums up each point's field directly
+vector_t brute_force_field(vector_t *positions, double *masses, size_t n,
+                           vector_t position, size_t skip) {
+  vector_t field = VEC_ZERO;
+  for (size_t i = 0; i < n; i++) {
+    vector_t displacement = vec_subtract(positions[i], position);
+    double distance = vec_get_length(displacement);
+    if (i != skip && distance > QUADTREE_MIN_DISTANCE) {
+      field = vec_add(field, vec_multiply(masses[i] / pow(distance, 3),
+                                          displacement));
+    }
+  }
+  return field;
+}
+
+void test_quadtree_empty() {
+  quadtree_t *tree = quadtree_init(0.5);
+  assert(quadtree_size(tree) == 0);
+  assert(vec_isclose(quadtree_field(tree, VEC_ZERO, 0, 0), VEC_ZERO));
+  quadtree_build(tree, NULL, NULL, 0);
+  assert(vec_isclose(quadtree_field(tree, (vector_t){1, 2}, 0, 0), VEC_ZERO));
+  quadtree_free(tree);
+}
+
+// Checks that a tree with a single point matches the inverse-square law
+void test_quadtree_single() {
+  quadtree_t *tree = quadtree_init(0.5);
+  vector_t position = {3, 4};
+  double mass = 10;
+  quadtree_build(tree, &position, &mass, 1);
+  assert(quadtree_size(tree) == 1);
+  assert(vec_isclose(quadtree_field(tree, VEC_ZERO, SIZE_MAX, 0),
+                     (vector_t){10 * 3 / 125.0, 10 * 4 / 125.0}));
+  assert(vec_isclose(quadtree_field(tree, VEC_ZERO, 0, 0), VEC_ZERO));
+  assert(vec_isclose(quadtree_field(tree, VEC_ZERO, SIZE_MAX, 5), VEC_ZERO));
+  quadtree_free(tree);
+}
+
+// Checks that a zero opening angle gives exact fields, and a small one
+// gives close fields, with coincident points in the mix
+void test_quadtree_random() {
+  srand(7);
+  vector_t positions[NUM_QUADTREE_POINTS];
+  double masses[NUM_QUADTREE_POINTS];
+  for (size_t i = 0; i < NUM_QUADTREE_POINTS; i++) {
+    positions[i] = i % 50 == 1 ? positions[i - 1]
+                               : (vector_t){random_coordinate(),
+                                            random_coordinate()};
+    masses[i] = rand() % 100 + 1;
+  }
+
+  quadtree_t *exact = quadtree_init(0);
+  quadtree_t *approximate = quadtree_init(0.3);
+  // build twice, so the trees are reused
+  for (size_t build = 0; build < 2; build++) {
+    size_t n = build == 0 ? NUM_QUADTREE_POINTS / 2 : NUM_QUADTREE_POINTS;
+    quadtree_build(exact, positions, masses, n);
+    quadtree_build(approximate, positions, masses, n);
+    assert(quadtree_size(approximate) == n);
+    double max_error = 0;
+    for (size_t i = 0; i < n; i++) {
+      vector_t expected =
+          brute_force_field(positions, masses, n, positions[i], i);
+      vector_t field =
+          quadtree_field(exact, positions[i], i, QUADTREE_MIN_DISTANCE);
+      assert(vec_get_length(vec_subtract(field, expected)) <
+             1e-9 * vec_get_length(expected) + 1e-12);
+      field =
+          quadtree_field(approximate, positions[i], i, QUADTREE_MIN_DISTANCE);
+      double error = vec_get_length(vec_subtract(field, expected));
+      max_error = fmax(max_error, error / vec_get_length(expected));
+    }
+    assert(max_error < 0.05);
+  }
+  quadtree_free(exact);
+  quadtree_free(approximate);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_quadtree_empty)
+  DO_TEST(test_quadtree_single)
+  DO_TEST(test_quadtree_random)
+
+  puts("quadtree_test PASS");
+}
@@ -36,8 +36,9 @@ list_t *make_shape() {
 }
 
 void test_scene() {
-  // Build a scene with 3 bodies
+  // Build a scene with 3 bodies, moved at exactly their velocities
   scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_SYMPLECTIC_EULER);
   assert(scene_bodies(scene) == 0);
   body_t *body1 = body_init(make_shape(), 1, (rgb_color_t){1, 1, 1});
   scene_add_body(scene, body1);
@@ -87,16 +88,9 @@ void test_scene() {
   scene_free(scene);
 }
 
-struct two_body_aux {
-  double force_const;
-  body_t *body1;
-  body_t *body2;
-};
-
 // A force creator that moves a body in uniform circular motion about the origin
 void centripetal_force(void *aux) {
-  two_body_aux_t *a = aux;
-  body_t *body = a->body1;
+  body_t *body = aux;
   vector_t v = body_get_velocity(body);
   vector_t r = body_get_centroid(body);
 
@@ -112,13 +106,15 @@ void test_force_creator() {
   const double DT = 1e-6;
   const int STEPS = 1000000;
   scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_SYMPLECTIC_EULER);
   body_t *body = body_init(make_shape(), 123, (rgb_color_t){0, 0, 0});
   vector_t radius = {R, 0};
   body_set_centroid(body, radius);
   body_set_velocity(body, (vector_t){0, OMEGA * R});
   scene_add_body(scene, body);
-  one_body_aux_t *aux = one_body_aux_init(0, body);
-  scene_add_force_creator(scene, centripetal_force, aux, free);
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, body);
+  scene_add_bodies_force_creator(scene, centripetal_force, body, bodies);
   for (int i = 0; i < STEPS; i++) {
     vector_t expected_x = vec_rotate(radius, OMEGA * i * DT);
     assert(vec_within(1e-4, body_get_centroid(body), expected_x));
@@ -171,11 +167,11 @@ void test_force_creator_aux() {
   force_aux_t *gravity_aux = malloc(sizeof(*gravity_aux));
   gravity_aux->scene = scene;
   gravity_aux->coefficient = GRAVITY;
-  scene_add_force_creator(scene, constant_gravity, gravity_aux, free);
+  scene_add_field_force_creator(scene, constant_gravity, gravity_aux, free);
   force_aux_t *drag_aux = malloc(sizeof(*drag_aux));
   drag_aux->scene = scene;
   drag_aux->coefficient = DRAG;
-  scene_add_force_creator(scene, air_drag, drag_aux, free);
+  scene_add_field_force_creator(scene, air_drag, drag_aux, free);
   for (int i = 0; i < STEPS; i++)
     scene_tick(scene, DT);
   assert(vec_isclose(body_get_velocity(light),
@@ -217,17 +213,16 @@ void test_reaping() {
   for (int i = 0; i < 3; i++) {
     scene_add_body(scene, body_init(make_shape(), 1, (rgb_color_t){0, 0, 0}));
   }
-  list_t *list = list_init(0, free);
-  scene_add_bodies_force_creator(scene, remove_body, scene, list, NULL);
+  scene_add_field_force_creator(scene, remove_body, scene, NULL);
 
   count_aux_t *count_aux = malloc(sizeof(*count_aux));
   count_aux->count = 0;
   count_aux->scene = scene;
-  list_t *required_bodies = list_init(2, free);
+  list_t *required_bodies = list_init(2, NULL);
   list_add(required_bodies, scene_get_body(scene, 0));
   list_add(required_bodies, scene_get_body(scene, 1));
-  scene_add_bodies_force_creator(scene, count_calls, count_aux, required_bodies,
-                                 NULL);
+  scene_add_bodies_force_creator(scene, count_calls, count_aux,
+                                 required_bodies);
 
   while (scene_bodies(scene) > 0) {
     scene_tick(scene, 1);
@@ -238,6 +233,43 @@ void test_reaping() {
   scene_free(scene);
 }
 
+// Tests that scene_advance() ticks once per whole fixed step, carries the
+// rest over, catches up at most the limit, and reports how far to draw the
+// bodies between their last two ticks
+void test_scene_advance() {
+  const double STEP = 0.1, SPEED = 10;
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, INTEGRATOR_SYMPLECTIC_EULER);
+  scene_set_fixed_step(scene, STEP, 3);
+  assert(scene_get_interpolation_alpha(scene) == 1);
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(body, (vector_t){5, 0});
+  body_set_velocity(body, (vector_t){SPEED, 0});
+  scene_add_body(scene, body);
+  assert(vec_isclose(body_get_previous_centroid(body), (vector_t){5, 0}));
+
+  assert(scene_advance(scene, 0.25) == 2);
+  assert(isclose(scene_get_interpolation_alpha(scene), 0.5));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){7, 0}));
+  assert(vec_isclose(body_get_previous_centroid(body), (vector_t){6, 0}));
+
+  assert(scene_advance(scene, 0.01) == 0);
+  assert(isclose(scene_get_interpolation_alpha(scene), 0.6));
+  assert(scene_advance(scene, 0.05) == 1);
+  assert(isclose(scene_get_interpolation_alpha(scene), 0.1));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){8, 0}));
+
+  // a long stall is not caught up on
+  assert(scene_advance(scene, 10.02) == 3);
+  assert(isclose(scene_get_interpolation_alpha(scene), 0.3));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){11, 0}));
+  assert(scene_advance(scene, 0.05) == 0);
+
+  scene_tick(scene, STEP);
+  assert(scene_get_interpolation_alpha(scene) == 1);
+  scene_free(scene);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -252,6 +284,7 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_force_creator)
   DO_TEST(test_force_creator_aux)
   DO_TEST(test_reaping)
+  DO_TEST(test_scene_advance)
 
   puts("scene_test PASS");
 }
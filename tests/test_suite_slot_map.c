@@ -0,0 +1,97 @@
+#include "slot_map.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+const size_t NUM_SLOTS = 20;
+
+void test_add_find() {
+  slot_map_t *map = slot_map_init(0);
+  slot_handle_t handles[NUM_SLOTS];
+  for (size_t i = 0; i < NUM_SLOTS; i++) {
+    handles[i] = slot_map_add(map);
+    assert(slot_map_size(map) == i + 1);
+  }
+  for (size_t i = 0; i < NUM_SLOTS; i++) {
+    size_t position;
+    assert(slot_map_find(map, handles[i], &position));
+    assert(position == i);
+    slot_handle_t handle = slot_map_get_handle(map, i);
+    assert(handle.index == handles[i].index);
+    assert(handle.generation == handles[i].generation);
+  }
+  slot_map_free(map);
+}
+
+void test_swap_remove() {
+  slot_map_t *map = slot_map_init(0);
+  slot_handle_t handles[NUM_SLOTS];
+  for (size_t i = 0; i < NUM_SLOTS; i++) {
+    handles[i] = slot_map_add(map);
+  }
+  size_t position;
+  // the last element takes the removed one's position
+  slot_map_swap_remove(map, 3);
+  assert(slot_map_size(map) == NUM_SLOTS - 1);
+  assert(!slot_map_find(map, handles[3], &position));
+  assert(slot_map_find(map, handles[NUM_SLOTS - 1], &position));
+  assert(position == 3);
+  // removing the last element moves nothing
+  slot_map_swap_remove(map, NUM_SLOTS - 2);
+  assert(!slot_map_find(map, handles[NUM_SLOTS - 2], &position));
+  assert(slot_map_find(map, handles[NUM_SLOTS - 1], &position));
+  assert(position == 3);
+  for (size_t i = 0; i < NUM_SLOTS - 2; i++) {
+    if (i != 3) {
+      assert(slot_map_find(map, handles[i], &position));
+      assert(position == i);
+    }
+  }
+  slot_map_free(map);
+}
+
+void test_stale_handles() {
+  slot_map_t *map = slot_map_init(0);
+  slot_handle_t first = slot_map_add(map);
+  slot_map_swap_remove(map, 0);
+  // the freed slot is reused with a new generation
+  slot_handle_t second = slot_map_add(map);
+  assert(second.index == first.index);
+  assert(second.generation != first.generation);
+  size_t position;
+  assert(!slot_map_find(map, first, &position));
+  assert(slot_map_find(map, second, &position));
+  assert(position == 0);
+  // a handle naming a slot that was never made is stale too
+  slot_handle_t unknown = {.index = NUM_SLOTS, .generation = 0};
+  assert(!slot_map_find(map, unknown, &position));
+
+  // reuse a slot many times; no old handle ever matches again
+  slot_handle_t old[NUM_SLOTS];
+  for (size_t i = 0; i < NUM_SLOTS; i++) {
+    old[i] = slot_map_get_handle(map, 0);
+    slot_map_swap_remove(map, 0);
+    slot_map_add(map);
+    for (size_t j = 0; j <= i; j++) {
+      assert(!slot_map_find(map, old[j], &position));
+    }
+  }
+  assert(slot_map_size(map) == 1);
+  slot_map_free(map);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_add_find)
+  DO_TEST(test_swap_remove)
+  DO_TEST(test_stale_handles)
+
+  puts("slot_map_test PASS");
+}
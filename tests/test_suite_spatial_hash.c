@@ -0,0 +1,220 @@
+#include "spatial_hash.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t NUM_RANDOM_BOXES = 200;
+
+typedef struct pair_count {
+  size_t num_boxes;
+  size_t *counts; // counts[i * num_boxes + j] = times (i, j) was reported
+} pair_count_t;
+
+void count_pair(void *data1, void *data2, void *aux) {
+  pair_count_t *count = aux;
+  size_t i = (size_t)data1 - 1, j = (size_t)data2 - 1;
+  if (i > j) {
+    size_t temp = i;
+    i = j;
+    j = temp;
+  }
+  count->counts[i * count->num_boxes + j]++;
+}
+
+aabb_t make_box(double x, double y, double w, double h) {
+  return (aabb_t){.min = {x, y}, .max = {x + w, y + h}};
+}
+
+// Checks that every overlapping pair is reported exactly once
+// and no other pairs are reported
+void check_pairs(spatial_hash_t *grid, aabb_t *boxes, size_t n) {
+  pair_count_t count = {.num_boxes = n, .counts = calloc(n * n, sizeof(size_t))};
+  assert(count.counts);
+  spatial_hash_query_pairs(grid, count_pair, &count);
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = i + 1; j < n; j++) {
+      size_t expected = aabb_overlap(boxes[i], boxes[j]) ? 1 : 0;
+      assert(count.counts[i * n + j] == expected);
+    }
+    assert(count.counts[i * n + i] == 0);
+  }
+  free(count.counts);
+}
+
+void test_spatial_hash_empty() {
+  spatial_hash_t *grid = spatial_hash_init(10);
+  check_pairs(grid, NULL, 0);
+  spatial_hash_free(grid);
+}
+
+void test_spatial_hash_pairs() {
+  spatial_hash_t *grid = spatial_hash_init(10);
+  aabb_t boxes[] = {
+      make_box(0, 0, 5, 5),     // overlaps 1
+      make_box(4, 4, 5, 5),     // overlaps 0
+      make_box(100, 100, 1, 1), // alone
+      make_box(-30, 0, 60, 3),  // spans several cells, overlaps 0
+      make_box(9, 9, 1, 1),     // touches 1 at a corner
+  };
+  size_t n = sizeof(boxes) / sizeof(boxes[0]);
+  for (size_t i = 0; i < n; i++) {
+    spatial_hash_insert(grid, (void *)(i + 1), boxes[i]);
+  }
+  check_pairs(grid, boxes, n);
+
+  // rebuilding after a clear reuses the grid
+  spatial_hash_clear(grid);
+  check_pairs(grid, NULL, 0);
+  for (size_t i = 0; i < n; i++) {
+    spatial_hash_insert(grid, (void *)(i + 1), boxes[i]);
+  }
+  check_pairs(grid, boxes, n);
+  spatial_hash_free(grid);
+}
+
+void test_spatial_hash_oversized() {
+  spatial_hash_t *grid = spatial_hash_init(1);
+  aabb_t boxes[] = {
+      make_box(0, 0, 1000, 1000),  // far too many cells to bucket
+      make_box(500, 500, 1, 1),
+      make_box(-5, -5, 2000, 2),   // also oversized, overlaps 0
+      make_box(2000, 2000, 1, 1),
+  };
+  size_t n = sizeof(boxes) / sizeof(boxes[0]);
+  for (size_t i = 0; i < n; i++) {
+    spatial_hash_insert(grid, (void *)(i + 1), boxes[i]);
+  }
+  check_pairs(grid, boxes, n);
+  spatial_hash_free(grid);
+}
+
+void test_spatial_hash_random() {
+  srand(7);
+  spatial_hash_t *grid = spatial_hash_init(25);
+  aabb_t boxes[NUM_RANDOM_BOXES];
+  for (size_t i = 0; i < NUM_RANDOM_BOXES; i++) {
+    boxes[i] = make_box(rand() % 500 - 250, rand() % 500 - 250,
+                        rand() % 60 + 0.5, rand() % 60 + 0.5);
+    spatial_hash_insert(grid, (void *)(i + 1), boxes[i]);
+  }
+  check_pairs(grid, boxes, NUM_RANDOM_BOXES);
+  spatial_hash_free(grid);
+}
+
+void count_proxy(void *data, void *aux) {
+  ((size_t *)aux)[(size_t)data - 1]++;
+}
+
+// Checks that region queries report every box overlapping them exactly once
+void test_spatial_hash_query() {
+  srand(13);
+  spatial_hash_t *grid = spatial_hash_init(25);
+  aabb_t boxes[NUM_RANDOM_BOXES];
+  for (size_t i = 0; i < NUM_RANDOM_BOXES; i++) {
+    double size = i % 50 == 0 ? 400 : 60;
+    boxes[i] = make_box(rand() % 500 - 250, rand() % 500 - 250,
+                        rand() % (int)size + 0.5, rand() % 60 + 0.5);
+    spatial_hash_insert(grid, (void *)(i + 1), boxes[i]);
+  }
+  size_t counts[NUM_RANDOM_BOXES];
+  for (size_t query = 0; query < 100; query++) {
+    aabb_t region = make_box(rand() % 700 - 350, rand() % 700 - 350,
+                             rand() % 100, rand() % 100);
+    for (size_t i = 0; i < NUM_RANDOM_BOXES; i++) {
+      counts[i] = 0;
+    }
+    spatial_hash_query(grid, region, count_proxy, counts);
+    for (size_t i = 0; i < NUM_RANDOM_BOXES; i++) {
+      assert(counts[i] == aabb_overlap(boxes[i], region));
+    }
+  }
+  spatial_hash_free(grid);
+}
+
+typedef struct ray_count {
+  aabb_t *boxes;
+  size_t *counts;
+  vector_t origin;
+  vector_t delta;
+  double radius;
+  // whether to shorten the ray to each box reported
+  bool clip;
+  double closest;
+} ray_count_t;
+
+double count_ray(void *data, void *aux) {
+  ray_count_t *count = aux;
+  size_t i = (size_t)data - 1;
+  count->counts[i]++;
+  if (!count->clip) {
+    return INFINITY;
+  }
+  double fraction = aabb_ray_fraction(aabb_fatten(count->boxes[i],
+                                                  count->radius),
+                                      count->origin, count->delta);
+  count->closest = fmin(count->closest, fraction);
+  return fraction;
+}
+
+// Checks that rays report every box they pass near exactly once, and that
+// shortened rays still find the closest box
+void test_spatial_hash_raycast() {
+  srand(11);
+  spatial_hash_t *grid = spatial_hash_init(25);
+  aabb_t boxes[NUM_RANDOM_BOXES];
+  for (size_t i = 0; i < NUM_RANDOM_BOXES; i++) {
+    double size = i % 50 == 0 ? 400 : 30;
+    boxes[i] = make_box(rand() % 500 - 250, rand() % 500 - 250,
+                        rand() % (int)size + 0.5, rand() % 30 + 0.5);
+    spatial_hash_insert(grid, (void *)(i + 1), boxes[i]);
+  }
+  size_t counts[NUM_RANDOM_BOXES];
+  for (size_t ray = 0; ray < 200; ray++) {
+    ray_count_t count = {.boxes = boxes,
+                         .counts = counts,
+                         .origin = {rand() % 700 - 350, rand() % 700 - 350},
+                         .delta = {rand() % 700 - 350, rand() % 700 - 350},
+                         .radius = ray % 3 == 0 ? 0 : rand() % 40,
+                         .clip = ray % 2 == 0,
+                         .closest = INFINITY};
+    for (size_t i = 0; i < NUM_RANDOM_BOXES; i++) {
+      counts[i] = 0;
+    }
+    spatial_hash_raycast(grid, count.origin, count.delta, count.radius,
+                         count_ray, &count);
+    double closest = INFINITY;
+    for (size_t i = 0; i < NUM_RANDOM_BOXES; i++) {
+      double fraction = aabb_ray_fraction(aabb_fatten(boxes[i], count.radius),
+                                          count.origin, count.delta);
+      closest = fmin(closest, fraction);
+      assert(counts[i] <= 1);
+      if (!count.clip) {
+        assert(counts[i] == (fraction <= 1));
+      }
+    }
+    if (count.clip) {
+      assert(count.closest == closest);
+    }
+  }
+  spatial_hash_free(grid);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_spatial_hash_empty)
+  DO_TEST(test_spatial_hash_pairs)
+  DO_TEST(test_spatial_hash_oversized)
+  DO_TEST(test_spatial_hash_random)
+  DO_TEST(test_spatial_hash_query)
+  DO_TEST(test_spatial_hash_raycast)
+
+  puts("spatial_hash_test PASS");
+}
@@ -0,0 +1,178 @@
+#include "forces.h"
+#include "springs.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t NUM_NETWORK_BODIES = 20;
+const size_t NUM_NETWORK_SPRINGS = 60;
+
+body_t *make_node(vector_t centroid, double mass) {
+  return body_init_circle(centroid, 1, mass, (rgb_color_t){0, 0, 0});
+}
+
+// Tests that a network of springs with no rest length or damping, added in
+// any order, moves bodies exactly like create_spring()
+void test_network_matches_springs() {
+  const double DT = 1e-3;
+  srand(5);
+  scene_t *expected = scene_init();
+  scene_t *scene = scene_init();
+  spring_network_t *network = spring_network_init();
+  for (size_t i = 0; i < NUM_NETWORK_BODIES; i++) {
+    vector_t centroid = {rand() % 1000, rand() % 1000};
+    double mass = rand() % 10 + 1;
+    scene_add_body(expected, make_node(centroid, mass));
+    body_t *body = make_node(centroid, mass);
+    scene_add_body(scene, body);
+    assert(spring_network_add_body(network, body) == i);
+  }
+  for (size_t i = 0; i < NUM_NETWORK_SPRINGS; i++) {
+    size_t body1 = rand() % NUM_NETWORK_BODIES;
+    size_t body2 = (body1 + 1 + rand() % (NUM_NETWORK_BODIES - 1)) %
+                   NUM_NETWORK_BODIES;
+    double k = rand() % 10 + 1;
+    create_spring(expected, k, scene_get_body(expected, body1),
+                  scene_get_body(expected, body2));
+    spring_network_add_spring(network, body1, body2, k, 0, 0);
+  }
+  assert(spring_network_springs(network) == NUM_NETWORK_SPRINGS);
+  create_spring_network(scene, network);
+
+  for (size_t tick = 0; tick < 100; tick++) {
+    scene_tick(expected, DT);
+    scene_tick(scene, DT);
+  }
+  for (size_t i = 0; i < NUM_NETWORK_BODIES; i++) {
+    body_t *body = scene_get_body(scene, i);
+    assert(vec_isclose(body_get_centroid(body),
+                       body_get_centroid(scene_get_body(expected, i))));
+    assert(vec_isclose(body_get_velocity(body),
+                       body_get_velocity(scene_get_body(expected, i))));
+  }
+  scene_free(expected);
+  scene_free(scene);
+}
+
+// Tests that a damped spring with a rest length settles at its rest length
+void test_network_rest_length() {
+  const double REST_LENGTH = 50, DT = 1e-3;
+  scene_t *scene = scene_init();
+  spring_network_t *network = spring_network_init();
+  body_t *body1 = make_node((vector_t){0, 0}, 1);
+  body_t *body2 = make_node((vector_t){20, 10}, 2);
+  scene_add_body(scene, body1);
+  scene_add_body(scene, body2);
+  spring_network_add_body(network, body1);
+  spring_network_add_body(network, body2);
+  spring_network_add_spring(network, 1, 0, 100, REST_LENGTH, 5);
+  create_spring_network(scene, network);
+
+  for (size_t tick = 0; tick < 20000; tick++) {
+    scene_tick(scene, DT);
+  }
+  vector_t displacement =
+      vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
+  assert(fabs(vec_get_length(displacement) - REST_LENGTH) < 1e-3);
+  assert(vec_get_length(body_get_velocity(body1)) < 1e-3);
+  assert(vec_get_length(body_get_velocity(body2)) < 1e-3);
+  scene_free(scene);
+}
+
+// Tests that removing a body removes its network.
+// If it doesn't, asan will report a heap-use-after-free failure.
+void test_network_removed() {
+  scene_t *scene = scene_init();
+  spring_network_t *network = spring_network_init();
+  for (size_t i = 0; i < NUM_NETWORK_BODIES; i++) {
+    body_t *body = make_node((vector_t){i, 0}, 1);
+    scene_add_body(scene, body);
+    spring_network_add_body(network, body);
+    if (i > 0) {
+      spring_network_add_spring(network, i - 1, i, 1, 1, 1);
+    }
+  }
+  create_spring_network(scene, network);
+  scene_tick(scene, 1);
+  body_remove(scene_get_body(scene, NUM_NETWORK_BODIES / 2));
+  scene_tick(scene, 1);
+  scene_tick(scene, 1);
+  scene_free(scene);
+}
+
+// Tests that the implicit integrator follows a soft spring's exact
+// oscillation when the tick is short
+void test_implicit_sinusoid() {
+  const double M = 10, K = 2, A = 3, DT = 1e-3;
+  const size_t STEPS = 5000;
+  scene_t *scene = scene_init();
+  spring_network_t *network = spring_network_init();
+  body_t *mass = make_node((vector_t){A, 0}, M);
+  body_t *anchor = make_node(VEC_ZERO, INFINITY);
+  scene_add_body(scene, mass);
+  scene_add_body(scene, anchor);
+  spring_network_add_body(network, mass);
+  spring_network_add_body(network, anchor);
+  spring_network_add_spring(network, 0, 1, K, 0, 0);
+  create_implicit_spring_network(scene, network);
+  for (size_t i = 0; i < STEPS; i++) {
+    scene_tick(scene, DT);
+  }
+  double expected = A * cos(sqrt(K / M) * STEPS * DT);
+  assert(fabs(body_get_centroid(mass).x - expected) < 1e-2);
+  assert(vec_isclose(body_get_centroid(anchor), VEC_ZERO));
+  scene_free(scene);
+}
+
+// Tests that a chain of very stiff springs hanging under gravity settles
+// where its springs balance gravity, at a frame-rate tick
+void test_implicit_stiff_chain() {
+  const size_t LINKS = 10;
+  const double MASS = 1, K = 1e5, GRAVITY = 10, REST_LENGTH = 1;
+  const double DT = 1.0 / 60;
+  scene_t *scene = scene_init();
+  spring_network_t *network = spring_network_init();
+  for (size_t i = 0; i <= LINKS; i++) {
+    body_t *body =
+        make_node((vector_t){0, -(double)i}, i == 0 ? INFINITY : MASS);
+    scene_add_body(scene, body);
+    spring_network_add_body(network, body);
+    if (i > 0) {
+      spring_network_add_spring(network, i, i - 1, K, REST_LENGTH, 10);
+    }
+  }
+  spring_network_set_drag(network, 1);
+  create_uniform_gravity(scene, (vector_t){0, -GRAVITY}, NULL, NULL);
+  create_implicit_spring_network(scene, network);
+  for (size_t tick = 0; tick < 600; tick++) {
+    scene_tick(scene, DT);
+  }
+  // the spring above link i holds up the links from i down
+  double y = 0;
+  for (size_t i = 1; i <= LINKS; i++) {
+    y -= REST_LENGTH + MASS * GRAVITY * (LINKS - i + 1) / K;
+    vector_t centroid = body_get_centroid(scene_get_body(scene, i));
+    assert(fabs(centroid.y - y) < 1e-6);
+    assert(fabs(centroid.x) < 1e-9);
+  }
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_network_matches_springs)
+  DO_TEST(test_network_rest_length)
+  DO_TEST(test_network_removed)
+  DO_TEST(test_implicit_sinusoid)
+  DO_TEST(test_implicit_stiff_chain)
+
+  puts("springs_test PASS");
+}
@@ -0,0 +1,150 @@
+#include "sweep_and_prune.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t NUM_MOVING_BOXES = 60;
+const size_t NUM_SWEEP_TICKS = 200;
+
+typedef struct pair_state {
+  size_t num_boxes;
+  // overlapping[i * num_boxes + j] tracks the pair set through its events
+  bool *overlapping;
+  size_t num_events;
+} pair_state_t;
+
+size_t box_index(void *data) { return (size_t)data - 1; }
+
+void on_add(void *data1, void *data2, void *aux) {
+  pair_state_t *state = aux;
+  size_t i = box_index(data1), j = box_index(data2);
+  assert(!state->overlapping[i * state->num_boxes + j]);
+  state->overlapping[i * state->num_boxes + j] = true;
+  state->overlapping[j * state->num_boxes + i] = true;
+  state->num_events++;
+}
+
+void on_remove(void *data1, void *data2, void *aux) {
+  pair_state_t *state = aux;
+  size_t i = box_index(data1), j = box_index(data2);
+  assert(state->overlapping[i * state->num_boxes + j]);
+  state->overlapping[i * state->num_boxes + j] = false;
+  state->overlapping[j * state->num_boxes + i] = false;
+  state->num_events++;
+}
+
+void count_reported(void *data1, void *data2, void *aux) { (*(size_t *)aux)++; }
+
+// Checks that the events and the pair set agree with a brute-force test
+void check_pairs(sweep_and_prune_t *sap, pair_state_t *state, aabb_t *boxes,
+                 bool *alive) {
+  size_t n = state->num_boxes, expected = 0;
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = i + 1; j < n; j++) {
+      bool overlap = alive[i] && alive[j] && aabb_overlap(boxes[i], boxes[j]);
+      assert(state->overlapping[i * n + j] == overlap);
+      expected += overlap;
+    }
+  }
+  assert(sweep_and_prune_num_pairs(sap) == expected);
+  size_t reported = 0;
+  sweep_and_prune_query_pairs(sap, count_reported, &reported);
+  assert(reported == expected);
+}
+
+aabb_t make_box(double x, double y, double w, double h) {
+  return (aabb_t){.min = {x, y}, .max = {x + w, y + h}};
+}
+
+void test_sweep_and_prune_simple() {
+  bool overlapping[9] = {false};
+  pair_state_t state = {.num_boxes = 3, .overlapping = overlapping};
+  sweep_and_prune_t *sap = sweep_and_prune_init(on_add, on_remove, &state);
+  aabb_t boxes[] = {make_box(0, 0, 2, 2), make_box(1, 1, 2, 2),
+                    make_box(10, 0, 1, 1)};
+  bool alive[] = {true, true, true};
+  size_t ids[3];
+  for (size_t i = 0; i < 3; i++) {
+    ids[i] = sweep_and_prune_add(sap, (void *)(i + 1), boxes[i]);
+  }
+  sweep_and_prune_update(sap);
+  check_pairs(sap, &state, boxes, alive);
+  assert(state.num_events == 1);
+
+  // separate along y only, then touch box 2 along an edge
+  boxes[1] = make_box(1, 5, 2, 2);
+  boxes[2] = make_box(2, 0, 1, 1);
+  for (size_t i = 0; i < 3; i++) {
+    sweep_and_prune_move(sap, ids[i], boxes[i]);
+  }
+  sweep_and_prune_update(sap);
+  check_pairs(sap, &state, boxes, alive);
+
+  // removing a proxy removes its pairs
+  sweep_and_prune_remove(sap, ids[0]);
+  alive[0] = false;
+  check_pairs(sap, &state, boxes, alive);
+  sweep_and_prune_free(sap);
+}
+
+void test_sweep_and_prune_moving() {
+  srand(3);
+  size_t n = NUM_MOVING_BOXES;
+  pair_state_t state = {.num_boxes = n,
+                        .overlapping = calloc(n * n, sizeof(bool))};
+  assert(state.overlapping);
+  sweep_and_prune_t *sap = sweep_and_prune_init(on_add, on_remove, &state);
+  aabb_t boxes[NUM_MOVING_BOXES];
+  vector_t velocities[NUM_MOVING_BOXES];
+  bool alive[NUM_MOVING_BOXES];
+  size_t ids[NUM_MOVING_BOXES];
+  for (size_t i = 0; i < n; i++) {
+    boxes[i] = make_box(rand() % 200, rand() % 200, rand() % 20 + 1,
+                        rand() % 20 + 1);
+    velocities[i] = (vector_t){rand() % 5 - 2, rand() % 5 - 2};
+    alive[i] = true;
+    ids[i] = sweep_and_prune_add(sap, (void *)(i + 1), boxes[i]);
+  }
+
+  for (size_t t = 0; t < NUM_SWEEP_TICKS; t++) {
+    for (size_t i = 0; i < n; i++) {
+      if (!alive[i]) {
+        continue;
+      }
+      boxes[i].min = vec_add(boxes[i].min, velocities[i]);
+      boxes[i].max = vec_add(boxes[i].max, velocities[i]);
+      sweep_and_prune_move(sap, ids[i], boxes[i]);
+    }
+    sweep_and_prune_update(sap);
+    check_pairs(sap, &state, boxes, alive);
+
+    // occasionally swap a box out for a new one, reusing its id
+    if (t % 10 == 0) {
+      size_t i = rand() % n;
+      sweep_and_prune_remove(sap, ids[i]);
+      alive[i] = false;
+      check_pairs(sap, &state, boxes, alive);
+      boxes[i] = make_box(rand() % 200, rand() % 200, 10, 10);
+      ids[i] = sweep_and_prune_add(sap, (void *)(i + 1), boxes[i]);
+      alive[i] = true;
+    }
+  }
+  sweep_and_prune_free(sap);
+  free(state.overlapping);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_sweep_and_prune_simple)
+  DO_TEST(test_sweep_and_prune_moving)
+
+  puts("sweep_and_prune_test PASS");
+}